@@ -28,6 +28,9 @@ if("x${CMAKE_C_SIMULATE_ID}" STREQUAL "xMSVC")
 
 else()
 
+  # icl reads -MD as the /MD runtime option, so only icc writes depfiles.
+  set(CMAKE_C_DEPFILE_FORMAT gcc)
+
   set(CMAKE_C_COMPILE_OPTIONS_EXPLICIT_LANGUAGE -x c)
 
   if (NOT CMAKE_C_COMPILER_VERSION VERSION_LESS 15.0.0)
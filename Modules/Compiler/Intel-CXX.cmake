@@ -42,6 +42,9 @@ if("x${CMAKE_CXX_SIMULATE_ID}" STREQUAL "xMSVC")
 
 else()
 
+  # icl reads -MD as the /MD runtime option, so only icc writes depfiles.
+  set(CMAKE_CXX_DEPFILE_FORMAT gcc)
+
   set(CMAKE_CXX_COMPILE_OPTIONS_EXPLICIT_LANGUAGE -x c++)
 
   if (NOT CMAKE_CXX_COMPILER_VERSION VERSION_LESS 19.0.0)
@@ -23,6 +23,7 @@ string(APPEND CMAKE_C_FLAGS_RELEASE_INIT " -xO3 -DNDEBUG")
 string(APPEND CMAKE_C_FLAGS_RELWITHDEBINFO_INIT " -g -xO2 -DNDEBUG")
 
 set(CMAKE_DEPFILE_FLAGS_C "-xMD -xMF <DEPFILE>")
+set(CMAKE_C_DEPFILE_FORMAT gcc)
 
 # Initialize C link type selection flags.  These flags are used when
 # building a shared library, shared module, or executable that links
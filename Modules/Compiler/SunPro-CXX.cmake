@@ -23,6 +23,7 @@ string(APPEND CMAKE_CXX_FLAGS_RELEASE_INIT " -xO3 -DNDEBUG")
 string(APPEND CMAKE_CXX_FLAGS_RELWITHDEBINFO_INIT " -g -xO2 -DNDEBUG")
 
 set(CMAKE_DEPFILE_FLAGS_CXX "-xMD -xMF <DEPFILE>")
+set(CMAKE_CXX_DEPFILE_FORMAT gcc)
 
 # Initialize C link type selection flags.  These flags are used when
 # building a shared library, shared module, or executable that links
@@ -0,0 +1,239 @@
+/* Distributed under the OSI-approved BSD 3-Clause License.  See accompanying
+   file Copyright.txt or https://cmake.org/licensing for details.  */
+#include "cmCTestCostData.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdlib>
+#include <tuple>
+#include <utility>
+
+#include <cm/string_view>
+
+#include "cmsys/FStream.hxx"
+
+#include "cmGeneratedFileStream.h"
+#include "cmSystemTools.h"
+
+namespace {
+// The first runs of a test are averaged equally.  From then on the last
+// run has this weight, so older runs fade out.
+double const MinimumWeight = 0.1;
+
+std::size_t const ColumnCount = 7;
+
+// The fields are views into a NUL terminated buffer, so the number ends
+// at the following separator.
+bool ParseNumber(cm::string_view field, double& value)
+{
+  if (field.empty()) {
+    return false;
+  }
+  char* end = nullptr;
+  value = std::strtod(field.data(), &end);
+  return end == field.data() + field.size() && std::isfinite(value);
+}
+
+bool ParseNumber(cm::string_view field, long& value)
+{
+  if (field.empty()) {
+    return false;
+  }
+  char* end = nullptr;
+  value = std::strtol(field.data(), &end, 10);
+  return end == field.data() + field.size();
+}
+}
+
+void cmCTestCostData::SetContext(std::string config, std::size_t parallelLevel)
+{
+  this->Config = std::move(config);
+  this->ParallelLevel = parallelLevel;
+}
+
+bool cmCTestCostData::Load(std::string const& fname)
+{
+  cmsys::ifstream fin(fname.c_str(), std::ios::in | std::ios::binary);
+  if (!fin) {
+    return false;
+  }
+  std::string content;
+  content.resize(cmSystemTools::FileLength(fname));
+  fin.read(&content[0], static_cast<std::streamsize>(content.size()));
+  content.resize(static_cast<std::size_t>(fin.gcount()));
+
+  bool inFailed = false;
+  std::size_t begin = 0;
+  while (begin < content.size()) {
+    std::size_t end = content.find('\n', begin);
+    if (end == std::string::npos) {
+      end = content.size();
+    }
+    cm::string_view line(&content[begin], end - begin);
+    begin = end + 1;
+    if (!line.empty() && line.back() == '\r') {
+      line.remove_suffix(1);
+    }
+
+    if (inFailed) {
+      if (!line.empty()) {
+        this->LastTestsFailed.emplace(line.data(), line.size());
+      }
+    } else if (line == "---") {
+      inFailed = true;
+    } else {
+      // Skip a malformed line, its test is recorded again on the next run.
+      this->ParseLine(line);
+    }
+  }
+  return true;
+}
+
+bool cmCTestCostData::ParseLine(cm::string_view line)
+{
+  std::array<cm::string_view, ColumnCount> fields;
+  std::size_t count = 0;
+  while (count < fields.size() && !line.empty()) {
+    std::size_t const space = line.find(' ');
+    fields[count++] = line.substr(0, space);
+    line = space == cm::string_view::npos ? cm::string_view()
+                                          : line.substr(space + 1);
+  }
+  if (fields[0].empty() || !line.empty() ||
+      (count != 3 && count != ColumnCount)) {
+    return false;
+  }
+
+  History history;
+  long runs;
+  if (!ParseNumber(fields[1], runs) || runs < 0 ||
+      !ParseNumber(fields[2], history.Data.Mean)) {
+    return false;
+  }
+  history.Data.Runs = static_cast<int>(runs);
+  if (count == ColumnCount) {
+    long level;
+    long memory;
+    if (!ParseNumber(fields[3], history.Data.Variance) ||
+        !ParseNumber(fields[5], level) || level < 0 ||
+        !ParseNumber(fields[6], memory) || memory < 0) {
+      return false;
+    }
+    if (fields[4] != "-") {
+      history.Config.assign(fields[4].data(), fields[4].size());
+    }
+    history.ParallelLevel = static_cast<std::size_t>(level);
+    history.Data.PeakMemory = static_cast<unsigned long>(memory);
+  }
+
+  std::string name(fields[0].data(), fields[0].size());
+  auto const inserted = this->Tests.emplace(name, std::vector<History>());
+  if (inserted.second) {
+    this->Names.push_back(std::move(name));
+  }
+  std::vector<History>& histories = inserted.first->second;
+  auto const it = std::find_if(
+    histories.begin(), histories.end(), [&history](History const& h) {
+      return h.Config == history.Config &&
+        h.ParallelLevel == history.ParallelLevel;
+    });
+  if (it != histories.end()) {
+    *it = std::move(history);
+  } else {
+    histories.push_back(std::move(history));
+  }
+  return true;
+}
+
+bool cmCTestCostData::Save(std::string const& fname,
+                           std::vector<std::string> const& failed) const
+{
+  cmGeneratedFileStream fout(fname);
+  if (!fout) {
+    return false;
+  }
+  for (std::string const& name : this->Names) {
+    for (History const& h : this->Tests.at(name)) {
+      fout << name << ' ' << h.Data.Runs << ' ' << h.Data.Mean << ' '
+           << h.Data.Variance << ' ' << (h.Config.empty() ? "-" : h.Config)
+           << ' ' << h.ParallelLevel << ' ' << h.Data.PeakMemory << '\n';
+    }
+  }
+  fout << "---\n";
+  for (std::string const& f : failed) {
+    fout << f << '\n';
+  }
+  return fout.Close();
+}
+
+cmCTestCostData::Entry const* cmCTestCostData::Find(
+  std::string const& name) const
+{
+  auto const it = this->Tests.find(name);
+  if (it == this->Tests.end()) {
+    return nullptr;
+  }
+
+  // Prefer the same configuration, then the closest parallel level, then
+  // the longest history.
+  auto rank = [this](History const& h) {
+    std::size_t const distance = h.ParallelLevel > this->ParallelLevel
+      ? h.ParallelLevel - this->ParallelLevel
+      : this->ParallelLevel - h.ParallelLevel;
+    return std::make_tuple(h.Config != this->Config, distance, -h.Data.Runs);
+  };
+  History const* best = nullptr;
+  for (History const& h : it->second) {
+    if (!best || rank(h) < rank(*best)) {
+      best = &h;
+    }
+  }
+  return best ? &best->Data : nullptr;
+}
+
+void cmCTestCostData::Record(std::string const& name, double seconds,
+                             unsigned long peakMemory)
+{
+  auto const inserted = this->Tests.emplace(name, std::vector<History>());
+  if (inserted.second) {
+    this->Names.push_back(name);
+  }
+  std::vector<History>& histories = inserted.first->second;
+  auto it =
+    std::find_if(histories.begin(), histories.end(), [this](History const& h) {
+      return h.Config == this->Config &&
+        h.ParallelLevel == this->ParallelLevel;
+    });
+  if (it == histories.end()) {
+    // History of an unknown context, written by an older version, is
+    // continued by the first context that records the test.
+    History history;
+    auto const unknown = std::find_if(
+      histories.begin(), histories.end(),
+      [](History const& h) { return h.ParallelLevel == 0; });
+    if (unknown != histories.end()) {
+      history.Data = unknown->Data;
+      histories.erase(unknown);
+    }
+    history.Config = this->Config;
+    history.ParallelLevel = this->ParallelLevel;
+    histories.push_back(std::move(history));
+    it = histories.end() - 1;
+  }
+
+  // Update the mean and variance incrementally, see "Incremental
+  // calculation of weighted mean and variance" by Tony Finch.
+  Entry& e = it->Data;
+  double const weight = std::max(1.0 / (e.Runs + 1), MinimumWeight);
+  double const diff = seconds - e.Mean;
+  e.Mean += weight * diff;
+  e.Variance = (1.0 - weight) * (e.Variance + weight * diff * diff);
+  if (peakMemory >= e.PeakMemory) {
+    e.PeakMemory = peakMemory;
+  } else if (peakMemory > 0) {
+    e.PeakMemory -= static_cast<unsigned long>(
+      std::ceil(weight * static_cast<double>(e.PeakMemory - peakMemory)));
+  }
+  ++e.Runs;
+}
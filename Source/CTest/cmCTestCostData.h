@@ -0,0 +1,92 @@
+/* Distributed under the OSI-approved BSD 3-Clause License.  See accompanying
+   file Copyright.txt or https://cmake.org/licensing for details.  */
+#ifndef cmCTestCostData_h
+#define cmCTestCostData_h
+
+#include "cmConfigure.h" // IWYU pragma: keep
+
+#include <cstddef>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include <cm/string_view>
+
+/** \class cmCTestCostData
+ * \brief Duration history of tests, stored in CTestCostData.txt.
+ *
+ * Every line holds the history of one test in one context, that is the
+ * configuration and the parallel level the test ran with:
+ *
+ *   <name> <runs> <mean> <variance> <config> <parallel_level> <peak_memory>
+ *
+ * The mean and variance are weighted exponentially once a test has run a
+ * few times, so they follow a test that becomes slower or faster.  The
+ * peak memory in MiB follows an increase right away and a decrease
+ * slowly, and is zero if it was never measured.  An
+ * empty configuration is written as "-".  Older versions only write and
+ * read the first three columns; their lines are taken as history of an
+ * unknown context, which the first run in a known context continues.
+ * After the history a "---" line is followed by the names of the tests
+ * that failed in the last run.
+ */
+class cmCTestCostData
+{
+public:
+  struct Entry
+  {
+    int Runs = 0;
+    double Mean = 0;
+    double Variance = 0;
+    unsigned long PeakMemory = 0;
+  };
+
+  /** Set the context of the tests recorded from now on.  */
+  void SetContext(std::string config, std::size_t parallelLevel);
+
+  /** Read a cost data file.  Returns false if it cannot be read, which
+      is the case before tests have run for the first time.  */
+  bool Load(std::string const& fname);
+
+  /** Replace a cost data file.  The file is written to a temporary file
+      first, so that a concurrent reader never sees a partial file.  */
+  bool Save(std::string const& fname,
+            std::vector<std::string> const& failed) const;
+
+  /** The history of a test recorded in the context closest to the
+      current one, or nullptr if the test has no history.  */
+  Entry const* Find(std::string const& name) const;
+
+  /** Add a run of a test in the current context.  The peak memory is
+      zero if it was not measured.  */
+  void Record(std::string const& name, double seconds,
+              unsigned long peakMemory);
+
+  std::unordered_set<std::string> const& GetLastTestsFailed() const
+  {
+    return this->LastTestsFailed;
+  }
+
+private:
+  struct History
+  {
+    std::string Config;
+    // Zero for history of an unknown context.
+    std::size_t ParallelLevel = 0;
+    Entry Data;
+  };
+
+  bool ParseLine(cm::string_view line);
+
+  std::string Config;
+  std::size_t ParallelLevel = 1;
+
+  // Names in the order they are written, followed by the tests recorded
+  // for the first time.
+  std::vector<std::string> Names;
+  std::unordered_map<std::string, std::vector<History>> Tests;
+  std::unordered_set<std::string> LastTestsFailed;
+};
+
+#endif
@@ -6,6 +6,7 @@
 #include <cassert>
 #include <chrono>
 #include <cmath>
+#include <csignal>
 #include <cstddef> // IWYU pragma: keep
 #include <cstdlib>
 #include <cstring>
@@ -32,9 +33,11 @@
 #include "cmCTest.h"
 #include "cmCTestBinPacker.h"
 #include "cmCTestRunTest.h"
+#include "cmCTestSystemMonitor.h"
 #include "cmCTestTestHandler.h"
 #include "cmDuration.h"
 #include "cmListFileCache.h"
+#include "cmProcess.h"
 #include "cmRange.h"
 #include "cmStringAlgorithms.h"
 #include "cmSystemTools.h"
@@ -91,8 +94,15 @@ void cmCTestMultiProcessHandler::SetTests(TestMap& tests,
     this->TestRunningMap[t.first] = false;
     this->TestFinishMap[t.first] = false;
   }
+  // If names are duplicated the last test wins.
+  for (auto const& p : this->Properties) {
+    this->TestNames[p.second->Name] = p.first;
+  }
   if (!this->CTest->GetShowOnly()) {
     this->ReadCostData();
+    if (this->CTest->GetCacheResults()) {
+      this->ResultCache.Load(this->GetResultCacheFile());
+    }
     this->HasCycles = !this->CheckCycles();
     if (this->HasCycles) {
       return;
@@ -132,11 +142,39 @@ void cmCTestMultiProcessHandler::RunTests()
 #endif
   this->TestHandler->SetMaxIndex(this->FindMaxIndex());
 
+  // The prediction must use the costs before the tests update them.
+  bool const scheduleReport = this->CTest->GetScheduleReport();
+  SchedulePrediction prediction;
+  if (scheduleReport) {
+    this->PredictSchedule(prediction);
+  }
+  auto const start = std::chrono::steady_clock::now();
+
+  this->InitMemoryBudget();
+  this->PressureLevel = this->ParallelLevel;
+  this->Environment = cmSystemTools::GetEnvironmentVariables();
   uv_loop_init(&this->Loop);
+  if (this->CTest->GetTestPressure() > 0) {
+    this->StartPressureMonitor();
+  }
   this->StartNextTests();
   uv_run(&this->Loop, UV_RUN_DEFAULT);
+  if (this->PressureTimer.get() != nullptr ||
+      this->ChildSignal.get() != nullptr) {
+    // The handles do not keep the loop running, and the timer may be left
+    // over if tests were, e.g. because the stop time passed.  Let the
+    // loop close them.
+    this->PressureTimer.reset();
+    this->ChildSignal.reset();
+    uv_run(&this->Loop, UV_RUN_DEFAULT);
+  }
   uv_loop_close(&this->Loop);
 
+  if (scheduleReport) {
+    this->PrintScheduleReport(prediction,
+                              std::chrono::steady_clock::now() - start);
+  }
+
   if (!this->StopTimePassed && !this->CheckStopOnFailure()) {
     assert(this->Completed == this->Total);
     assert(this->Tests.empty());
@@ -145,6 +183,10 @@ void cmCTestMultiProcessHandler::RunTests()
 
   this->MarkFinished();
   this->UpdateCostData();
+  if (this->CTest->GetCacheResults()) {
+    this->ResultCache.Save(this->GetResultCacheFile(),
+                           this->TestHandler->GetAllTestNames());
+  }
 }
 
 bool cmCTestMultiProcessHandler::StartTestProcess(int test)
@@ -170,6 +212,7 @@ bool cmCTestMultiProcessHandler::StartTestProcess(int test)
   // now remove the test itself
   this->EraseTest(test);
   this->RunningCount += GetProcessorsUsed(test);
+  this->MemoryReserved += this->Properties[test]->MemoryRequired;
 
   auto testRun = cm::make_unique<cmCTestRunTest>(*this);
 
@@ -419,9 +462,11 @@ void cmCTestMultiProcessHandler::UnlockResources(int index)
 
 void cmCTestMultiProcessHandler::EraseTest(int test)
 {
+  auto const rank = this->TestRanks.find(test);
+  if (rank != this->TestRanks.end()) {
+    this->ReadyTests.erase(std::make_pair(rank->second, test));
+  }
   this->Tests.erase(test);
-  this->SortedTests.erase(
-    std::find(this->SortedTests.begin(), this->SortedTests.end(), test));
 }
 
 inline size_t cmCTestMultiProcessHandler::GetProcessorsUsed(int test)
@@ -481,6 +526,7 @@ void cmCTestMultiProcessHandler::StartNextTests()
 
   if (this->Tests.empty()) {
     this->TestLoadRetryTimer.reset();
+    this->PressureTimer.reset();
     return;
   }
 
@@ -494,8 +540,10 @@ void cmCTestMultiProcessHandler::StartNextTests()
 
   size_t numToStart = 0;
 
-  if (this->RunningCount < this->ParallelLevel) {
-    numToStart = this->ParallelLevel - this->RunningCount;
+  size_t const parallelLevel =
+    std::min(this->ParallelLevel, this->PressureLevel);
+  if (this->RunningCount < parallelLevel) {
+    numToStart = parallelLevel - this->RunningCount;
   }
 
   if (numToStart == 0) {
@@ -540,8 +588,17 @@ void cmCTestMultiProcessHandler::StartNextTests()
     }
   }
 
-  TestList copy = this->SortedTests;
-  for (auto const& test : copy) {
+  cm::optional<unsigned long> availableMemory;
+
+  // Visit the tests that wait for no other test in the order of
+  // SortedTests.  A test that fails to start is finished right away and
+  // may make more tests ready, so look up the next one after each test.
+  std::pair<size_t, int> current;
+  for (auto it = this->ReadyTests.begin(); it != this->ReadyTests.end();
+       it = this->ReadyTests.upper_bound(current)) {
+    current = *it;
+    int const test = current.second;
+
     // Take a nap if we're currently performing a RUN_SERIAL test.
     if (this->SerialTestRunning) {
       break;
@@ -551,6 +608,13 @@ void cmCTestMultiProcessHandler::StartNextTests()
     if (this->Properties[test]->RunSerial && this->RunningCount > 0) {
       continue;
     }
+    // Leave the memory the running tests need to them.  A test that needs
+    // more memory than there is runs alone.
+    unsigned long const memory = this->Properties[test]->MemoryRequired;
+    if (memory > 0 && this->RunningCount > 0 &&
+        !this->MemoryFits(memory, availableMemory)) {
+      continue;
+    }
 
     size_t processors = GetProcessorsUsed(test);
     bool testLoadOk = true;
@@ -571,8 +635,12 @@ void cmCTestMultiProcessHandler::StartNextTests()
       testWithMinProcessors = GetName(test);
     }
 
-    if (testLoadOk && processors <= numToStart && this->StartTest(test)) {
-      numToStart -= processors;
+    // With a high pressure a test may need more processors than may be
+    // used, so it runs alone.
+    if (testLoadOk &&
+        (processors <= numToStart || this->RunningCount == 0) &&
+        this->StartTest(test)) {
+      numToStart -= std::min(processors, numToStart);
     } else if (numToStart == 0) {
       break;
     }
@@ -582,8 +650,8 @@ void cmCTestMultiProcessHandler::StartNextTests()
     // Find out whether there are any non RUN_SERIAL tests left, so that the
     // correct warning may be displayed.
     bool onlyRunSerialTestsLeft = true;
-    for (auto const& test : copy) {
-      if (!this->Properties[test]->RunSerial) {
+    for (auto const& test : this->Tests) {
+      if (!this->Properties[test.first]->RunSerial) {
         onlyRunSerialTestsLeft = false;
       }
     }
@@ -619,12 +687,207 @@ void cmCTestMultiProcessHandler::StartNextTests()
   }
 }
 
+int cmCTestMultiProcessHandler::StartChildSignal()
+{
+  if (this->ChildSignal.get() != nullptr) {
+    return 0;
+  }
+  int status = this->ChildSignal.init(this->Loop, this);
+  if (status == 0) {
+    // The handler keeps the loop running only while there are processes
+    // to watch.
+    uv_unref(this->ChildSignal);
+    status = this->ChildSignal.start(
+      &cmCTestMultiProcessHandler::OnChildSignalCB, SIGCHLD);
+  }
+  if (status != 0) {
+    this->ChildSignal.reset();
+  }
+  return status;
+}
+
+void cmCTestMultiProcessHandler::WatchChild(long pid, cmProcess* process)
+{
+  if (this->Children.empty()) {
+    uv_ref(this->ChildSignal);
+  }
+  this->Children[pid] = process;
+}
+
+void cmCTestMultiProcessHandler::UnwatchChild(long pid)
+{
+  if (this->Children.erase(pid) != 0 && this->Children.empty()) {
+    uv_unref(this->ChildSignal);
+  }
+}
+
+void cmCTestMultiProcessHandler::OnChildSignalCB(uv_signal_t* signal,
+                                                 int /*signum*/)
+{
+  auto self = static_cast<cmCTestMultiProcessHandler*>(signal->data);
+  self->OnChildSignal();
+}
+
+void cmCTestMultiProcessHandler::OnChildSignal()
+{
+  // The signal is not repeated for processes exiting at the same time,
+  // so check all of them.  A process that exited finishes its test,
+  // which may start others, so look every one up again.
+  std::vector<long> pids;
+  pids.reserve(this->Children.size());
+  for (auto const& child : this->Children) {
+    pids.push_back(child.first);
+  }
+  for (long pid : pids) {
+    auto const it = this->Children.find(pid);
+    if (it != this->Children.end()) {
+      it->second->CheckChildExit();
+    }
+  }
+}
+
 void cmCTestMultiProcessHandler::OnTestLoadRetryCB(uv_timer_t* timer)
 {
   auto self = static_cast<cmCTestMultiProcessHandler*>(timer->data);
   self->StartNextTests();
 }
 
+void cmCTestMultiProcessHandler::StartPressureMonitor()
+{
+  std::string fakePressureValue;
+  unsigned long fakePressure;
+  if (cmSystemTools::GetEnv("__CTEST_FAKE_PRESSURE_FOR_TESTING",
+                            fakePressureValue) &&
+      cmStrToULong(fakePressureValue, &fakePressure)) {
+    this->FakePressureForTesting = fakePressure;
+  } else {
+    cm::optional<std::uint64_t> const cpu =
+      cmCTestSystemMonitor::ReadStallTime("cpu");
+    if (!cpu) {
+      cmCTestLog(this->CTest, WARNING,
+                 "The system does not report the pressure on the CPU, "
+                 "ignoring --test-pressure."
+                   << std::endl);
+      return;
+    }
+    this->CpuStallTime = *cpu;
+    this->MemoryStallTime =
+      cmCTestSystemMonitor::ReadStallTime("memory").value_or(0);
+  }
+  this->PressureCheckTime = std::chrono::steady_clock::now();
+
+  this->PressureTimer.init(this->Loop, this);
+  // The timer must not keep the loop running once the tests are done.
+  uv_unref(this->PressureTimer);
+  this->PressureTimer.start(&cmCTestMultiProcessHandler::OnPressureCheckCB,
+                            1000, 1000);
+}
+
+void cmCTestMultiProcessHandler::OnPressureCheckCB(uv_timer_t* timer)
+{
+  auto self = static_cast<cmCTestMultiProcessHandler*>(timer->data);
+  self->CheckPressure();
+}
+
+void cmCTestMultiProcessHandler::CheckPressure()
+{
+  double pressure;
+  if (this->FakePressureForTesting) {
+    pressure = static_cast<double>(*this->FakePressureForTesting);
+  } else {
+    auto const now = std::chrono::steady_clock::now();
+    cm::optional<std::uint64_t> const cpu =
+      cmCTestSystemMonitor::ReadStallTime("cpu");
+    std::uint64_t const memory =
+      cmCTestSystemMonitor::ReadStallTime("memory").value_or(0);
+    double const elapsed =
+      std::chrono::duration<double, std::micro>(now - this->PressureCheckTime)
+        .count();
+    if (!cpu || elapsed <= 0) {
+      return;
+    }
+
+    // The pressure is the share of the time since the last check in which
+    // some tasks stalled.  Unlike the load average it reacts right away.
+    auto stalled = [](std::uint64_t total, std::uint64_t previous) {
+      return total > previous ? total - previous : 0;
+    };
+    pressure = 100.0 *
+      static_cast<double>(std::max(stalled(*cpu, this->CpuStallTime),
+                                   stalled(memory, this->MemoryStallTime))) /
+      elapsed;
+    this->CpuStallTime = *cpu;
+    this->MemoryStallTime = memory;
+    this->PressureCheckTime = now;
+  }
+
+  // Back off quickly from the number of running tests when the pressure
+  // is too high, and ramp up again slowly.
+  size_t level = this->PressureLevel;
+  if (pressure > static_cast<double>(this->CTest->GetTestPressure())) {
+    level = std::max<size_t>(1, std::min(level, this->RunningCount) / 2);
+  } else {
+    level = std::min(this->ParallelLevel,
+                     level + std::max<size_t>(1, this->ParallelLevel / 8));
+  }
+  if (level == this->PressureLevel) {
+    return;
+  }
+  cmCTestOptionalLog(this->CTest, HANDLER_VERBOSE_OUTPUT,
+                     "Pressure " << static_cast<unsigned long>(pressure)
+                                 << "%, running up to " << level
+                                 << " tests at once" << std::endl,
+                     this->Quiet);
+  bool const raised = level > this->PressureLevel;
+  this->PressureLevel = level;
+  if (raised) {
+    this->StartNextTests();
+  }
+}
+
+void cmCTestMultiProcessHandler::InitMemoryBudget()
+{
+  // Only look at the memory if some test needs a known amount of it.
+  if (std::none_of(this->Properties.begin(), this->Properties.end(),
+                   [](PropertiesMap::value_type const& p) {
+                     return p.second->MemoryRequired > 0;
+                   })) {
+    return;
+  }
+
+  std::string fakeMemoryValue;
+  unsigned long fakeMemory;
+  if (cmSystemTools::GetEnv("__CTEST_FAKE_AVAILABLE_MEMORY_FOR_TESTING",
+                            fakeMemoryValue) &&
+      cmStrToULong(fakeMemoryValue, &fakeMemory)) {
+    this->MemoryBudget = fakeMemory;
+    this->FakeMemoryForTesting = true;
+  } else {
+    this->MemoryBudget = cmCTestSystemMonitor::ReadAvailableMemory();
+  }
+}
+
+bool cmCTestMultiProcessHandler::MemoryFits(
+  unsigned long memory, cm::optional<unsigned long>& available)
+{
+  if (!this->MemoryBudget) {
+    return true;
+  }
+  if (this->MemoryReserved + memory > *this->MemoryBudget) {
+    return false;
+  }
+  // Other processes may have taken memory since the tests started.
+  if (!this->FakeMemoryForTesting) {
+    if (!available) {
+      available = cmCTestSystemMonitor::ReadAvailableMemory();
+    }
+    if (available && memory > *available) {
+      return false;
+    }
+  }
+  return true;
+}
+
 void cmCTestMultiProcessHandler::FinishTestProcess(
   std::unique_ptr<cmCTestRunTest> runner, bool started)
 {
@@ -651,8 +914,16 @@ void cmCTestMultiProcessHandler::FinishTestProcess(
     this->Failed->push_back(properties->Name);
   }
 
-  for (auto& t : this->Tests) {
-    t.second.erase(test);
+  // Release the tests that wait for this one.
+  auto const dependents = this->Dependents.find(test);
+  if (dependents != this->Dependents.end()) {
+    for (int dependent : dependents->second) {
+      auto const t = this->Tests.find(dependent);
+      if (t != this->Tests.end() && t->second.erase(test) &&
+          t->second.empty()) {
+        this->ReadyTests.emplace(this->TestRanks[dependent], dependent);
+      }
+    }
   }
 
   this->TestFinishMap[test] = true;
@@ -661,6 +932,7 @@ void cmCTestMultiProcessHandler::FinishTestProcess(
   this->DeallocateResources(test);
   this->UnlockResources(test);
   this->RunningCount -= GetProcessorsUsed(test);
+  this->MemoryReserved -= properties->MemoryRequired;
 
   for (auto p : properties->Affinity) {
     this->ProcessorsAvailable.insert(p);
@@ -675,128 +947,74 @@ void cmCTestMultiProcessHandler::FinishTestProcess(
 
 void cmCTestMultiProcessHandler::UpdateCostData()
 {
-  std::string fname = this->CTest->GetCostDataFile();
-  std::string tmpout = fname + ".tmp";
-  cmsys::ofstream fout;
-  fout.open(tmpout.c_str());
-
-  PropertiesMap temp = this->Properties;
-
-  if (cmSystemTools::FileExists(fname)) {
-    cmsys::ifstream fin;
-    fin.open(fname.c_str());
-
-    std::string line;
-    while (std::getline(fin, line)) {
-      if (line == "---") {
-        break;
-      }
-      std::vector<std::string> parts = cmSystemTools::SplitString(line, ' ');
-      // Format: <name> <previous_runs> <avg_cost>
-      if (parts.size() < 3) {
-        break;
-      }
-
-      std::string name = parts[0];
-      int prev = atoi(parts[1].c_str());
-      float cost = static_cast<float>(atof(parts[2].c_str()));
-
-      int index = this->SearchByName(name);
-      if (index == -1) {
-        // This test is not in memory. We just rewrite the entry
-        fout << name << " " << prev << " " << cost << "\n";
-      } else {
-        // Update with our new average cost
-        fout << name << " " << this->Properties[index]->PreviousRuns << " "
-             << this->Properties[index]->Cost << "\n";
-        temp.erase(index);
-      }
-    }
-    fin.close();
-    cmSystemTools::RemoveFile(fname);
-  }
-
-  // Add all tests not previously listed in the file
-  for (auto const& i : temp) {
-    fout << i.second->Name << " " << i.second->PreviousRuns << " "
-         << i.second->Cost << "\n";
-  }
+  // The tests that ran have recorded their durations already.
+  this->CostData.Save(this->CTest->GetCostDataFile(), *this->Failed);
+}
 
-  // Write list of failed tests
-  fout << "---\n";
-  for (std::string const& f : *this->Failed) {
-    fout << f << "\n";
-  }
-  fout.close();
-  cmSystemTools::RenameFile(tmpout, fname);
+std::string cmCTestMultiProcessHandler::GetResultCacheFile() const
+{
+  return this->CTest->GetBinaryDir() +
+    "/Testing/Temporary/CTestResultCache.txt";
 }
 
 void cmCTestMultiProcessHandler::ReadCostData()
 {
-  std::string fname = this->CTest->GetCostDataFile();
-
-  if (cmSystemTools::FileExists(fname, true)) {
-    cmsys::ifstream fin;
-    fin.open(fname.c_str());
-    std::string line;
-    while (std::getline(fin, line)) {
-      if (line == "---") {
-        break;
-      }
-
-      std::vector<std::string> parts = cmSystemTools::SplitString(line, ' ');
-
-      // Probably an older version of the file, will be fixed next run
-      if (parts.size() < 3) {
-        fin.close();
-        return;
-      }
-
-      std::string name = parts[0];
-      int prev = atoi(parts[1].c_str());
-      float cost = static_cast<float>(atof(parts[2].c_str()));
-
-      int index = this->SearchByName(name);
-      if (index == -1) {
-        continue;
-      }
+  this->CostData.SetContext(this->CTest->GetConfigType(),
+                            this->ParallelLevel);
+  if (!this->CostData.Load(this->CTest->GetCostDataFile())) {
+    return;
+  }
 
-      this->Properties[index]->PreviousRuns = prev;
-      // When not running in parallel mode, don't use cost data
-      if (this->ParallelLevel > 1 && this->Properties[index] &&
-          this->Properties[index]->Cost == 0) {
-        this->Properties[index]->Cost = cost;
-      }
+  for (auto const& p : this->Properties) {
+    cmCTestCostData::Entry const* entry =
+      this->CostData.Find(p.second->Name);
+    if (!entry) {
+      continue;
     }
-    // Next part of the file is the failed tests
-    while (std::getline(fin, line)) {
-      if (!line.empty()) {
-        this->LastTestsFailed.push_back(line);
-      }
+    float const cost = static_cast<float>(entry->Mean);
+    this->RecordedCosts[p.first] = cost;
+    // When not running in parallel mode, don't use cost data
+    if (this->ParallelLevel > 1 && p.second->Cost == 0) {
+      p.second->Cost = cost;
+    }
+    // The recorded peak memory only limits the tests when asked to
+    // adapt to the pressure on the system.
+    if (p.second->MemoryRequired == 0 && this->CTest->GetTestPressure() > 0) {
+      p.second->MemoryRequired = entry->PeakMemory;
     }
-    fin.close();
   }
 }
 
 int cmCTestMultiProcessHandler::SearchByName(std::string const& name)
 {
-  int index = -1;
-
-  for (auto const& p : this->Properties) {
-    if (p.second->Name == name) {
-      index = p.first;
-    }
-  }
-  return index;
+  auto const it = this->TestNames.find(name);
+  return it != this->TestNames.end() ? it->second : -1;
 }
 
 void cmCTestMultiProcessHandler::CreateTestCostList()
 {
+  // Record which tests wait for each test, so that finishing a test only
+  // looks at those.
+  for (auto const& t : this->Tests) {
+    for (int dependency : t.second) {
+      this->Dependents[dependency].push_back(t.first);
+    }
+  }
+
   if (this->ParallelLevel > 1) {
     CreateParallelTestCostList();
   } else {
     CreateSerialTestCostList();
   }
+
+  // Queue the tests that wait for no other test.
+  for (size_t rank = 0; rank < this->SortedTests.size(); ++rank) {
+    int const test = this->SortedTests[rank];
+    this->TestRanks[test] = rank;
+    if (this->Tests[test].empty()) {
+      this->ReadyTests.emplace(rank, test);
+    }
+  }
 }
 
 void cmCTestMultiProcessHandler::CreateParallelTestCostList()
@@ -810,7 +1028,8 @@ void cmCTestMultiProcessHandler::CreateParallelTestCostList()
   // In parallel test runs add previously failed tests to the front
   // of the cost list and queue other tests for further sorting
   for (auto const& t : this->Tests) {
-    if (cm::contains(this->LastTestsFailed, this->Properties[t.first]->Name)) {
+    if (this->CostData.GetLastTestsFailed().count(
+          this->Properties[t.first]->Name)) {
       // If the test failed last time, it should be run first.
       this->SortedTests.push_back(t.first);
       alreadySortedTests.insert(t.first);
@@ -819,6 +1038,8 @@ void cmCTestMultiProcessHandler::CreateParallelTestCostList()
     }
   }
 
+  size_t const failedCount = this->SortedTests.size();
+
   // In parallel test runs repeatedly move dependencies of the tests on
   // the current dependency level to the next level until no
   // further dependencies exist.
@@ -855,6 +1076,179 @@ void cmCTestMultiProcessHandler::CreateParallelTestCostList()
       }
     }
   }
+
+  // Start the tests with the longest chain of dependent tests first, so
+  // that long chains do not start late.  A test's chain is at least as
+  // long as that of the tests depending on it, so this keeps the order
+  // of the dependency levels where the costs do not decide.
+  std::unordered_map<int, double> costs;
+  for (auto const& t : this->Tests) {
+    costs[t.first] = this->Properties[t.first]->Cost;
+  }
+  std::unordered_map<int, double> criticalPaths;
+  std::unordered_map<int, int> next;
+  this->ComputeCriticalPaths(costs, criticalPaths, next);
+  std::stable_sort(this->SortedTests.begin() + failedCount,
+                   this->SortedTests.end(),
+                   [&criticalPaths](int l, int r) {
+                     return criticalPaths[l] > criticalPaths[r];
+                   });
+}
+
+void cmCTestMultiProcessHandler::ComputeCriticalPaths(
+  std::unordered_map<int, double> const& costs,
+  std::unordered_map<int, double>& lengths,
+  std::unordered_map<int, int>& next)
+{
+  // Visit every test after all tests depending on it.
+  std::unordered_map<int, size_t> waiting;
+  TestList visit;
+  for (auto const& t : this->Tests) {
+    auto const dependents = this->Dependents.find(t.first);
+    if (dependents == this->Dependents.end()) {
+      visit.push_back(t.first);
+    } else {
+      waiting[t.first] = dependents->second.size();
+    }
+  }
+  while (!visit.empty()) {
+    int const test = visit.back();
+    visit.pop_back();
+
+    double longest = 0;
+    auto const dependents = this->Dependents.find(test);
+    if (dependents != this->Dependents.end()) {
+      for (int dependent : dependents->second) {
+        if (lengths[dependent] > longest || next.count(test) == 0) {
+          longest = lengths[dependent];
+          next[test] = dependent;
+        }
+      }
+    }
+    auto const cost = costs.find(test);
+    lengths[test] = longest + (cost != costs.end() ? cost->second : 0);
+
+    for (int dependency : this->Tests[test]) {
+      if (--waiting[dependency] == 0) {
+        visit.push_back(dependency);
+      }
+    }
+  }
+}
+
+double cmCTestMultiProcessHandler::PredictMakespan(
+  std::unordered_map<int, double> const& costs)
+{
+  // Start the tests in the same order and under the same limits as
+  // StartNextTests, except for resources and the test load.
+  std::set<std::pair<size_t, int>> ready = this->ReadyTests;
+  std::unordered_map<int, size_t> waiting;
+  for (auto const& t : this->Tests) {
+    waiting[t.first] = t.second.size();
+  }
+  // Running tests ordered by the time they finish.
+  std::set<std::pair<double, int>> running;
+  double now = 0;
+  size_t used = 0;
+  bool serialRunning = false;
+  for (;;) {
+    for (auto it = ready.begin(); it != ready.end() && !serialRunning;) {
+      int const test = it->second;
+      size_t const processors = this->GetProcessorsUsed(test);
+      bool const serial = this->Properties[test]->RunSerial;
+      if ((serial && used > 0) || used + processors > this->ParallelLevel) {
+        ++it;
+        continue;
+      }
+      auto const cost = costs.find(test);
+      running.emplace(now + (cost != costs.end() ? cost->second : 0), test);
+      used += processors;
+      serialRunning = serial;
+      it = ready.erase(it);
+    }
+    if (running.empty()) {
+      break;
+    }
+
+    auto const finished = *running.begin();
+    running.erase(running.begin());
+    now = finished.first;
+    used -= this->GetProcessorsUsed(finished.second);
+    serialRunning = false;
+    auto const dependents = this->Dependents.find(finished.second);
+    if (dependents != this->Dependents.end()) {
+      for (int dependent : dependents->second) {
+        auto const w = waiting.find(dependent);
+        if (w != waiting.end() && --w->second == 0) {
+          ready.emplace(this->TestRanks[dependent], dependent);
+        }
+      }
+    }
+  }
+  return now;
+}
+
+void cmCTestMultiProcessHandler::PredictSchedule(
+  SchedulePrediction& prediction)
+{
+  // Prefer the average cost of previous runs over the COST property.
+  // With a random schedule the cost is random and says nothing.
+  bool const randomCosts = this->CTest->GetScheduleType() == "Random";
+  for (auto const& t : this->Tests) {
+    auto const recorded = this->RecordedCosts.find(t.first);
+    if (recorded != this->RecordedCosts.end()) {
+      prediction.Costs[t.first] = recorded->second;
+    } else if (!randomCosts && this->Properties[t.first]->Cost > 0) {
+      prediction.Costs[t.first] = this->Properties[t.first]->Cost;
+    } else {
+      ++prediction.UnknownCosts;
+    }
+  }
+
+  // The critical path starts with the test with the longest chain.
+  std::unordered_map<int, double> lengths;
+  std::unordered_map<int, int> next;
+  this->ComputeCriticalPaths(prediction.Costs, lengths, next);
+  int first = -1;
+  for (auto const& t : this->Tests) {
+    if (first == -1 || lengths[t.first] > lengths[first]) {
+      first = t.first;
+    }
+  }
+  if (first != -1) {
+    prediction.CriticalPathLength = lengths[first];
+  }
+  for (int test = first; test != -1;) {
+    prediction.CriticalPath.push_back(test);
+    auto const n = next.find(test);
+    test = n != next.end() ? n->second : -1;
+  }
+
+  prediction.Makespan = this->PredictMakespan(prediction.Costs);
+}
+
+void cmCTestMultiProcessHandler::PrintScheduleReport(
+  SchedulePrediction const& prediction,
+  std::chrono::steady_clock::duration actual)
+{
+  std::ostringstream report;
+  report << std::fixed << std::setprecision(2) << "\nSchedule report:\n"
+         << "  Parallel level:     " << this->ParallelLevel << '\n'
+         << "  Critical path:      " << prediction.CriticalPathLength
+         << " sec\n";
+  for (int test : prediction.CriticalPath) {
+    auto const cost = prediction.Costs.find(test);
+    report << "    " << this->GetName(test) << ' '
+           << (cost != prediction.Costs.end() ? cost->second : 0.0)
+           << " sec\n";
+  }
+  report << "  Predicted makespan: " << prediction.Makespan << " sec\n"
+         << "  Actual makespan:    "
+         << std::chrono::duration<double>(actual).count() << " sec\n";
+  if (prediction.UnknownCosts > 0) {
+    report << "  Tests without cost: " << prediction.UnknownCosts << '\n';
+  }
+  cmCTestLog(this->CTest, HANDLER_OUTPUT, report.str());
 }
 
 void cmCTestMultiProcessHandler::GetAllTestDependencies(int test,
@@ -1048,6 +1442,10 @@ static Json::Value DumpCTestProperties(
     properties.append(DumpCTestProperty(
       "FIXTURES_SETUP", DumpToJsonArray(testProperties.FixturesSetup)));
   }
+  if (!testProperties.InputFiles.empty()) {
+    properties.append(DumpCTestProperty(
+      "INPUT_FILES", DumpToJsonArray(testProperties.InputFiles)));
+  }
   if (!testProperties.Labels.empty()) {
     properties.append(
       DumpCTestProperty("LABELS", DumpToJsonArray(testProperties.Labels)));
@@ -1386,7 +1784,14 @@ void cmCTestMultiProcessHandler::CheckResume()
 void cmCTestMultiProcessHandler::RemoveTest(int index)
 {
   this->EraseTest(index);
-  this->Properties.erase(index);
+  auto const p = this->Properties.find(index);
+  if (p != this->Properties.end()) {
+    auto const name = this->TestNames.find(p->second->Name);
+    if (name != this->TestNames.end() && name->second == index) {
+      this->TestNames.erase(name);
+    }
+    this->Properties.erase(p);
+  }
   this->TestRunningMap[index] = false;
   this->TestFinishMap[index] = true;
   this->Completed++;
@@ -5,23 +5,32 @@
 
 #include "cmConfigure.h" // IWYU pragma: keep
 
+#include <chrono>
+#include <cstdint>
 #include <map>
 #include <memory>
 #include <set>
 #include <string>
+#include <unordered_map>
+#include <utility>
 #include <vector>
 
+#include <cm/optional>
+
 #include <cm3p/uv.h>
 #include <stddef.h>
 
 #include "cmCTest.h"
+#include "cmCTestCostData.h"
 #include "cmCTestResourceAllocator.h"
+#include "cmCTestResultCache.h"
 #include "cmCTestTestHandler.h"
 #include "cmUVHandlePtr.h"
 
 struct cmCTestBinPackerAllocation;
 class cmCTestResourceSpec;
 class cmCTestRunTest;
+class cmProcess;
 
 /** \class cmCTestMultiProcessHandler
  * \brief run parallel ctest
@@ -85,6 +94,13 @@ public:
 
   cmCTestTestHandler* GetTestHandler() { return this->TestHandler; }
 
+  // Watch for the exit of processes spawned without libuv, with one
+  // SIGCHLD handler for all of them.  The handler must be started before
+  // a process is spawned, so that its exit cannot be missed.
+  int StartChildSignal();
+  void WatchChild(long pid, cmProcess* process);
+  void UnwatchChild(long pid);
+
   void SetRepeatMode(cmCTest::Repeat mode, int count)
   {
     this->RepeatMode = mode;
@@ -111,6 +127,7 @@ protected:
 
   void UpdateCostData();
   void ReadCostData();
+  std::string GetResultCacheFile() const;
   // Return index of a test based on its name
   int SearchByName(std::string const& name);
 
@@ -121,6 +138,30 @@ protected:
 
   void CreateParallelTestCostList();
 
+  // Compute the length of the longest chain of tests starting with each
+  // test: its own cost plus the longest chain of the tests depending on
+  // it.  Also record the next test on that chain.
+  void ComputeCriticalPaths(std::unordered_map<int, double> const& costs,
+                            std::unordered_map<int, double>& lengths,
+                            std::unordered_map<int, int>& next);
+
+  // Predict the test run from the costs of previous runs for
+  // --schedule-report.
+  struct SchedulePrediction
+  {
+    std::unordered_map<int, double> Costs;
+    size_t UnknownCosts = 0;
+    TestList CriticalPath;
+    double CriticalPathLength = 0;
+    double Makespan = 0;
+  };
+  void PredictSchedule(SchedulePrediction& prediction);
+  // Simulate the test run with the given costs to predict how long it
+  // takes.
+  double PredictMakespan(std::unordered_map<int, double> const& costs);
+  void PrintScheduleReport(SchedulePrediction const& prediction,
+                           std::chrono::steady_clock::duration actual);
+
   // Removes the checkpoint file
   void MarkFinished();
   void EraseTest(int index);
@@ -128,6 +169,22 @@ protected:
 
   static void OnTestLoadRetryCB(uv_timer_t* timer);
 
+  static void OnChildSignalCB(uv_signal_t* signal, int signum);
+  void OnChildSignal();
+
+  // Adapt the number of tests running at once to the pressure on the
+  // CPU and memory for --test-pressure.
+  void StartPressureMonitor();
+  static void OnPressureCheckCB(uv_timer_t* timer);
+  void CheckPressure();
+
+  // Check whether a test needing the given memory fits next to the
+  // running tests.  The memory available now is read once per call of
+  // StartNextTests.
+  void InitMemoryBudget();
+  bool MemoryFits(unsigned long memory,
+                  cm::optional<unsigned long>& available);
+
   void RemoveTest(int index);
   // Check if we need to resume an interrupted test set
   void CheckResume();
@@ -160,9 +217,24 @@ protected:
   void DeallocateResources(int index);
   bool AllResourcesAvailable();
 
-  // map from test number to set of depend tests
+  // map from test number to set of depend tests that have not finished
   TestMap Tests;
+  // All tests in the order in which they should be started
   TestList SortedTests;
+  // map from test number to its position in SortedTests
+  std::unordered_map<int, size_t> TestRanks;
+  // map from test number to the tests that depend on it
+  std::unordered_map<int, TestList> Dependents;
+  // Tests waiting for no other test, ordered by their position in
+  // SortedTests
+  std::set<std::pair<size_t, int>> ReadyTests;
+  // map from test name to test number
+  std::unordered_map<std::string, int> TestNames;
+  // Duration history of the tests and the tests that failed last time
+  cmCTestCostData CostData;
+  cmCTestResultCache ResultCache;
+  // Average cost of the tests in previous runs
+  std::unordered_map<int, float> RecordedCosts;
   // Total number of tests we'll be running
   size_t Total;
   // Number of tests that are complete
@@ -178,7 +250,6 @@ protected:
   std::map<int, std::string> TestOutput;
   std::vector<std::string>* Passed;
   std::vector<std::string>* Failed;
-  std::vector<std::string> LastTestsFailed;
   std::set<std::string> LockedResources;
   std::map<int,
            std::vector<std::map<std::string, std::vector<ResourceAllocation>>>>
@@ -191,7 +262,26 @@ protected:
   unsigned long TestLoad;
   unsigned long FakeLoadForTesting;
   uv_loop_t Loop;
+  // The environment the tests start from, "NAME=value" entries
+  std::vector<std::string> Environment;
   cm::uv_timer_ptr TestLoadRetryTimer;
+  // Processes spawned without libuv by pid, and the handler of the
+  // SIGCHLD signal telling that one of them may have exited
+  std::unordered_map<long, cmProcess*> Children;
+  cm::uv_signal_ptr ChildSignal;
+  // Number of process slots allowed under the current pressure
+  size_t PressureLevel = 1;
+  std::uint64_t CpuStallTime = 0;
+  std::uint64_t MemoryStallTime = 0;
+  std::chrono::steady_clock::time_point PressureCheckTime;
+  cm::uv_timer_ptr PressureTimer;
+  cm::optional<unsigned long> FakePressureForTesting;
+  // Memory in MiB available to the tests when they started, only known
+  // if some test needs a known amount of memory
+  cm::optional<unsigned long> MemoryBudget;
+  // Memory in MiB needed by the running tests
+  unsigned long MemoryReserved = 0;
+  bool FakeMemoryForTesting = false;
   cmCTestTestHandler* TestHandler;
   cmCTest* CTest;
   bool HasCycles;
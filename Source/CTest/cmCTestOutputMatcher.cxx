@@ -0,0 +1,444 @@
+/* Distributed under the OSI-approved BSD 3-Clause License.  See accompanying
+   file Copyright.txt or https://cmake.org/licensing for details.  */
+#include "cmCTestOutputMatcher.h"
+
+#include <algorithm>
+#include <utility>
+
+namespace {
+// Deterministic states kept before all are discarded.  Every state takes
+// about a kilobyte for its transitions.
+std::size_t const MaxStates = 512;
+
+// Same limit as cmsys::RegularExpression, which counts the whole
+// expression as the first group.
+int const MaxGroups = 9;
+
+bool IsRepeat(char c)
+{
+  return c == '*' || c == '+' || c == '?';
+}
+}
+
+/** Compile a regular expression into nodes the way
+    cmsys::RegularExpression parses it, including the errors.  */
+class cmCTestOutputMatcher::Parser
+{
+public:
+  Parser(std::vector<Node>& nodes, std::string const& regex)
+    : Nodes(nodes)
+    , Regex(regex.c_str())
+  {
+  }
+
+  // A part of the automaton with one entry and one exit, a Jump node
+  // whose target is not set yet.
+  struct Fragment
+  {
+    int Start;
+    int End;
+    bool HasWidth;
+  };
+
+  bool Parse(Fragment& whole)
+  {
+    return this->ParseAlternatives(whole) && this->Regex[this->Pos] == '\0';
+  }
+
+private:
+  int AddNode(Node::Kind type, int out = -1, int out2 = -1)
+  {
+    Node node;
+    node.Type = type;
+    node.Out = out;
+    node.Out2 = out2;
+    this->Nodes.push_back(node);
+    return static_cast<int>(this->Nodes.size() - 1);
+  }
+
+  Fragment Single(Node::Kind type, bool hasWidth)
+  {
+    int const end = this->AddNode(Node::Jump);
+    int const start = this->AddNode(type, end);
+    return Fragment{ start, end, hasWidth };
+  }
+
+  Fragment Chars(std::bitset<256> const& set)
+  {
+    Fragment f = this->Single(Node::Chars, true);
+    this->Nodes[f.Start].Set = set;
+    return f;
+  }
+
+  char Peek() const { return this->Regex[this->Pos]; }
+
+  bool ParseAlternatives(Fragment& f)
+  {
+    Fragment branch;
+    if (!this->ParseBranch(branch)) {
+      return false;
+    }
+    f = branch;
+    while (this->Peek() == '|') {
+      ++this->Pos;
+      if (!this->ParseBranch(branch)) {
+        return false;
+      }
+      int const end = this->AddNode(Node::Jump);
+      this->Nodes[f.End].Out = end;
+      this->Nodes[branch.End].Out = end;
+      f.Start = this->AddNode(Node::Split, f.Start, branch.Start);
+      f.End = end;
+      f.HasWidth = f.HasWidth && branch.HasWidth;
+    }
+    return true;
+  }
+
+  bool ParseBranch(Fragment& f)
+  {
+    f = this->Single(Node::Jump, false);
+    while (this->Peek() != '\0' && this->Peek() != '|' &&
+           this->Peek() != ')') {
+      Fragment piece;
+      if (!this->ParsePiece(piece)) {
+        return false;
+      }
+      this->Nodes[f.End].Out = piece.Start;
+      f.End = piece.End;
+      f.HasWidth = f.HasWidth || piece.HasWidth;
+    }
+    return true;
+  }
+
+  bool ParsePiece(Fragment& f)
+  {
+    Fragment atom;
+    if (!this->ParseAtom(atom)) {
+      return false;
+    }
+    char const op = this->Peek();
+    if (!IsRepeat(op)) {
+      f = atom;
+      return true;
+    }
+    if (!atom.HasWidth && op != '?') {
+      return false;
+    }
+    ++this->Pos;
+    if (IsRepeat(this->Peek())) {
+      return false;
+    }
+
+    int const end = this->AddNode(Node::Jump);
+    int const split = this->AddNode(Node::Split, atom.Start, end);
+    if (op == '?') {
+      this->Nodes[atom.End].Out = end;
+      f = Fragment{ split, end, false };
+    } else {
+      this->Nodes[atom.End].Out = split;
+      f = Fragment{ op == '*' ? split : atom.Start, end, op == '+' };
+    }
+    return true;
+  }
+
+  bool ParseAtom(Fragment& f)
+  {
+    char const c = this->Regex[this->Pos++];
+    std::bitset<256> set;
+    switch (c) {
+      case '^':
+        f = this->Single(Node::Begin, false);
+        return true;
+      case '$':
+        f = this->Single(Node::End, false);
+        return true;
+      case '.':
+        // Any character; the output never contains a null character.
+        set.set();
+        f = this->Chars(set);
+        return true;
+      case '[':
+        return this->ParseClass(f);
+      case '(':
+        if (++this->Groups > MaxGroups || !this->ParseAlternatives(f) ||
+            this->Regex[this->Pos++] != ')') {
+          return false;
+        }
+        return true;
+      case '\\':
+        if (this->Peek() == '\0') {
+          return false;
+        }
+        set.set(static_cast<unsigned char>(this->Regex[this->Pos++]));
+        f = this->Chars(set);
+        return true;
+      case '\0':
+      case '|':
+      case ')':
+      case '?':
+      case '+':
+      case '*':
+        return false;
+      default:
+        set.set(static_cast<unsigned char>(c));
+        f = this->Chars(set);
+        return true;
+    }
+  }
+
+  bool ParseClass(Fragment& f)
+  {
+    bool const complement = this->Peek() == '^';
+    if (complement) {
+      ++this->Pos;
+    }
+    std::bitset<256> set;
+    if (this->Peek() == ']' || this->Peek() == '-') {
+      set.set(static_cast<unsigned char>(this->Regex[this->Pos++]));
+    }
+    while (this->Peek() != '\0' && this->Peek() != ']') {
+      if (this->Peek() == '-') {
+        ++this->Pos;
+        if (this->Peek() == ']' || this->Peek() == '\0') {
+          set.set('-');
+        } else {
+          // The range starts after the character before the '-', which
+          // was added already.
+          int first =
+            static_cast<unsigned char>(this->Regex[this->Pos - 2]) + 1;
+          int const last = static_cast<unsigned char>(this->Regex[this->Pos]);
+          if (first > last + 1) {
+            return false;
+          }
+          for (; first <= last; ++first) {
+            set.set(static_cast<std::size_t>(first));
+          }
+          ++this->Pos;
+        }
+      } else {
+        set.set(static_cast<unsigned char>(this->Regex[this->Pos++]));
+      }
+    }
+    if (this->Peek() != ']') {
+      return false;
+    }
+    ++this->Pos;
+    // The null character that ends the class never matches.
+    set.reset(0);
+    if (complement) {
+      set.flip();
+      set.reset(0);
+    }
+    f = this->Chars(set);
+    return true;
+  }
+
+  std::vector<Node>& Nodes;
+  char const* Regex;
+  std::size_t Pos = 0;
+  int Groups = 0;
+};
+
+std::size_t cmCTestOutputMatcher::Add(std::string const& regex)
+{
+  this->Regexes.push_back(regex);
+  return this->Regexes.size() - 1;
+}
+
+void cmCTestOutputMatcher::Compile()
+{
+  this->Compiled = true;
+  this->Found.assign(this->Regexes.size(), false);
+
+  // The start node splits into all regular expressions.
+  for (std::size_t i = 0; i < this->Regexes.size(); ++i) {
+    std::size_t const size = this->Nodes.size();
+    Parser::Fragment f;
+    if (!Parser(this->Nodes, this->Regexes[i]).Parse(f)) {
+      this->Nodes.resize(size);
+      continue;
+    }
+    Node match;
+    match.Type = Node::Match;
+    match.Index = i;
+    this->Nodes.push_back(match);
+    this->Nodes[f.End].Out = static_cast<int>(this->Nodes.size() - 1);
+
+    Node split;
+    split.Type = Node::Split;
+    split.Out = f.Start;
+    split.Out2 = this->Start;
+    this->Nodes.push_back(split);
+    this->Start = static_cast<int>(this->Nodes.size() - 1);
+  }
+
+  std::vector<int> nodes;
+  this->Closure({ this->Start }, true, false, nodes);
+  this->Current = this->AddState(std::move(nodes), true);
+  this->Record(this->States[this->Current].Matches);
+}
+
+void cmCTestOutputMatcher::Closure(std::vector<int> seeds, bool atBegin,
+                                   bool atEnd, std::vector<int>& nodes) const
+{
+  // Follow the nodes that consume no output, and keep those that do and
+  // those that cannot be passed yet.
+  std::vector<bool> seen(this->Nodes.size(), false);
+  while (!seeds.empty()) {
+    int const n = seeds.back();
+    seeds.pop_back();
+    if (n < 0 || seen[n]) {
+      continue;
+    }
+    seen[n] = true;
+    Node const& node = this->Nodes[n];
+    switch (node.Type) {
+      case Node::Split:
+        seeds.push_back(node.Out2);
+        seeds.push_back(node.Out);
+        break;
+      case Node::Jump:
+        seeds.push_back(node.Out);
+        break;
+      case Node::Begin:
+        if (atBegin) {
+          seeds.push_back(node.Out);
+        }
+        break;
+      case Node::End:
+        if (atEnd) {
+          seeds.push_back(node.Out);
+        } else {
+          nodes.push_back(n);
+        }
+        break;
+      case Node::Chars:
+      case Node::Match:
+        nodes.push_back(n);
+        break;
+    }
+  }
+  std::sort(nodes.begin(), nodes.end());
+}
+
+int cmCTestOutputMatcher::AddState(std::vector<int> nodes, bool initial)
+{
+  // The initial state is never shared because "^" can still match there.
+  if (!initial) {
+    auto const it = this->StateIds.find(nodes);
+    if (it != this->StateIds.end()) {
+      return it->second;
+    }
+  }
+
+  State state;
+  for (int n : nodes) {
+    if (this->Nodes[n].Type == Node::Match) {
+      state.Matches.push_back(this->Nodes[n].Index);
+    }
+  }
+  state.Nodes = nodes;
+  int const id = static_cast<int>(this->States.size());
+  this->HasMatches.push_back(state.Matches.empty() ? 0 : 1);
+  this->Next.resize(this->Next.size() + 256, -1);
+  this->States.push_back(std::move(state));
+  if (!initial) {
+    this->StateIds.emplace(std::move(nodes), id);
+  }
+  return id;
+}
+
+int cmCTestOutputMatcher::Step(int state, unsigned char c)
+{
+  std::vector<int> seeds;
+  for (int n : this->States[state].Nodes) {
+    Node const& node = this->Nodes[n];
+    if (node.Type == Node::Chars && node.Set.test(c)) {
+      seeds.push_back(node.Out);
+    }
+  }
+  // A match may start at any position.
+  seeds.push_back(this->Start);
+  std::vector<int> nodes;
+  this->Closure(std::move(seeds), false, false, nodes);
+
+  if (this->States.size() >= MaxStates) {
+    this->States.clear();
+    this->StateIds.clear();
+    this->Next.clear();
+    this->HasMatches.clear();
+    return this->AddState(std::move(nodes), false);
+  }
+  int const next = this->AddState(std::move(nodes), false);
+  this->Next[static_cast<std::size_t>(state) * 256 + c] = next;
+  return next;
+}
+
+void cmCTestOutputMatcher::Record(std::vector<std::size_t> const& matches)
+{
+  for (std::size_t i : matches) {
+    this->Found[i] = true;
+  }
+}
+
+void cmCTestOutputMatcher::Feed(cm::string_view data)
+{
+  if (!this->Compiled) {
+    this->Compile();
+  }
+  if (this->Start < 0 || data.empty()) {
+    return;
+  }
+  this->Begun = true;
+  int state = this->Current;
+  int const* transitions = this->Next.data();
+  char const* hasMatches = this->HasMatches.data();
+  for (char ch : data) {
+    unsigned char const c = static_cast<unsigned char>(ch);
+    int next = transitions[static_cast<std::size_t>(state) * 256 + c];
+    if (next < 0) {
+      next = this->Step(state, c);
+      transitions = this->Next.data();
+      hasMatches = this->HasMatches.data();
+    }
+    state = next;
+    if (hasMatches[state]) {
+      this->Record(this->States[state].Matches);
+    }
+  }
+  this->Current = state;
+}
+
+bool cmCTestOutputMatcher::IsFound(std::size_t index)
+{
+  if (!this->Compiled) {
+    this->Compile();
+  }
+  if (this->Found[index]) {
+    return true;
+  }
+  if (this->Start < 0) {
+    return false;
+  }
+
+  // Pass the "$" nodes waiting in the current state.
+  State& state = this->States[this->Current];
+  if (!state.EndMatchesKnown) {
+    std::vector<int> seeds;
+    for (int n : state.Nodes) {
+      if (this->Nodes[n].Type == Node::End) {
+        seeds.push_back(this->Nodes[n].Out);
+      }
+    }
+    std::vector<int> nodes;
+    this->Closure(std::move(seeds), !this->Begun, true, nodes);
+    for (int n : nodes) {
+      if (this->Nodes[n].Type == Node::Match) {
+        state.EndMatches.push_back(this->Nodes[n].Index);
+      }
+    }
+    state.EndMatchesKnown = true;
+  }
+  return std::find(state.EndMatches.begin(), state.EndMatches.end(),
+                   index) != state.EndMatches.end();
+}
@@ -0,0 +1,95 @@
+/* Distributed under the OSI-approved BSD 3-Clause License.  See accompanying
+   file Copyright.txt or https://cmake.org/licensing for details.  */
+#ifndef cmCTestOutputMatcher_h
+#define cmCTestOutputMatcher_h
+
+#include "cmConfigure.h" // IWYU pragma: keep
+
+#include <bitset>
+#include <cstddef>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <cm/string_view>
+
+/** \class cmCTestOutputMatcher
+ * \brief Search output for several regular expressions at once.
+ *
+ * The regular expressions have the syntax of cmsys::RegularExpression and
+ * are compiled together into one automaton.  The output is scanned once as
+ * it arrives, in pieces of any size, and a regular expression is found
+ * exactly if cmsys::RegularExpression::find finds it in the output so far.
+ * As in there, "^" matches at the start of the output only and "$" at its
+ * end.  The states of the deterministic automaton are built as the output
+ * needs them, and discarded if there are too many.
+ */
+class cmCTestOutputMatcher
+{
+public:
+  /** Add a regular expression before any output is scanned, and return
+      its index.  One that does not compile is never found, just like an
+      invalid cmsys::RegularExpression.  */
+  std::size_t Add(std::string const& regex);
+
+  /** Scan more output.  */
+  void Feed(cm::string_view data);
+
+  /** Whether the regular expression with the given index matches the
+      output scanned so far.  */
+  bool IsFound(std::size_t index);
+
+private:
+  struct Node
+  {
+    enum Kind
+    {
+      Chars, // Match one of the characters in Set.
+      Split, // Continue at Out and Out2.
+      Jump,  // Continue at Out.
+      Begin, // Continue at Out at the start of the output.
+      End,   // Continue at Out at the end of the output.
+      Match  // Regular expression Index found.
+    };
+    Kind Type;
+    int Out = -1;
+    int Out2 = -1;
+    std::size_t Index = 0;
+    std::bitset<256> Set;
+  };
+
+  struct State
+  {
+    std::vector<int> Nodes;
+    std::vector<std::size_t> Matches;
+    // Indices matched if the output ends here, once computed.
+    std::vector<std::size_t> EndMatches;
+    bool EndMatchesKnown = false;
+  };
+
+  class Parser;
+
+  void Compile();
+  void Closure(std::vector<int> seeds, bool atBegin, bool atEnd,
+               std::vector<int>& nodes) const;
+  int AddState(std::vector<int> nodes, bool initial);
+  int Step(int state, unsigned char c);
+  void Record(std::vector<std::size_t> const& matches);
+
+  std::vector<std::string> Regexes;
+  std::vector<Node> Nodes;
+  int Start = -1;
+  bool Compiled = false;
+  bool Begun = false;
+
+  std::vector<State> States;
+  // The state following each state on each character, or -1 if it is not
+  // known yet, and whether a state has matches.
+  std::vector<int> Next;
+  std::vector<char> HasMatches;
+  std::map<std::vector<int>, int> StateIds;
+  int Current = -1;
+  std::vector<bool> Found;
+};
+
+#endif
@@ -0,0 +1,205 @@
+/* Distributed under the OSI-approved BSD 3-Clause License.  See accompanying
+   file Copyright.txt or https://cmake.org/licensing for details.  */
+#include "cmCTestResultCache.h"
+
+#include <utility>
+
+#include "cmsys/FStream.hxx"
+
+#include "cmCryptoHash.h"
+#include "cmFileLock.h"
+#include "cmFileLockResult.h"
+#include "cmGeneratedFileStream.h"
+#include "cmStringAlgorithms.h"
+#include "cmSystemTools.h"
+
+#if defined(CMAKE_USE_ELF_PARSER)
+#  include "cmELF.h"
+#endif
+
+bool cmCTestResultCache::Load(std::string const& fname)
+{
+  cmsys::ifstream fin(fname.c_str());
+  if (!fin) {
+    return false;
+  }
+  std::string line;
+  while (cmSystemTools::GetLineFromStream(fin, line)) {
+    // Skip a malformed line, its test runs again.
+    std::string::size_type const space = line.find(' ');
+    if (space == 0 || space == std::string::npos ||
+        space + 1 == line.size()) {
+      continue;
+    }
+    this->Fingerprints[line.substr(space + 1)] = line.substr(0, space);
+  }
+  return true;
+}
+
+bool cmCTestResultCache::Save(std::string const& fname,
+                              std::set<std::string> const& names) const
+{
+  // Another ctest may have saved its results since this one loaded them,
+  // so read the file again and write it back without letting others in.
+  std::string const lockFile = fname + ".lock";
+  cmFileLock lock;
+  if (!cmSystemTools::Touch(lockFile, true) ||
+      !lock.Lock(lockFile, static_cast<unsigned long>(-1)).IsOk()) {
+    return false;
+  }
+  cmCTestResultCache saved;
+  saved.Load(fname);
+  for (std::string const& name : this->Changed) {
+    auto const it = this->Fingerprints.find(name);
+    if (it != this->Fingerprints.end()) {
+      saved.Fingerprints[name] = it->second;
+    } else {
+      saved.Fingerprints.erase(name);
+    }
+  }
+
+  cmGeneratedFileStream fout(fname);
+  if (!fout) {
+    return false;
+  }
+  for (auto const& f : saved.Fingerprints) {
+    if (names.count(f.first)) {
+      fout << f.second << ' ' << f.first << '\n';
+    }
+  }
+  return fout.Close();
+}
+
+bool cmCTestResultCache::IsCached(std::string const& name,
+                                  std::string const& fingerprint) const
+{
+  auto const it = this->Fingerprints.find(name);
+  return it != this->Fingerprints.end() && it->second == fingerprint;
+}
+
+void cmCTestResultCache::Record(std::string const& name,
+                                std::string fingerprint)
+{
+  this->Fingerprints[name] = std::move(fingerprint);
+  this->Changed.insert(name);
+}
+
+void cmCTestResultCache::Remove(std::string const& name)
+{
+  this->Fingerprints.erase(name);
+  this->Changed.insert(name);
+}
+
+void cmCTestResultCache::AddString(cmCryptoHash& hash,
+                                   std::string const& value)
+{
+  // Include the terminating null character.
+  hash.Append(value.c_str(), value.size() + 1);
+}
+
+void cmCTestResultCache::AddFile(cmCryptoHash& hash, std::string const& path)
+{
+  AddString(hash, path);
+  std::string const& content = this->HashFile(path);
+  AddString(hash, content.empty() ? "missing" : content);
+}
+
+std::string const& cmCTestResultCache::HashFile(std::string const& path)
+{
+  FileHash& entry = this->FileHashes[path];
+  cmFileTime time;
+  if (!time.Load(path)) {
+    entry = FileHash();
+    return entry.Hash;
+  }
+  unsigned long const size = cmSystemTools::FileLength(path);
+  if (entry.Hash.empty() || entry.Time.Differ(time) || entry.Size != size) {
+    entry.Time = time;
+    entry.Size = size;
+    entry.Hash = cmCryptoHash(cmCryptoHash::AlgoSHA256).HashFile(path);
+  }
+  return entry.Hash;
+}
+
+void cmCTestResultCache::AddExecutable(
+  cmCryptoHash& hash, std::string const& path,
+  std::vector<std::string> const& environment)
+{
+  this->AddFile(hash, path);
+
+  std::vector<std::string> libraryPath;
+  for (std::string const& var : environment) {
+    if (cmHasLiteralPrefix(var, "LD_LIBRARY_PATH=")) {
+      libraryPath = cmTokenize(var.substr(16), ":");
+    }
+  }
+  std::set<std::string> added;
+  added.insert(path);
+  this->AddLibraries(hash, path, std::vector<std::string>(), libraryPath,
+                     added);
+}
+
+void cmCTestResultCache::AddLibraries(
+  cmCryptoHash& hash, std::string const& path,
+  std::vector<std::string> const& rpath,
+  std::vector<std::string> const& libraryPath, std::set<std::string>& added)
+{
+#if defined(CMAKE_USE_ELF_PARSER)
+  cmELF elf(path.c_str());
+  if (!elf) {
+    return;
+  }
+  std::string const origin = cmSystemTools::GetFilenamePath(path);
+  auto expand = [&origin](cmELF::StringEntry const* se) {
+    std::vector<std::string> dirs;
+    if (se) {
+      dirs = cmTokenize(se->Value, ":");
+      for (std::string& dir : dirs) {
+        cmSystemTools::ReplaceString(dir, "$ORIGIN", origin.c_str());
+        cmSystemTools::ReplaceString(dir, "${ORIGIN}", origin.c_str());
+      }
+    }
+    return dirs;
+  };
+
+  // The RPATH of a file and of the files loading it is searched first,
+  // unless the file has a RUNPATH, which is searched after the
+  // LD_LIBRARY_PATH.
+  std::vector<std::string> const runpath = expand(elf.GetRunPath());
+  std::vector<std::string> ownRPath;
+  if (runpath.empty()) {
+    ownRPath = expand(elf.GetRPath());
+    ownRPath.insert(ownRPath.end(), rpath.begin(), rpath.end());
+  }
+  std::vector<std::string> dirs = ownRPath;
+  dirs.insert(dirs.end(), libraryPath.begin(), libraryPath.end());
+  dirs.insert(dirs.end(), runpath.begin(), runpath.end());
+
+  for (std::string const& name : elf.GetNeededLibraries()) {
+    std::string found;
+    if (name.find('/') != std::string::npos) {
+      found = name;
+    } else {
+      for (std::string const& dir : dirs) {
+        std::string const candidate = cmStrCat(dir, '/', name);
+        if (cmSystemTools::FileExists(candidate, true)) {
+          found = candidate;
+          break;
+        }
+      }
+    }
+    if (found.empty()) {
+      AddString(hash, name);
+    } else if (added.insert(found).second) {
+      this->AddFile(hash, found);
+      this->AddLibraries(hash, found, ownRPath, libraryPath, added);
+    }
+  }
+#else
+  static_cast<void>(hash);
+  static_cast<void>(path);
+  static_cast<void>(rpath);
+  static_cast<void>(libraryPath);
+  static_cast<void>(added);
+#endif
+}
@@ -0,0 +1,94 @@
+/* Distributed under the OSI-approved BSD 3-Clause License.  See accompanying
+   file Copyright.txt or https://cmake.org/licensing for details.  */
+#ifndef cmCTestResultCache_h
+#define cmCTestResultCache_h
+
+#include "cmConfigure.h" // IWYU pragma: keep
+
+#include <map>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "cmFileTime.h"
+
+class cmCryptoHash;
+
+/** \class cmCTestResultCache
+ * \brief Fingerprints of the tests that passed, stored in
+ *        CTestResultCache.txt.
+ *
+ * Every line holds the fingerprint of the inputs of a test that passed
+ * with them, followed by the name of the test:
+ *
+ *   <fingerprint> <name>
+ *
+ * A test whose fingerprint is unchanged need not run again.  Concurrent
+ * runs in the same build tree, e.g. of different shards, merge their
+ * results into the file under a lock.  The hashes
+ * of the files that go into the fingerprints are kept for the run, as
+ * long as the files keep their size and modification time, so that an
+ * executable or library used by many tests is read once.
+ */
+class cmCTestResultCache
+{
+public:
+  /** Read a result cache file.  Returns false if it cannot be read, which
+      is the case before tests have run with the cache for the first
+      time.  */
+  bool Load(std::string const& fname);
+
+  /** Merge the tests recorded and removed since loading into the result
+      cache file as it is now, and forget the tests not among the given
+      names of all tests.  */
+  bool Save(std::string const& fname,
+            std::set<std::string> const& names) const;
+
+  /** Whether the test passed with the given fingerprint.  */
+  bool IsCached(std::string const& name,
+                std::string const& fingerprint) const;
+
+  /** Record that the test passed with the given fingerprint.  */
+  void Record(std::string const& name, std::string fingerprint);
+
+  /** Forget the test, e.g. because it failed.  */
+  void Remove(std::string const& name);
+
+  /** Add a string to the hash, ended so that it cannot run into the
+      next one.  */
+  static void AddString(cmCryptoHash& hash, std::string const& value);
+
+  /** Add the name and content of a file to the hash.  A file that cannot
+      be read is added as missing.  */
+  void AddFile(cmCryptoHash& hash, std::string const& path);
+
+  /** Add an executable and the shared libraries it loads to the hash.
+      The libraries are searched the way the dynamic loader does, in the
+      RPATH and RUNPATH of the files and the LD_LIBRARY_PATH given in the
+      environment of the test.  A library that is not found in these is
+      assumed to be a system library and only its name is added.  */
+  void AddExecutable(cmCryptoHash& hash, std::string const& path,
+                     std::vector<std::string> const& environment);
+
+private:
+  struct FileHash
+  {
+    cmFileTime Time;
+    unsigned long Size = 0;
+    std::string Hash;
+  };
+
+  std::string const& HashFile(std::string const& path);
+  void AddLibraries(cmCryptoHash& hash, std::string const& path,
+                    std::vector<std::string> const& rpath,
+                    std::vector<std::string> const& libraryPath,
+                    std::set<std::string>& added);
+
+  std::map<std::string, std::string> Fingerprints;
+  // Tests recorded or removed since loading
+  std::set<std::string> Changed;
+  std::unordered_map<std::string, FileHash> FileHashes;
+};
+
+#endif
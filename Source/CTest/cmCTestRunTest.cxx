@@ -2,6 +2,7 @@
    file Copyright.txt or https://cmake.org/licensing for details.  */
 #include "cmCTestRunTest.h"
 
+#include <algorithm>
 #include <chrono>
 #include <cstddef> // IWYU pragma: keep
 #include <cstdint>
@@ -10,20 +11,53 @@
 #include <iomanip>
 #include <ratio>
 #include <sstream>
+#include <string>
 #include <utility>
 
 #include <cm/memory>
 
+#include <cm3p/uv.h>
+
 #include "cmsys/RegularExpression.hxx"
+#include "cmsys/String.h"
 
 #include "cmCTest.h"
 #include "cmCTestMemCheckHandler.h"
 #include "cmCTestMultiProcessHandler.h"
+#include "cmCTestResultCache.h"
+#include "cmCryptoHash.h"
 #include "cmProcess.h"
 #include "cmStringAlgorithms.h"
 #include "cmSystemTools.h"
 #include "cmWorkingDirectory.h"
 
+namespace {
+// Set a "NAME=value" variable in an environment, or remove a variable
+// given by name alone, like cmSystemTools::PutEnv.
+void PutEnv(std::vector<std::string>& env, std::string const& var)
+{
+  std::string::size_type const length = std::min(var.find('='), var.size());
+  auto const it =
+    std::find_if(env.begin(), env.end(), [&](std::string const& e) {
+      return e.size() > length && e[length] == '=' &&
+#if defined(_WIN32)
+        cmsysString_strncasecmp(e.c_str(), var.c_str(), length) == 0;
+#else
+        e.compare(0, length, var, 0, length) == 0;
+#endif
+    });
+  if (length == var.size()) {
+    if (it != env.end()) {
+      env.erase(it);
+    }
+  } else if (it != env.end()) {
+    *it = var;
+  } else {
+    env.push_back(var);
+  }
+}
+}
+
 cmCTestRunTest::cmCTestRunTest(cmCTestMultiProcessHandler& multiHandler)
   : MultiTestHandler(multiHandler)
 {
@@ -36,37 +70,120 @@ cmCTestRunTest::cmCTestRunTest(cmCTestMultiProcessHandler& multiHandler)
   this->TestResult.Properties = nullptr;
 }
 
-void cmCTestRunTest::CheckOutput(std::string const& line)
+void cmCTestRunTest::CheckOutput(cm::string_view line)
 {
   cmCTestLog(this->CTest, HANDLER_VERBOSE_OUTPUT,
              this->GetIndex() << ": " << line << std::endl);
-  this->ProcessOutput += line;
-  this->ProcessOutput += "\n";
+  this->TestOutput.AppendLine(line);
+  this->OutputMatcher.Feed(line);
+  this->OutputMatcher.Feed("\n");
+  if (!this->FullOutputRequested &&
+      line.find("CTEST_FULL_OUTPUT") != cm::string_view::npos) {
+    this->FullOutputRequested = true;
+  }
+  if (this->TestOutput.IsSpilled()) {
+    this->CollectSpilledMeasurements(line);
+  }
 
   // Check for TIMEOUT_AFTER_MATCH property.
-  if (!this->TestProperties->TimeoutRegularExpressions.empty()) {
-    for (auto& reg : this->TestProperties->TimeoutRegularExpressions) {
-      if (reg.first.find(this->ProcessOutput)) {
-        cmCTestLog(this->CTest, HANDLER_VERBOSE_OUTPUT,
-                   this->GetIndex()
-                     << ": "
-                     << "Test timeout changed to "
-                     << std::chrono::duration_cast<std::chrono::seconds>(
-                          this->TestProperties->AlternateTimeout)
-                          .count()
-                     << std::endl);
-        this->TestProcess->ResetStartTime();
-        this->TestProcess->ChangeTimeout(
-          this->TestProperties->AlternateTimeout);
-        this->TestProperties->TimeoutRegularExpressions.clear();
-        break;
+  if (!this->TestProperties->TimeoutRegularExpressions.empty() &&
+      this->FindRegularExpression(
+        this->TestProperties->TimeoutRegularExpressions)) {
+    cmCTestLog(this->CTest, HANDLER_VERBOSE_OUTPUT,
+               this->GetIndex()
+                 << ": "
+                 << "Test timeout changed to "
+                 << std::chrono::duration_cast<std::chrono::seconds>(
+                      this->TestProperties->AlternateTimeout)
+                      .count()
+                 << std::endl);
+    this->TestProcess->ResetStartTime();
+    this->TestProcess->ChangeTimeout(this->TestProperties->AlternateTimeout);
+    this->TestProperties->TimeoutRegularExpressions.clear();
+  }
+
+  if (this->TestOutput.IsOverLimit()) {
+    this->CollectSpilledMeasurements(this->TestOutput.GetText());
+    if (!this->TestOutput.Spill()) {
+      this->SpilledMeasurements.clear();
+      this->InSpilledMeasurement = false;
+    }
+  }
+}
+
+void cmCTestRunTest::StartOutput()
+{
+  // Keep what may be submitted to a dashboard in memory, with room for a
+  // multi-byte character at the end, but at least a megabyte so that
+  // usual output is never spilled.
+  std::size_t const headSize =
+    static_cast<std::size_t>(
+      std::max({ this->TestHandler->CustomMaximumPassedTestOutputSize,
+                 this->TestHandler->CustomMaximumFailedTestOutputSize, 0 })) +
+    4;
+  std::size_t const memoryLimit =
+    std::max(headSize, static_cast<std::size_t>(1024 * 1024));
+  // Other ctest processes may run the same test in the same build tree.
+  this->TestOutput.Reset(cmStrCat(this->CTest->GetBinaryDir(),
+                                  "/Testing/Temporary/TestOutput-",
+                                  uv_os_getpid(), '-', this->Index, ".log"),
+                         memoryLimit, headSize);
+  this->FullOutputRequested = false;
+  this->SpilledMeasurements.clear();
+  this->InSpilledMeasurement = false;
+
+  // Scan the output for all regular expressions of the test at once.
+  this->OutputMatcher = cmCTestOutputMatcher();
+  this->OutputMatcherIndex.clear();
+  for (auto* regexes : { &this->TestProperties->RequiredRegularExpressions,
+                         &this->TestProperties->ErrorRegularExpressions,
+                         &this->TestProperties->SkipRegularExpressions,
+                         &this->TestProperties->TimeoutRegularExpressions }) {
+    for (auto const& regex : *regexes) {
+      this->OutputMatcherIndex[&regex.first] =
+        this->OutputMatcher.Add(regex.second);
+    }
+  }
+}
+
+void cmCTestRunTest::CollectSpilledMeasurements(cm::string_view text)
+{
+  while (!text.empty()) {
+    cm::string_view::size_type const end = text.find('\n');
+    cm::string_view const line = text.substr(0, end);
+    text = end == cm::string_view::npos ? cm::string_view()
+                                        : text.substr(end + 1);
+    cm::string_view::size_type const open = line.rfind("<DartMeasurement");
+    cm::string_view::size_type const close = line.rfind("</DartMeasurement");
+    if (open != cm::string_view::npos || this->InSpilledMeasurement) {
+      this->SpilledMeasurements.append(line.data(), line.size());
+      this->SpilledMeasurements += '\n';
+      if (open != cm::string_view::npos) {
+        this->InSpilledMeasurement =
+          close == cm::string_view::npos || close < open;
+      } else if (close != cm::string_view::npos) {
+        this->InSpilledMeasurement = false;
       }
     }
   }
 }
 
+std::string const* cmCTestRunTest::FindRegularExpression(
+  std::vector<std::pair<cmsys::RegularExpression, std::string>>& regexes)
+{
+  for (auto& regex : regexes) {
+    auto const it = this->OutputMatcherIndex.find(&regex.first);
+    if (it != this->OutputMatcherIndex.end() &&
+        this->OutputMatcher.IsFound(it->second)) {
+      return &regex.second;
+    }
+  }
+  return nullptr;
+}
+
 bool cmCTestRunTest::EndTest(size_t completed, size_t total, bool started)
 {
+  this->ProcessOutput = this->TestOutput.TakeText();
   this->WriteLogOutputTop(completed, total);
   std::string reason;
   bool passed = true;
@@ -82,16 +199,11 @@ bool cmCTestRunTest::EndTest(size_t completed, size_t total, bool started)
   bool outputTestErrorsToConsole = false;
   if (!this->TestProperties->RequiredRegularExpressions.empty() &&
       this->FailedDependencies.empty()) {
-    bool found = false;
-    for (auto& pass : this->TestProperties->RequiredRegularExpressions) {
-      if (pass.first.find(this->ProcessOutput)) {
-        found = true;
-        reason = cmStrCat("Required regular expression found. Regex=[",
-                          pass.second, ']');
-        break;
-      }
-    }
-    if (!found) {
+    if (std::string const* found = this->FindRegularExpression(
+          this->TestProperties->RequiredRegularExpressions)) {
+      reason =
+        cmStrCat("Required regular expression found. Regex=[", *found, ']');
+    } else {
       reason = "Required regular expression not found. Regex=[";
       for (auto& pass : this->TestProperties->RequiredRegularExpressions) {
         reason += pass.second;
@@ -103,24 +215,20 @@ bool cmCTestRunTest::EndTest(size_t completed, size_t total, bool started)
   }
   if (!this->TestProperties->ErrorRegularExpressions.empty() &&
       this->FailedDependencies.empty()) {
-    for (auto& fail : this->TestProperties->ErrorRegularExpressions) {
-      if (fail.first.find(this->ProcessOutput)) {
-        reason = cmStrCat("Error regular expression found in output. Regex=[",
-                          fail.second, ']');
-        forceFail = true;
-        break;
-      }
+    if (std::string const* fail = this->FindRegularExpression(
+          this->TestProperties->ErrorRegularExpressions)) {
+      reason = cmStrCat("Error regular expression found in output. Regex=[",
+                        *fail, ']');
+      forceFail = true;
     }
   }
   if (!this->TestProperties->SkipRegularExpressions.empty() &&
       this->FailedDependencies.empty()) {
-    for (auto& skip : this->TestProperties->SkipRegularExpressions) {
-      if (skip.first.find(this->ProcessOutput)) {
-        reason = cmStrCat("Skip regular expression found in output. Regex=[",
-                          skip.second, ']');
-        forceSkip = true;
-        break;
-      }
+    if (std::string const* skip = this->FindRegularExpression(
+          this->TestProperties->SkipRegularExpressions)) {
+      reason = cmStrCat("Skip regular expression found in output. Regex=[",
+                        *skip, ']');
+      forceSkip = true;
     }
   }
   std::ostringstream outputStream;
@@ -183,6 +291,8 @@ bool cmCTestRunTest::EndTest(size_t completed, size_t total, bool started)
                    this->TestResult.ExceptionStatus);
         this->TestResult.Status = cmCTestTestHandler::OTHER_FAULT;
     }
+  } else if ("Cached" == this->TestResult.CompletionStatus) {
+    outputStream << "   Cached  ";
   } else if ("Disabled" == this->TestResult.CompletionStatus) {
     outputStream << "***Not Run (Disabled) ";
   } else // cmProcess::State::Error
@@ -191,6 +301,14 @@ bool cmCTestRunTest::EndTest(size_t completed, size_t total, bool started)
   }
 
   passed = this->TestResult.Status == cmCTestTestHandler::COMPLETED;
+  if (started && !this->Fingerprint.empty()) {
+    if (passed) {
+      this->MultiTestHandler.ResultCache.Record(this->TestProperties->Name,
+                                                this->Fingerprint);
+    } else {
+      this->MultiTestHandler.ResultCache.Remove(this->TestProperties->Name);
+    }
+  }
   char buf[1024];
   sprintf(buf, "%6.2f sec", this->TestProcess->GetTotalTime().count());
   outputStream << buf << "\n";
@@ -221,24 +339,41 @@ bool cmCTestRunTest::EndTest(size_t completed, size_t total, bool started)
   }
 
   if (outputTestErrorsToConsole) {
-    cmCTestLog(this->CTest, HANDLER_OUTPUT, this->ProcessOutput << std::endl);
+    if (this->TestOutput.IsSpilled()) {
+      this->TestOutput.ReadChunks([this](cm::string_view chunk) {
+        cmCTestLog(this->CTest, HANDLER_OUTPUT, chunk);
+      });
+      cmCTestLog(this->CTest, HANDLER_OUTPUT, std::endl);
+    } else {
+      cmCTestLog(this->CTest, HANDLER_OUTPUT,
+                 this->ProcessOutput << std::endl);
+    }
   }
 
   if (this->TestHandler->LogFile) {
     *this->TestHandler->LogFile << "Test time = " << buf << std::endl;
   }
 
+  int const outputSize =
+    this->TestResult.Status == cmCTestTestHandler::COMPLETED
+    ? this->TestHandler->CustomMaximumPassedTestOutputSize
+    : this->TestHandler->CustomMaximumFailedTestOutputSize;
+
+  // Read back spilled output if it is not truncated to the head.
+  if (this->TestOutput.IsSpilled() &&
+      (this->TestHandler->MemCheck || this->FullOutputRequested ||
+       outputSize <= 0)) {
+    this->ProcessOutput = this->TestOutput.ReadAll();
+    this->TestOutput.Clear();
+  }
+
   this->DartProcessing();
 
   // if this is doing MemCheck then all the output needs to be put into
   // Output since that is what is parsed by cmCTestMemCheckHandler
   if (!this->TestHandler->MemCheck && started) {
-    this->TestHandler->CleanTestOutput(
-      this->ProcessOutput,
-      static_cast<size_t>(
-        this->TestResult.Status == cmCTestTestHandler::COMPLETED
-          ? this->TestHandler->CustomMaximumPassedTestOutputSize
-          : this->TestHandler->CustomMaximumFailedTestOutputSize));
+    this->TestHandler->CleanTestOutput(this->ProcessOutput,
+                                       static_cast<size_t>(outputSize));
   }
   this->TestResult.Reason = reason;
   if (this->TestHandler->LogFile) {
@@ -302,6 +437,7 @@ bool cmCTestRunTest::EndTest(size_t completed, size_t total, bool started)
       this->TestResult.CompletionStatus = "Completed";
     }
     this->TestResult.ExecutionTime = this->TestProcess->GetTotalTime();
+    this->TestResult.Usage = this->TestProcess->GetUsage();
     this->MemCheckPostProcess();
     this->ComputeWeightedCost();
   }
@@ -310,6 +446,7 @@ bool cmCTestRunTest::EndTest(size_t completed, size_t total, bool started)
   if (!this->NeedsToRepeat()) {
     this->TestHandler->TestResults.push_back(this->TestResult);
   }
+  this->TestOutput.Clear();
   this->TestProcess.reset();
   return passed || skipped;
 }
@@ -365,14 +502,12 @@ bool cmCTestRunTest::NeedsToRepeat()
 }
 void cmCTestRunTest::ComputeWeightedCost()
 {
-  double prev = static_cast<double>(this->TestProperties->PreviousRuns);
-  double avgcost = static_cast<double>(this->TestProperties->Cost);
-  double current = this->TestResult.ExecutionTime.count();
-
   if (this->TestResult.Status == cmCTestTestHandler::COMPLETED) {
-    this->TestProperties->Cost =
-      static_cast<float>(((prev * avgcost) + current) / (prev + 1.0));
-    this->TestProperties->PreviousRuns++;
+    unsigned long const peakMemory =
+      this->TestResult.Usage ? this->TestResult.Usage->PeakMemory / 1024 : 0;
+    this->MultiTestHandler.CostData.Record(
+      this->TestProperties->Name, this->TestResult.ExecutionTime.count(),
+      peakMemory);
   }
 }
 
@@ -418,6 +553,7 @@ void cmCTestRunTest::StartFailure(std::string const& output,
   }
 
   this->ProcessOutput.clear();
+  this->StartOutput();
   if (!output.empty()) {
     *this->TestHandler->LogFile << output << std::endl;
     cmCTestLog(this->CTest, ERROR_MESSAGE, output << std::endl);
@@ -491,6 +627,7 @@ bool cmCTestRunTest::StartTest(size_t completed, size_t total)
   }
 
   this->ProcessOutput.clear();
+  this->StartOutput();
 
   this->TestResult.Properties = this->TestProperties;
   this->TestResult.ExecutionTime = cmDuration::zero();
@@ -584,6 +721,24 @@ bool cmCTestRunTest::StartTest(size_t completed, size_t total)
     this->TestResult.Status = cmCTestTestHandler::NOT_RUN;
     return false;
   }
+
+  // Skip a test that passed before with the same inputs.  Fixture setup
+  // and cleanup tests always run for their side effects.
+  this->Fingerprint.clear();
+  if (this->CTest->GetCacheResults() && !this->TestHandler->MemCheck &&
+      this->TestProperties->FixturesSetup.empty() &&
+      this->TestProperties->FixturesCleanup.empty()) {
+    this->Fingerprint = this->ComputeFingerprint();
+    if (this->RepeatMode == cmCTest::Repeat::Never &&
+        this->MultiTestHandler.ResultCache.IsCached(
+          this->TestProperties->Name, this->Fingerprint)) {
+      this->TestResult.CompletionStatus = "Cached";
+      this->TestResult.Status = cmCTestTestHandler::COMPLETED;
+      this->TestResult.Output = "Cached";
+      return false;
+    }
+  }
+
   this->StartTime = this->CTest->CurrentTime();
 
   auto timeout = this->TestProperties->Timeout;
@@ -609,6 +764,61 @@ bool cmCTestRunTest::StartTest(size_t completed, size_t total)
                            &this->TestProperties->Affinity);
 }
 
+std::string cmCTestRunTest::ComputeFingerprint()
+{
+  cmCTestResultCache& cache = this->MultiTestHandler.ResultCache;
+  cmCTestTestHandler::cmCTestTestProperties const& p = *this->TestProperties;
+  cmCryptoHash hash(cmCryptoHash::AlgoSHA256);
+  hash.Initialize();
+
+  cmCTestResultCache::AddString(hash, this->CTest->GetConfigType());
+  cache.AddExecutable(hash, this->ActualCommand, p.Environment);
+
+  // Arguments naming files, such as scripts, are inputs too.
+  cmCTestResultCache::AddString(hash, "ARGUMENTS");
+  for (std::string const& arg : this->Arguments) {
+    std::string const file = cmSystemTools::CollapseFullPath(arg, p.Directory);
+    if (cmSystemTools::FileExists(file, true)) {
+      cache.AddFile(hash, file);
+    } else {
+      cmCTestResultCache::AddString(hash, arg);
+    }
+  }
+  cmCTestResultCache::AddString(hash, "ENVIRONMENT");
+  for (std::string const& var : p.Environment) {
+    cmCTestResultCache::AddString(hash, var);
+  }
+  cmCTestResultCache::AddString(hash, "WORKING_DIRECTORY");
+  cmCTestResultCache::AddString(hash, p.Directory);
+  // Tests usually write the attached files, so only their names count.
+  cmCTestResultCache::AddString(hash, "ATTACHED_FILES");
+  for (std::string const& file : p.AttachedFiles) {
+    cmCTestResultCache::AddString(hash, file);
+  }
+  cmCTestResultCache::AddString(hash, "INPUT_FILES");
+  for (std::string const& file : p.InputFiles) {
+    cache.AddFile(hash, cmSystemTools::CollapseFullPath(file, p.Directory));
+  }
+
+  // The properties deciding whether the test passes.
+  using Regexes = std::vector<std::pair<cmsys::RegularExpression, std::string>>;
+  auto addRegexes = [&hash](char const* name, Regexes const& regexes) {
+    cmCTestResultCache::AddString(hash, name);
+    for (auto const& regex : regexes) {
+      cmCTestResultCache::AddString(hash, regex.second);
+    }
+  };
+  addRegexes("PASS_REGULAR_EXPRESSION", p.RequiredRegularExpressions);
+  addRegexes("FAIL_REGULAR_EXPRESSION", p.ErrorRegularExpressions);
+  addRegexes("SKIP_REGULAR_EXPRESSION", p.SkipRegularExpressions);
+  cmCTestResultCache::AddString(
+    hash,
+    cmStrCat(p.WillFail ? '1' : '0', ' ', p.SkipReturnCode, ' ',
+             std::to_string(p.Timeout.count())));
+
+  return hash.FinalizeHex();
+}
+
 void cmCTestRunTest::ComputeArguments()
 {
   this->Arguments.clear(); // reset because this might be a rerun
@@ -666,9 +876,13 @@ void cmCTestRunTest::ComputeArguments()
 
 void cmCTestRunTest::DartProcessing()
 {
-  if (!this->ProcessOutput.empty() &&
-      this->ProcessOutput.find("<DartMeasurement") != std::string::npos) {
-    if (this->TestHandler->DartStuff.find(this->ProcessOutput)) {
+  // Only the head of a spilled output is kept, but all its measurements.
+  std::string const& output = this->TestOutput.IsSpilled()
+    ? this->SpilledMeasurements
+    : this->ProcessOutput;
+  if (!output.empty() &&
+      output.find("<DartMeasurement") != std::string::npos) {
+    if (this->TestHandler->DartStuff.find(output)) {
       this->TestResult.DartString = this->TestHandler->DartStuff.match(1);
       // keep searching and replacing until none are left
       while (this->TestHandler->DartStuff1.find(this->ProcessOutput)) {
@@ -720,29 +934,29 @@ bool cmCTestRunTest::ForkProcess(cmDuration testTimeOut, bool explicitTimeout,
 
   this->TestProcess->SetTimeout(timeout);
 
-#ifndef CMAKE_BOOTSTRAP
-  cmSystemTools::SaveRestoreEnvironment sre;
-#endif
-
+  // The environment is given to the process as a whole, starting from the
+  // one ctest had when the tests started.
+  std::vector<std::string> env = this->MultiTestHandler.Environment;
   std::ostringstream envMeasurement;
   if (environment && !environment->empty()) {
-    cmSystemTools::AppendEnv(*environment);
     for (auto const& var : *environment) {
+      PutEnv(env, var);
       envMeasurement << var << std::endl;
     }
   }
 
   if (this->UseAllocatedResources) {
     std::vector<std::string> envLog;
-    this->SetupResourcesEnvironment(&envLog);
+    this->SetupResourcesEnvironment(env, &envLog);
     for (auto const& var : envLog) {
       envMeasurement << var << std::endl;
     }
   } else {
-    cmSystemTools::UnsetEnv("CTEST_RESOURCE_GROUP_COUNT");
+    PutEnv(env, "CTEST_RESOURCE_GROUP_COUNT");
     // Signify that this variable is being actively unset
     envMeasurement << "#CTEST_RESOURCE_GROUP_COUNT=" << std::endl;
   }
+  this->TestProcess->SetEnvironment(std::move(env));
 
   this->TestResult.Environment = envMeasurement.str();
   // Remove last newline
@@ -753,11 +967,12 @@ bool cmCTestRunTest::ForkProcess(cmDuration testTimeOut, bool explicitTimeout,
                                          affinity);
 }
 
-void cmCTestRunTest::SetupResourcesEnvironment(std::vector<std::string>* log)
+void cmCTestRunTest::SetupResourcesEnvironment(std::vector<std::string>& env,
+                                               std::vector<std::string>* log)
 {
   std::string processCount = "CTEST_RESOURCE_GROUP_COUNT=";
   processCount += std::to_string(this->AllocatedResources.size());
-  cmSystemTools::PutEnv(processCount);
+  PutEnv(env, processCount);
   if (log) {
     log->push_back(processCount);
   }
@@ -785,12 +1000,12 @@ void cmCTestRunTest::SetupResourcesEnvironment(std::vector<std::string>* log)
         firstName = false;
         var += "id:" + it2.Id + ",slots:" + std::to_string(it2.Slots);
       }
-      cmSystemTools::PutEnv(var);
+      PutEnv(env, var);
       if (log) {
         log->push_back(var);
       }
     }
-    cmSystemTools::PutEnv(resourceList);
+    PutEnv(env, resourceList);
     if (log) {
       log->push_back(resourceList);
     }
@@ -864,8 +1079,14 @@ void cmCTestRunTest::WriteLogOutputTop(size_t completed, size_t total)
     << "Output:" << std::endl
     << "----------------------------------------------------------"
     << std::endl;
-  *this->TestHandler->LogFile << this->ProcessOutput << "<end of output>"
-                              << std::endl;
+  if (this->TestOutput.IsSpilled()) {
+    this->TestOutput.ReadChunks([this](cm::string_view chunk) {
+      *this->TestHandler->LogFile << chunk;
+    });
+  } else {
+    *this->TestHandler->LogFile << this->ProcessOutput;
+  }
+  *this->TestHandler->LogFile << "<end of output>" << std::endl;
 
   if (!this->CTest->GetTestProgressOutput()) {
     cmCTestLog(this->CTest, HANDLER_OUTPUT, outputStream.str());
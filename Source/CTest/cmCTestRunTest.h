@@ -9,13 +9,20 @@
 #include <memory>
 #include <set>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include <stddef.h>
 
+#include <cm/string_view>
+
+#include "cmsys/RegularExpression.hxx"
+
 #include "cmCTest.h"
 #include "cmCTestMultiProcessHandler.h"
+#include "cmCTestOutputMatcher.h"
 #include "cmCTestTestHandler.h"
+#include "cmCTestTestOutput.h"
 #include "cmDuration.h"
 #include "cmProcess.h"
 
@@ -62,8 +69,8 @@ public:
     return this->TestResult;
   }
 
-  // Read and store output.  Returns true if it must be called again.
-  void CheckOutput(std::string const& line);
+  // Read and store a line of output.
+  void CheckOutput(cm::string_view line);
 
   static bool StartTest(std::unique_ptr<cmCTestRunTest> runner,
                         size_t completed, size_t total);
@@ -87,6 +94,11 @@ public:
 
   cmCTest* GetCTest() const { return this->CTest; }
 
+  cmCTestMultiProcessHandler& GetMultiTestHandler()
+  {
+    return this->MultiTestHandler;
+  }
+
   std::string& GetActualCommand() { return this->ActualCommand; }
 
   const std::vector<std::string>& GetArguments() { return this->Arguments; }
@@ -111,15 +123,25 @@ public:
 private:
   bool NeedsToRepeat();
   void DartProcessing();
+  void StartOutput();
+  // Keep the lines of measurements for DartProcessing from output that is
+  // spilled to a file.
+  void CollectSpilledMeasurements(cm::string_view text);
+  // Find the first of the regular expressions matching the output so far.
+  std::string const* FindRegularExpression(
+    std::vector<std::pair<cmsys::RegularExpression, std::string>>& regexes);
   void ExeNotFound(std::string exe);
   bool ForkProcess(cmDuration testTimeOut, bool explicitTimeout,
                    std::vector<std::string>* environment,
                    std::vector<size_t>* affinity);
   void WriteLogOutputTop(size_t completed, size_t total);
+  // Hash the inputs of the test for the result cache
+  std::string ComputeFingerprint();
   // Run post processing of the process output for MemCheck
   void MemCheckPostProcess();
 
-  void SetupResourcesEnvironment(std::vector<std::string>* log = nullptr);
+  void SetupResourcesEnvironment(std::vector<std::string>& env,
+                                 std::vector<std::string>* log = nullptr);
 
   // Returns "completed/total Test #Index: "
   std::string GetTestPrefix(size_t completed, size_t total) const;
@@ -130,7 +152,14 @@ private:
   cmCTestTestHandler* TestHandler;
   cmCTest* CTest;
   std::unique_ptr<cmProcess> TestProcess;
+  cmCTestTestOutput TestOutput;
+  // The output, or its head if the output was spilled to a file
   std::string ProcessOutput;
+  bool FullOutputRequested = false;
+  cmCTestOutputMatcher OutputMatcher;
+  std::map<cmsys::RegularExpression const*, size_t> OutputMatcherIndex;
+  std::string SpilledMeasurements;
+  bool InSpilledMeasurement = false;
   // The test results
   cmCTestTestHandler::cmCTestTestResult TestResult;
   cmCTestMultiProcessHandler& MultiTestHandler;
@@ -139,6 +168,8 @@ private:
   std::string StartTime;
   std::string ActualCommand;
   std::vector<std::string> Arguments;
+  // Fingerprint of the inputs if the result cache is used
+  std::string Fingerprint;
   bool UseAllocatedResources = false;
   std::vector<std::map<
     std::string, std::vector<cmCTestMultiProcessHandler::ResourceAllocation>>>
@@ -0,0 +1,133 @@
+/* Distributed under the OSI-approved BSD 3-Clause License.  See accompanying
+   file Copyright.txt or https://cmake.org/licensing for details.  */
+#include "cmCTestSystemMonitor.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#if defined(__linux__)
+#  include <unistd.h>
+#endif
+
+#include "cmsys/FStream.hxx"
+#include "cmsys/SystemInformation.hxx"
+
+#include "cmStringAlgorithms.h"
+#include "cmSystemTools.h"
+
+namespace {
+// Find a line starting with the key in a small file and parse the number
+// following it.
+cm::optional<std::uint64_t> ReadValue(std::string const& file,
+                                      const char* key)
+{
+  cmsys::ifstream fin(file.c_str());
+  if (!fin) {
+    return cm::nullopt;
+  }
+  std::size_t const keyLength = std::strlen(key);
+  std::string line;
+  while (cmSystemTools::GetLineFromStream(fin, line)) {
+    if (line.compare(0, keyLength, key) == 0) {
+      char const* begin = line.c_str() + keyLength;
+      char* end = nullptr;
+      unsigned long long const value = std::strtoull(begin, &end, 10);
+      if (end == begin) {
+        return cm::nullopt;
+      }
+      return static_cast<std::uint64_t>(value);
+    }
+  }
+  return cm::nullopt;
+}
+}
+
+cm::optional<std::uint64_t> cmCTestSystemMonitor::ReadStallTime(
+  const char* resource)
+{
+  // Line format: some avg10=0.00 avg60=0.00 avg300=0.00 total=0
+  cmsys::ifstream fin(cmStrCat("/proc/pressure/", resource).c_str());
+  if (!fin) {
+    return cm::nullopt;
+  }
+  std::string line;
+  while (cmSystemTools::GetLineFromStream(fin, line)) {
+    if (cmHasLiteralPrefix(line, "some ")) {
+      std::string::size_type const pos = line.find(" total=");
+      if (pos == std::string::npos) {
+        return cm::nullopt;
+      }
+      return static_cast<std::uint64_t>(
+        std::strtoull(line.c_str() + pos + 7, nullptr, 10));
+    }
+  }
+  return cm::nullopt;
+}
+
+cm::optional<unsigned long> cmCTestSystemMonitor::ReadAvailableMemory()
+{
+  cm::optional<std::uint64_t> const kib =
+    ReadValue("/proc/meminfo", "MemAvailable:");
+  if (kib) {
+    return static_cast<unsigned long>(*kib / 1024);
+  }
+  cmsys::SystemInformation info;
+  info.RunMemoryCheck();
+  std::size_t const mib = info.GetAvailablePhysicalMemory();
+  if (mib == 0) {
+    return cm::nullopt;
+  }
+  return static_cast<unsigned long>(mib);
+}
+
+cm::optional<cmCTestSystemMonitor::ProcessUsage>
+cmCTestSystemMonitor::ReadProcessUsage(long pid)
+{
+#if defined(__linux__)
+  std::string const dir = cmStrCat("/proc/", pid, '/');
+
+  // The command name in parentheses may contain spaces, so the fields
+  // are counted from the closing parenthesis.  After it come the state
+  // (field 3) up to utime, stime, cutime and cstime (fields 14 to 17).
+  cmsys::ifstream fin((dir + "stat").c_str());
+  std::string stat;
+  if (!fin || !cmSystemTools::GetLineFromStream(fin, stat)) {
+    return cm::nullopt;
+  }
+  ProcessUsage usage;
+  std::string::size_type const paren = stat.rfind(')');
+  if (paren != std::string::npos) {
+    std::vector<std::string> const fields =
+      cmTokenize(stat.substr(paren + 1), " ");
+    if (fields.size() > 14) {
+      unsigned long long ticks = 0;
+      for (std::size_t i = 11; i < 15; ++i) {
+        ticks += std::strtoull(fields[i].c_str(), nullptr, 10);
+      }
+      double const ticksPerSecond = static_cast<double>(sysconf(_SC_CLK_TCK));
+      usage.CpuTime = static_cast<double>(ticks) / ticksPerSecond;
+    }
+  }
+
+  // The memory is no longer reported once the process has exited.
+  usage.PeakMemory = static_cast<unsigned long>(
+    ReadValue(dir + "status", "VmHWM:").value_or(0));
+
+  // Reading the I/O counters may not be permitted.
+  cmsys::ifstream io((dir + "io").c_str());
+  std::string line;
+  while (io && cmSystemTools::GetLineFromStream(io, line)) {
+    if (cmHasLiteralPrefix(line, "read_bytes: ")) {
+      usage.ReadBytes = std::strtoull(line.c_str() + 12, nullptr, 10);
+    } else if (cmHasLiteralPrefix(line, "write_bytes: ")) {
+      usage.WriteBytes = std::strtoull(line.c_str() + 13, nullptr, 10);
+    }
+  }
+  return usage;
+#else
+  static_cast<void>(pid);
+  return cm::nullopt;
+#endif
+}
@@ -0,0 +1,45 @@
+/* Distributed under the OSI-approved BSD 3-Clause License.  See accompanying
+   file Copyright.txt or https://cmake.org/licensing for details.  */
+#ifndef cmCTestSystemMonitor_h
+#define cmCTestSystemMonitor_h
+
+#include "cmConfigure.h" // IWYU pragma: keep
+
+#include <cstdint>
+
+#include <cm/optional>
+
+/** \class cmCTestSystemMonitor
+ * \brief Read how busy the system and the running tests are.
+ *
+ * On Linux the pressure stall information of the kernel and the files
+ * of the processes in /proc are read.  Elsewhere only the available
+ * memory is known.
+ */
+class cmCTestSystemMonitor
+{
+public:
+  /** Total time in microseconds some tasks stalled waiting for the given
+      resource, "cpu" or "memory", since the system started.  */
+  static cm::optional<std::uint64_t> ReadStallTime(const char* resource);
+
+  /** Memory in MiB that can be used by new processes without swapping.  */
+  static cm::optional<unsigned long> ReadAvailableMemory();
+
+  /** Resources used so far by a running process, including the child
+      processes it waited for, except for the memory.  A process that has
+      exited but was not waited for yet reports all but the memory.  */
+  struct ProcessUsage
+  {
+    // Peak resident set size in KiB
+    unsigned long PeakMemory = 0;
+    // User and system time in seconds
+    double CpuTime = 0;
+    // Bytes read from and written to storage
+    std::uint64_t ReadBytes = 0;
+    std::uint64_t WriteBytes = 0;
+  };
+  static cm::optional<ProcessUsage> ReadProcessUsage(long pid);
+};
+
+#endif
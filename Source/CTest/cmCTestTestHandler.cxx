@@ -15,6 +15,7 @@
 #include <iterator>
 #include <set>
 #include <sstream>
+#include <unordered_map>
 #include <utility>
 
 #include <cm/memory>
@@ -30,6 +31,7 @@
 #include "cm_utf8.h"
 
 #include "cmCTest.h"
+#include "cmCTestCostData.h"
 #include "cmCTestMultiProcessHandler.h"
 #include "cmCTestResourceGroupsLexerHelper.h"
 #include "cmDuration.h"
@@ -823,6 +825,10 @@ void cmCTestTestHandler::ComputeTestList()
 {
   this->TestList.clear(); // clear list of test
   this->GetListOfTests();
+  this->AllTestNames.clear();
+  for (cmCTestTestProperties const& p : this->TestList) {
+    this->AllTestNames.insert(p.Name);
+  }
 
   if (this->RerunFailed) {
     this->ComputeTestListForRerunFailed();
@@ -875,6 +881,7 @@ void cmCTestTestHandler::ComputeTestList()
   }
 
   UpdateForFixtures(finalList);
+  this->SelectShard(finalList);
 
   // Save the total number of tests before exclusions
   this->TotalNumberOfTests = this->TestList.size();
@@ -1145,6 +1152,178 @@ void cmCTestTestHandler::UpdateForFixtures(ListOfTests& tests) const
                      this->Quiet);
 }
 
+void cmCTestTestHandler::SelectShard(ListOfTests& tests) const
+{
+  int const shardCount = this->CTest->GetShardCount();
+  if (shardCount < 1) {
+    return;
+  }
+
+  // The tests that set up or clean up a fixture required by other tests
+  // run in every shard that needs them, so they are left out of the
+  // groups.  The other tests are joined into groups that must run
+  // together: a test and the tests it depends on.
+  std::set<std::string> required;
+  for (cmCTestTestProperties const& p : tests) {
+    required.insert(p.FixturesRequired.begin(), p.FixturesRequired.end());
+  }
+  auto providesAny = [](cmCTestTestProperties const& p,
+                        std::set<std::string> const& fixtures) {
+    for (std::set<std::string> const* provided :
+         { &p.FixturesSetup, &p.FixturesCleanup }) {
+      for (std::string const& fixture : *provided) {
+        if (fixtures.count(fixture)) {
+          return true;
+        }
+      }
+    }
+    return false;
+  };
+  std::vector<bool> replicated(tests.size());
+  for (std::size_t i = 0; i < tests.size(); ++i) {
+    replicated[i] = providesAny(tests[i], required);
+  }
+
+  std::vector<std::size_t> parent(tests.size());
+  for (std::size_t i = 0; i < parent.size(); ++i) {
+    parent[i] = i;
+  }
+  auto find = [&parent](std::size_t i) {
+    while (parent[i] != i) {
+      parent[i] = parent[parent[i]];
+      i = parent[i];
+    }
+    return i;
+  };
+  auto join = [&parent, &find](std::size_t a, std::size_t b) {
+    a = find(a);
+    b = find(b);
+    // The smaller index is the root, so a group is named by its first test.
+    if (a < b) {
+      parent[b] = a;
+    } else {
+      parent[a] = b;
+    }
+  };
+
+  std::unordered_map<std::string, std::size_t> byName;
+  for (std::size_t i = 0; i < tests.size(); ++i) {
+    byName.emplace(tests[i].Name, i);
+  }
+  for (std::size_t i = 0; i < tests.size(); ++i) {
+    if (replicated[i]) {
+      continue;
+    }
+    for (std::string const& dep : tests[i].Depends) {
+      auto const it = byName.find(dep);
+      if (it != byName.end() && !replicated[it->second]) {
+        join(i, it->second);
+      }
+    }
+  }
+
+  // Estimate the duration of every test from the cost data, so that the
+  // shards take about equally long.  Tests without history count as the
+  // average test with history, or all tests count the same.  The history
+  // of serial runs is preferred whatever the parallel level of this run,
+  // so that shards running with different levels agree.
+  cmCTestCostData costData;
+  costData.SetContext(this->CTest->GetConfigType(), 1);
+  costData.Load(this->CTest->GetCostDataFile());
+  std::vector<double> costs(tests.size(), -1);
+  double knownTotal = 0;
+  std::size_t knownCount = 0;
+  for (std::size_t i = 0; i < tests.size(); ++i) {
+    if (cmCTestCostData::Entry const* entry = costData.Find(tests[i].Name)) {
+      costs[i] = entry->Mean;
+    } else if (tests[i].Cost > 0) {
+      costs[i] = tests[i].Cost;
+    } else {
+      continue;
+    }
+    knownTotal += costs[i];
+    ++knownCount;
+  }
+  double const unknownCost =
+    knownCount > 0 && knownTotal > 0 ? knownTotal / knownCount : 1;
+
+  struct Group
+  {
+    std::size_t First;
+    double Cost;
+  };
+  std::vector<Group> groups;
+  std::unordered_map<std::size_t, std::size_t> groupOf;
+  for (std::size_t i = 0; i < tests.size(); ++i) {
+    if (replicated[i]) {
+      continue;
+    }
+    std::size_t const root = find(i);
+    auto const inserted = groupOf.emplace(root, groups.size());
+    if (inserted.second) {
+      groups.push_back(Group{ root, 0 });
+    }
+    groups[inserted.first->second].Cost +=
+      costs[i] >= 0 ? costs[i] : unknownCost;
+  }
+
+  // Assign the longest group first to the shard with the least work, the
+  // lowest shard on a tie.  Every shard computes the same assignment as
+  // long as they see the same tests and cost data.
+  std::vector<std::size_t> order(groups.size());
+  for (std::size_t i = 0; i < order.size(); ++i) {
+    order[i] = i;
+  }
+  std::sort(order.begin(), order.end(),
+            [&groups](std::size_t a, std::size_t b) {
+              if (groups[a].Cost != groups[b].Cost) {
+                return groups[a].Cost > groups[b].Cost;
+              }
+              return groups[a].First < groups[b].First;
+            });
+  std::vector<double> load(static_cast<std::size_t>(shardCount), 0);
+  std::vector<bool> selected(groups.size(), false);
+  std::size_t const shard =
+    static_cast<std::size_t>(this->CTest->GetShardIndex() - 1);
+  for (std::size_t g : order) {
+    std::size_t const least = static_cast<std::size_t>(
+      std::min_element(load.begin(), load.end()) - load.begin());
+    load[least] += groups[g].Cost;
+    selected[g] = least == shard;
+  }
+
+  // Keep the fixture tests needed by the selected tests, and those
+  // needed by the fixture tests kept in turn.
+  std::vector<bool> keep(tests.size(), false);
+  std::set<std::string> needed;
+  for (std::size_t i = 0; i < tests.size(); ++i) {
+    if (!replicated[i] && selected[groupOf[find(i)]]) {
+      keep[i] = true;
+      needed.insert(tests[i].FixturesRequired.begin(),
+                    tests[i].FixturesRequired.end());
+    }
+  }
+  for (bool added = true; added;) {
+    added = false;
+    for (std::size_t i = 0; i < tests.size(); ++i) {
+      if (replicated[i] && !keep[i] && providesAny(tests[i], needed)) {
+        keep[i] = true;
+        needed.insert(tests[i].FixturesRequired.begin(),
+                      tests[i].FixturesRequired.end());
+        added = true;
+      }
+    }
+  }
+
+  ListOfTests shardList;
+  for (std::size_t i = 0; i < tests.size(); ++i) {
+    if (keep[i]) {
+      shardList.push_back(tests[i]);
+    }
+  }
+  tests = std::move(shardList);
+}
+
 void cmCTestTestHandler::UpdateMaxTestNameWidth()
 {
   std::string::size_type max = this->CTest->GetMaxTestNameWidth();
@@ -1308,6 +1487,13 @@ bool cmCTestTestHandler::ProcessDirectory(std::vector<std::string>& passed,
     srand(static_cast<unsigned>(time(nullptr)));
   }
 
+  // Look up dependencies by name.  If names are duplicated the first
+  // test wins.
+  std::unordered_map<std::string, int> testIndices;
+  for (cmCTestTestProperties const& p : this->TestList) {
+    testIndices.emplace(p.Name, p.Index);
+  }
+
   for (cmCTestTestProperties& p : this->TestList) {
     cmCTestMultiProcessHandler::TestSet depends;
 
@@ -1320,14 +1506,10 @@ bool cmCTestTestHandler::ProcessDirectory(std::vector<std::string>& passed,
       p.Timeout = this->CTest->GetGlobalTimeout();
     }
 
-    if (!p.Depends.empty()) {
-      for (std::string const& i : p.Depends) {
-        for (cmCTestTestProperties const& it2 : this->TestList) {
-          if (it2.Name == i) {
-            depends.insert(it2.Index);
-            break; // break out of test loop as name can only match 1
-          }
-        }
+    for (std::string const& i : p.Depends) {
+      auto const it = testIndices.find(i);
+      if (it != testIndices.end()) {
+        depends.insert(it->second);
       }
     }
     tests[p.Index] = depends;
@@ -1360,6 +1542,22 @@ void cmCTestTestHandler::GenerateTestCommand(
 {
 }
 
+void cmCTestTestHandler::WriteTestUsage(
+  cmXMLWriter& xml, cmCTestSystemMonitor::ProcessUsage const& usage)
+{
+  auto measurement = [&xml](const char* name, double value) {
+    xml.StartElement("NamedMeasurement");
+    xml.Attribute("type", "numeric/double");
+    xml.Attribute("name", name);
+    xml.Element("Value", value);
+    xml.EndElement(); // NamedMeasurement
+  };
+  measurement("Peak Memory", static_cast<double>(usage.PeakMemory) / 1024);
+  measurement("CPU Time", usage.CpuTime);
+  measurement("Read Bytes", static_cast<double>(usage.ReadBytes));
+  measurement("Write Bytes", static_cast<double>(usage.WriteBytes));
+}
+
 void cmCTestTestHandler::GenerateDartOutput(cmXMLWriter& xml)
 {
   if (!this->CTest->GetProduceXML()) {
@@ -1402,6 +1600,9 @@ void cmCTestTestHandler::GenerateDartOutput(cmXMLWriter& xml)
       xml.Attribute("name", "Execution Time");
       xml.Element("Value", result.ExecutionTime.count());
       xml.EndElement(); // NamedMeasurement
+      if (result.Usage) {
+        this->WriteTestUsage(xml, *result.Usage);
+      }
       if (!result.Reason.empty()) {
         const char* reasonType = "Pass Reason";
         if (result.Status != cmCTestTestHandler::COMPLETED) {
@@ -2206,6 +2407,8 @@ bool cmCTestTestHandler::SetTestsProperties(
             cmExpandList(val, rt.AttachedFiles);
           } else if (key == "ATTACHED_FILES_ON_FAIL"_s) {
             cmExpandList(val, rt.AttachOnFail);
+          } else if (key == "INPUT_FILES"_s) {
+            cmExpandList(val, rt.InputFiles);
           } else if (key == "RESOURCE_LOCK"_s) {
             std::vector<std::string> lval = cmExpandedList(val);
 
@@ -2246,6 +2449,10 @@ bool cmCTestTestHandler::SetTestsProperties(
             if (rt.Processors < 1) {
               rt.Processors = 1;
             }
+          } else if (key == "MEMORY_REQUIRED"_s) {
+            if (!cmStrToULong(val, &rt.MemoryRequired)) {
+              rt.MemoryRequired = 0;
+            }
           } else if (key == "PROCESSOR_AFFINITY"_s) {
             rt.WantAffinity = cmIsOn(val);
           } else if (key == "RESOURCE_GROUPS"_s) {
@@ -2409,9 +2616,9 @@ bool cmCTestTestHandler::AddTest(const std::vector<std::string>& args)
   test.ExplicitTimeout = false;
   test.Cost = 0;
   test.Processors = 1;
+  test.MemoryRequired = 0;
   test.WantAffinity = false;
   test.SkipReturnCode = -1;
-  test.PreviousRuns = 0;
   if (this->UseIncludeRegExpFlag &&
       (!this->IncludeTestsRegularExpression.find(testname) ||
        (!this->UseExcludeRegExpFirst &&
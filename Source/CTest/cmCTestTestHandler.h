@@ -16,11 +16,14 @@
 
 #include <stddef.h>
 
+#include <cm/optional>
+
 #include "cmsys/RegularExpression.hxx"
 
 #include "cmCTest.h"
 #include "cmCTestGenericHandler.h"
 #include "cmCTestResourceSpec.h"
+#include "cmCTestSystemMonitor.h"
 #include "cmDuration.h"
 #include "cmListFileCache.h"
 
@@ -69,6 +72,12 @@ public:
   void SetIncludeRegExp(const char*);
   void SetExcludeRegExp(const char*);
 
+  // Names of all tests, including those not selected to run
+  std::set<std::string> const& GetAllTestNames() const
+  {
+    return this->AllTestNames;
+  }
+
   void SetMaxIndex(int n) { this->MaxIndex = n; }
   int GetMaxIndex() { return this->MaxIndex; }
 
@@ -126,6 +135,7 @@ public:
     std::vector<std::string> Depends;
     std::vector<std::string> AttachedFiles;
     std::vector<std::string> AttachOnFail;
+    std::vector<std::string> InputFiles;
     std::vector<std::pair<cmsys::RegularExpression, std::string>>
       ErrorRegularExpressions;
     std::vector<std::pair<cmsys::RegularExpression, std::string>>
@@ -139,7 +149,6 @@ public:
     bool WillFail;
     bool Disabled;
     float Cost;
-    int PreviousRuns;
     bool RunSerial;
     cmDuration Timeout;
     bool ExplicitTimeout;
@@ -147,6 +156,8 @@ public:
     int Index;
     // Requested number of process slots
     int Processors;
+    // Memory in MiB the test needs, or zero if not known
+    unsigned long MemoryRequired;
     bool WantAffinity;
     std::vector<size_t> Affinity;
     // return code of test which will mark test as "not run"
@@ -180,6 +191,8 @@ public:
     std::string DartString;
     int TestCount;
     cmCTestTestProperties* Properties;
+    // Resources used by the test as far as they could be measured
+    cm::optional<cmCTestSystemMonitor::ProcessUsage> Usage;
   };
 
   struct cmCTestTestResultLess
@@ -233,6 +246,9 @@ protected:
                              cmCTestTestResult const& result);
   void WriteTestResultFooter(cmXMLWriter& xml,
                              cmCTestTestResult const& result);
+  // Write the resources used by a test as measurements.
+  void WriteTestUsage(cmXMLWriter& xml,
+                      cmCTestSystemMonitor::ProcessUsage const& usage);
   // Write attached test files into the xml
   void AttachFiles(cmXMLWriter& xml, cmCTestTestResult& result);
 
@@ -300,6 +316,11 @@ private:
   // tests to account for fixture setup/cleanup
   void UpdateForFixtures(ListOfTests& tests) const;
 
+  // keep only the tests of the shard given by --shard, keeping tests
+  // that depend on each other in the same shard and the fixture tests
+  // in every shard that needs them
+  void SelectShard(ListOfTests& tests) const;
+
   void UpdateMaxTestNameWidth();
 
   bool GetValue(const char* tag, std::string& value, std::istream& fin);
@@ -351,6 +372,7 @@ private:
   std::string TestsToRunString;
   bool UseUnion;
   ListOfTests TestList;
+  std::set<std::string> AllTestNames;
   size_t TotalNumberOfTests;
   cmsys::RegularExpression DartStuff;
 
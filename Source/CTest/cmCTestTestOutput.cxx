@@ -0,0 +1,100 @@
+/* Distributed under the OSI-approved BSD 3-Clause License.  See accompanying
+   file Copyright.txt or https://cmake.org/licensing for details.  */
+#include "cmCTestTestOutput.h"
+
+#include <ios>
+#include <utility>
+#include <vector>
+
+#include "cmSystemTools.h"
+
+namespace {
+std::size_t const ChunkSize = 64 * 1024;
+}
+
+cmCTestTestOutput::~cmCTestTestOutput()
+{
+  this->Clear();
+}
+
+void cmCTestTestOutput::Reset(std::string spillFile, std::size_t memoryLimit,
+                              std::size_t headSize)
+{
+  this->Clear();
+  this->SpillFile = std::move(spillFile);
+  this->MemoryLimit = memoryLimit;
+  this->HeadSize = headSize < memoryLimit ? headSize : memoryLimit;
+}
+
+void cmCTestTestOutput::Clear()
+{
+  this->Text.clear();
+  if (this->Spilled) {
+    this->SpillStream.close();
+    cmSystemTools::RemoveFile(this->SpillFile);
+    this->Spilled = false;
+  }
+}
+
+void cmCTestTestOutput::AppendLine(cm::string_view line)
+{
+  if (this->Spilled) {
+    this->SpillStream.write(line.data(),
+                            static_cast<std::streamsize>(line.size()));
+    this->SpillStream.put('\n');
+  } else {
+    this->Text.append(line.data(), line.size());
+    this->Text += '\n';
+  }
+}
+
+bool cmCTestTestOutput::Spill()
+{
+  this->SpillStream.open(this->SpillFile.c_str(),
+                         std::ios::out | std::ios::binary | std::ios::trunc);
+  if (!this->SpillStream) {
+    // Keep all output in memory as a last resort.
+    this->SpillFile.clear();
+    this->SpillStream.clear();
+    return false;
+  }
+  this->SpillStream.write(this->Text.data(),
+                          static_cast<std::streamsize>(this->Text.size()));
+  this->Text.resize(this->HeadSize);
+  this->Text.shrink_to_fit();
+  this->Spilled = true;
+  return true;
+}
+
+std::string cmCTestTestOutput::ReadAll()
+{
+  if (!this->Spilled) {
+    return this->Text;
+  }
+  std::string all;
+  this->ReadChunks([&all](cm::string_view chunk) {
+    all.append(chunk.data(), chunk.size());
+  });
+  return all;
+}
+
+void cmCTestTestOutput::ReadChunks(
+  std::function<void(cm::string_view)> const& f)
+{
+  if (!this->Spilled) {
+    f(this->Text);
+    return;
+  }
+  this->SpillStream.flush();
+  cmsys::ifstream fin(this->SpillFile.c_str(),
+                      std::ios::in | std::ios::binary);
+  std::vector<char> buffer(ChunkSize);
+  while (fin) {
+    fin.read(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+    std::streamsize const n = fin.gcount();
+    if (n <= 0) {
+      break;
+    }
+    f(cm::string_view(buffer.data(), static_cast<std::size_t>(n)));
+  }
+}
@@ -0,0 +1,80 @@
+/* Distributed under the OSI-approved BSD 3-Clause License.  See accompanying
+   file Copyright.txt or https://cmake.org/licensing for details.  */
+#ifndef cmCTestTestOutput_h
+#define cmCTestTestOutput_h
+
+#include "cmConfigure.h" // IWYU pragma: keep
+
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <utility>
+
+#include <cm/string_view>
+
+#include "cmsys/FStream.hxx"
+
+/** \class cmCTestTestOutput
+ * \brief Output of a test, kept in bounded memory.
+ *
+ * The output is kept in memory up to a limit.  Once it grows beyond, all
+ * of it is written to a spill file as it arrives, and only its head stays
+ * in memory, which is all of a long output that is submitted to a
+ * dashboard.  If the spill file cannot be written the output stays in
+ * memory.
+ */
+class cmCTestTestOutput
+{
+public:
+  cmCTestTestOutput() = default;
+  ~cmCTestTestOutput();
+
+  cmCTestTestOutput(cmCTestTestOutput const&) = delete;
+  cmCTestTestOutput& operator=(cmCTestTestOutput const&) = delete;
+
+  /** Discard the output and start over.  Keep up to memoryLimit bytes in
+      memory, and the first headSize bytes once spilled to the file.  */
+  void Reset(std::string spillFile, std::size_t memoryLimit,
+             std::size_t headSize);
+
+  /** Append a line and a newline.  */
+  void AppendLine(cm::string_view line);
+
+  /** Whether the output in memory grew beyond the limit.  */
+  bool IsOverLimit() const
+  {
+    return !this->Spilled && this->MemoryLimit > 0 &&
+      this->Text.size() > this->MemoryLimit && !this->SpillFile.empty();
+  }
+
+  /** Write the output to the spill file and keep only its head in memory.
+      Returns false if the file cannot be written.  */
+  bool Spill();
+
+  bool IsSpilled() const { return this->Spilled; }
+
+  /** All output if it is not spilled, else its head.  */
+  std::string const& GetText() const { return this->Text; }
+
+  /** Move out all output if it is not spilled, else its head.  */
+  std::string TakeText() { return std::move(this->Text); }
+
+  /** All output, read back from the spill file if needed.  */
+  std::string ReadAll();
+
+  /** Pass all output in pieces of bounded size to the given function.  */
+  void ReadChunks(std::function<void(cm::string_view)> const& f);
+
+  /** Discard the output and remove the spill file.  */
+  void Clear();
+
+private:
+  std::string SpillFile;
+  std::size_t MemoryLimit = 0;
+  std::size_t HeadSize = 0;
+  std::string Text;
+  bool Spilled = false;
+  cmsys::ofstream SpillStream;
+};
+
+#endif
@@ -2,6 +2,7 @@
    file Copyright.txt or https://cmake.org/licensing for details.  */
 #include "cmProcess.h"
 
+#include <cerrno>
 #include <csignal>
 #include <iostream>
 #include <string>
@@ -12,6 +13,7 @@
 #include "cmsys/Process.h"
 
 #include "cmCTest.h"
+#include "cmCTestMultiProcessHandler.h"
 #include "cmCTestRunTest.h"
 #include "cmCTestTestHandler.h"
 #include "cmGetPipes.h"
@@ -20,8 +22,27 @@
 #  include <cm3p/kwiml/int.h>
 #endif
 
+// Where posix_spawn does not copy the address space of ctest the way the
+// fork used by libuv does, and reports a command that cannot be executed,
+// processes are spawned with it.
+#if defined(__APPLE__) ||                                                     \
+  (defined(__GLIBC__) &&                                                      \
+   (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 24)))
+#  define CM_PROCESS_POSIX_SPAWN
+#  include <fcntl.h>
+#  include <spawn.h>
+#  include <sys/resource.h>
+#  include <sys/wait.h>
+#endif
+
 #define CM_PROCESS_BUF_SIZE 65536
 
+// The resources used by a process are sampled shortly after it starts
+// and then periodically, because they are gone once it has been waited
+// for.  A process spawned without libuv is sampled when it exits, too.
+#define CM_PROCESS_FIRST_USAGE_SAMPLE 100
+#define CM_PROCESS_USAGE_SAMPLE_INTERVAL 250
+
 cmProcess::cmProcess(std::unique_ptr<cmCTestRunTest> runner)
   : Runner(std::move(runner))
   , Conv(cmProcessOutput::UTF8, CM_PROCESS_BUF_SIZE)
@@ -33,7 +54,12 @@ cmProcess::cmProcess(std::unique_ptr<cmCTestRunTest> runner)
   this->StartTime = std::chrono::steady_clock::time_point();
 }
 
-cmProcess::~cmProcess() = default;
+cmProcess::~cmProcess()
+{
+  if (this->ChildWatcher) {
+    this->ChildWatcher->UnwatchChild(this->Pid);
+  }
+}
 
 void cmProcess::SetCommand(std::string const& command)
 {
@@ -65,6 +91,11 @@ bool cmProcess::StartProcess(uv_loop_t& loop, std::vector<size_t>* affinity)
     this->ProcessArgs.push_back(arg.c_str());
   }
   this->ProcessArgs.push_back(nullptr); // null terminate the list
+  this->ProcessEnvironment.clear();
+  for (std::string const& var : this->Environment) {
+    this->ProcessEnvironment.push_back(var.c_str());
+  }
+  this->ProcessEnvironment.push_back(nullptr);
 
   cm::uv_timer_ptr timer;
   int status = timer.init(loop, this);
@@ -103,6 +134,7 @@ bool cmProcess::StartProcess(uv_loop_t& loop, std::vector<size_t>* affinity)
   uv_process_options_t options = uv_process_options_t();
   options.file = this->Command.data();
   options.args = const_cast<char**>(this->ProcessArgs.data());
+  options.env = const_cast<char**>(this->ProcessEnvironment.data());
   options.stdio_count = 3; // in, out and err
   options.exit_cb = &cmProcess::OnExitCB;
   options.stdio = stdio;
@@ -133,7 +165,20 @@ bool cmProcess::StartProcess(uv_loop_t& loop, std::vector<size_t>* affinity)
     return false;
   }
 
-  status = this->Process.spawn(loop, options, this);
+  // A CPU affinity can only be set by libuv, which also searches the PATH
+  // for a command without a directory.  The spawn falls back to libuv for
+  // anything else it cannot do.
+  status = UV_ENOSYS;
+  if ((!affinity || affinity->empty()) &&
+      this->Command.find('/') != std::string::npos) {
+    status = this->SpawnDirectly(fds[1]);
+  }
+  if (status == UV_ENOSYS) {
+    status = this->Process.spawn(loop, options, this);
+    if (status == 0) {
+      this->Pid = this->Process->pid;
+    }
+  }
   if (status != 0) {
     cmCTestLog(this->Runner->GetCTest(), ERROR_MESSAGE,
                "Process not started\n " << this->Command << "\n["
@@ -146,10 +191,78 @@ bool cmProcess::StartProcess(uv_loop_t& loop, std::vector<size_t>* affinity)
 
   this->StartTimer();
 
+  // Measuring the resources is best effort, so failing to do so is no
+  // error.
+  if (this->UsageTimer.init(loop, this) == 0) {
+    this->UsageTimer.start(&cmProcess::OnUsageTimerCB,
+                           CM_PROCESS_FIRST_USAGE_SAMPLE,
+                           CM_PROCESS_USAGE_SAMPLE_INTERVAL);
+  }
+
   this->ProcessState = cmProcess::State::Executing;
   return true;
 }
 
+int cmProcess::SpawnDirectly(int outputFd)
+{
+#if defined(CM_PROCESS_POSIX_SPAWN)
+  // The pipe was made non-blocking for libuv, and the process must write
+  // to it blocking, as libuv arranges in the process it forks.
+  int const flags = fcntl(outputFd, F_GETFL);
+  if (flags == -1 || fcntl(outputFd, F_SETFL, flags & ~O_NONBLOCK) == -1) {
+    return uv_translate_sys_error(errno);
+  }
+
+  // Watch for the exit before the process can exit.
+  cmCTestMultiProcessHandler& watcher = this->Runner->GetMultiTestHandler();
+  int const status = watcher.StartChildSignal();
+  if (status != 0) {
+    return status;
+  }
+
+  posix_spawn_file_actions_t actions;
+  posix_spawn_file_actions_init(&actions);
+  posix_spawn_file_actions_adddup2(&actions, outputFd, 1);
+  posix_spawn_file_actions_adddup2(&actions, outputFd, 2);
+
+  // Like libuv, restore the default handling of all signals.
+  posix_spawnattr_t attr;
+  posix_spawnattr_init(&attr);
+  sigset_t signals;
+  sigfillset(&signals);
+  sigdelset(&signals, SIGKILL);
+  sigdelset(&signals, SIGSTOP);
+  posix_spawnattr_setsigdefault(&attr, &signals);
+  sigemptyset(&signals);
+  posix_spawnattr_setsigmask(&attr, &signals);
+  posix_spawnattr_setflags(&attr, POSIX_SPAWN_SETSIGDEF |
+                             POSIX_SPAWN_SETSIGMASK);
+
+  pid_t pid = 0;
+  int const error = posix_spawn(
+    &pid, this->Command.c_str(), &actions, &attr,
+    const_cast<char* const*>(this->ProcessArgs.data()),
+    const_cast<char* const*>(this->ProcessEnvironment.data()));
+  posix_spawnattr_destroy(&attr);
+  posix_spawn_file_actions_destroy(&actions);
+  if (error == ENOEXEC) {
+    // Let libuv run a script without an interpreter line with the shell,
+    // as execvp does.
+    return UV_ENOSYS;
+  }
+  if (error != 0) {
+    return uv_translate_sys_error(error);
+  }
+  this->Pid = pid;
+  this->ChildWatcher = &watcher;
+  watcher.WatchChild(this->Pid, this);
+  return 0;
+#else
+  static_cast<void>(outputFd);
+  return UV_ENOSYS;
+#endif
+}
+
 void cmProcess::StartTimer()
 {
   auto properties = this->Runner->GetTestProperties();
@@ -162,7 +275,7 @@ void cmProcess::StartTimer()
   }
 }
 
-bool cmProcess::Buffer::GetLine(std::string& line)
+bool cmProcess::Buffer::GetLine(cm::string_view& line)
 {
   // Scan for the next newline.
   for (size_type sz = this->size(); this->Last != sz; ++this->Last) {
@@ -173,7 +286,7 @@ bool cmProcess::Buffer::GetLine(std::string& line)
       while (length && text[length - 1] == '\r') {
         length--;
       }
-      line.assign(text, length);
+      line = cm::string_view(text, length);
 
       // Start a new range for the next line.
       ++this->Last;
@@ -215,15 +328,14 @@ void cmProcess::OnReadCB(uv_stream_t* stream, ssize_t nread,
 
 void cmProcess::OnRead(ssize_t nread, const uv_buf_t* buf)
 {
-  std::string line;
   if (nread > 0) {
     std::string strdata;
     this->Conv.DecodeText(buf->base, static_cast<size_t>(nread), strdata);
     cm::append(this->Output, strdata);
 
+    cm::string_view line;
     while (this->Output.GetLine(line)) {
       this->Runner->CheckOutput(line);
-      line.clear();
     }
 
     return;
@@ -241,6 +353,7 @@ void cmProcess::OnRead(ssize_t nread, const uv_buf_t* buf)
   }
 
   // Look for partial last lines.
+  std::string line;
   if (this->Output.GetLast(line)) {
     this->Runner->CheckOutput(line);
   }
@@ -286,7 +399,7 @@ void cmProcess::OnTimeout()
   }
   if (!this->ProcessHandleClosed) {
     // Kill the child and let our on-exit handler finish the test.
-    cmsysProcess_KillPID(static_cast<unsigned long>(this->Process->pid));
+    cmsysProcess_KillPID(static_cast<unsigned long>(this->Pid));
   } else if (was_still_reading) {
     // Our on-exit handler already ran but did not finish the test
     // because we were still reading output.  We've just dropped
@@ -295,6 +408,76 @@ void cmProcess::OnTimeout()
   }
 }
 
+void cmProcess::OnUsageTimerCB(uv_timer_t* timer)
+{
+  auto self = static_cast<cmProcess*>(timer->data);
+  self->OnUsageTimer();
+}
+
+void cmProcess::OnUsageTimer()
+{
+  if (!this->SampleUsage()) {
+    // Not supported on this platform.
+    this->UsageTimer.reset();
+  }
+}
+
+bool cmProcess::SampleUsage()
+{
+  cm::optional<cmCTestSystemMonitor::ProcessUsage> const usage =
+    cmCTestSystemMonitor::ReadProcessUsage(this->Pid);
+  if (!usage) {
+    return false;
+  }
+  // An exited process no longer reports its memory, so keep the peak
+  // seen before.
+  unsigned long const peak = this->Usage ? this->Usage->PeakMemory : 0;
+  this->Usage = usage;
+  if (this->Usage->PeakMemory < peak) {
+    this->Usage->PeakMemory = peak;
+  }
+  return true;
+}
+
+void cmProcess::CheckChildExit()
+{
+#if defined(CM_PROCESS_POSIX_SPAWN)
+  pid_t const pid = static_cast<pid_t>(this->Pid);
+  siginfo_t info;
+  info.si_pid = 0;
+  if (waitid(P_PID, static_cast<id_t>(pid), &info,
+             WEXITED | WNOHANG | WNOWAIT) != 0 ||
+      info.si_pid != pid) {
+    return;
+  }
+
+  // The exited process can be looked at until it is waited for, so
+  // measure it a last time to count what it used since the previous
+  // sample, or at all if it ran shorter than the first one.
+  if (this->UsageTimer.get()) {
+    this->SampleUsage();
+  }
+
+  int status = 0;
+  struct rusage usage;
+  if (wait4(pid, &status, 0, &usage) != pid) {
+    return;
+  }
+  // The peak memory of an exited process is reported by waiting for it.
+  if (this->Usage &&
+      this->Usage->PeakMemory < static_cast<unsigned long>(usage.ru_maxrss)) {
+    this->Usage->PeakMemory = static_cast<unsigned long>(usage.ru_maxrss);
+  }
+  this->ChildWatcher->UnwatchChild(this->Pid);
+  this->ChildWatcher = nullptr;
+  if (WIFSIGNALED(status)) {
+    this->OnExit(0, WTERMSIG(status));
+  } else {
+    this->OnExit(WIFEXITED(status) ? WEXITSTATUS(status) : 0, 0);
+  }
+#endif
+}
+
 void cmProcess::OnExitCB(uv_process_t* process, int64_t exit_status,
                          int term_signal)
 {
@@ -318,6 +501,9 @@ void cmProcess::OnExit(int64_t exit_status, int term_signal)
     }
   }
 
+  // The process is gone, so there is nothing left to measure.
+  this->UsageTimer.reset();
+
   // Record exit information.
   this->ExitValue = exit_status;
   this->Signal = term_signal;
@@ -11,14 +11,19 @@
 #include <utility>
 #include <vector>
 
+#include <cm/optional>
+#include <cm/string_view>
+
 #include <cm3p/uv.h>
 #include <stddef.h>
 #include <stdint.h>
 
+#include "cmCTestSystemMonitor.h"
 #include "cmDuration.h"
 #include "cmProcessOutput.h"
 #include "cmUVHandlePtr.h"
 
+class cmCTestMultiProcessHandler;
 class cmCTestRunTest;
 
 /** \class cmProcess
@@ -34,6 +39,11 @@ public:
   void SetCommand(std::string const& command);
   void SetCommandArguments(std::vector<std::string> const& arg);
   void SetWorkingDirectory(std::string const& dir);
+  // The complete environment of the process, "NAME=value" entries
+  void SetEnvironment(std::vector<std::string> env)
+  {
+    this->Environment = std::move(env);
+  }
   void SetTimeout(cmDuration t) { this->Timeout = t; }
   void ChangeTimeout(cmDuration t);
   void ResetStartTime();
@@ -57,6 +67,12 @@ public:
   void SetId(int id) { this->Id = id; }
   int64_t GetExitValue() { return this->ExitValue; }
   cmDuration GetTotalTime() { return this->TotalTime; }
+  // Resources used by the process as last sampled, when it exited if
+  // it was spawned without libuv, if they could be measured.
+  cm::optional<cmCTestSystemMonitor::ProcessUsage> const& GetUsage() const
+  {
+    return this->Usage;
+  }
 
   enum class Exception
   {
@@ -76,6 +92,9 @@ public:
     return std::move(this->Runner);
   }
 
+  // Finish the process if it was spawned without libuv and has exited.
+  void CheckChildExit();
+
 private:
   cmDuration Timeout;
   std::chrono::steady_clock::time_point StartTime;
@@ -84,8 +103,13 @@ private:
   bool ProcessHandleClosed = false;
 
   cm::uv_process_ptr Process;
+  // Watches for the exit of a process spawned without libuv.
+  cmCTestMultiProcessHandler* ChildWatcher = nullptr;
+  long Pid = 0;
   cm::uv_pipe_ptr PipeReader;
   cm::uv_timer_ptr Timer;
+  cm::uv_timer_ptr UsageTimer;
+  cm::optional<cmCTestSystemMonitor::ProcessUsage> Usage;
   std::vector<char> Buf;
 
   std::unique_ptr<cmCTestRunTest> Runner;
@@ -96,6 +120,7 @@ private:
   static void OnExitCB(uv_process_t* process, int64_t exit_status,
                        int term_signal);
   static void OnTimeoutCB(uv_timer_t* timer);
+  static void OnUsageTimerCB(uv_timer_t* timer);
   static void OnReadCB(uv_stream_t* stream, ssize_t nread,
                        const uv_buf_t* buf);
   static void OnAllocateCB(uv_handle_t* handle, size_t suggested_size,
@@ -103,9 +128,12 @@ private:
 
   void OnExit(int64_t exit_status, int term_signal);
   void OnTimeout();
+  void OnUsageTimer();
+  bool SampleUsage();
   void OnRead(ssize_t nread, const uv_buf_t* buf);
   void OnAllocate(size_t suggested_size, uv_buf_t* buf);
 
+  int SpawnDirectly(int outputFd);
   void StartTimer();
   void Finish();
 
@@ -121,7 +149,8 @@ private:
       , Last(0)
     {
     }
-    bool GetLine(std::string& line);
+    // The line stays valid until the buffer is changed.
+    bool GetLine(cm::string_view& line);
     bool GetLast(std::string& line);
   };
   Buffer Output;
@@ -129,6 +158,8 @@ private:
   std::string WorkingDirectory;
   std::vector<std::string> Arguments;
   std::vector<const char*> ProcessArgs;
+  std::vector<std::string> Environment;
+  std::vector<const char*> ProcessEnvironment;
   int Id;
   int64_t ExitValue;
 };
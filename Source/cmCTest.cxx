@@ -91,6 +91,8 @@ struct cmCTest::Private
   cmCTest::Repeat RepeatMode = cmCTest::Repeat::Never;
   std::string ConfigType;
   std::string ScheduleType;
+  bool ScheduleReport = false;
+  bool CacheResults = false;
   std::chrono::system_clock::time_point StopTime;
   bool StopOnFailure = false;
   bool TestProgressOutput = false;
@@ -174,6 +176,11 @@ struct cmCTest::Private
   bool ParallelLevelSetInCli = false;
 
   unsigned long TestLoad = 0;
+  unsigned long TestPressure = 0;
+
+  // Run only the tests of this shard, counted from one, of this many.
+  int ShardIndex = 0;
+  int ShardCount = 0;
 
   int CompatibilityMode;
 
@@ -389,6 +396,21 @@ void cmCTest::SetTestLoad(unsigned long load)
   this->Impl->TestLoad = load;
 }
 
+unsigned long cmCTest::GetTestPressure() const
+{
+  return this->Impl->TestPressure;
+}
+
+int cmCTest::GetShardIndex() const
+{
+  return this->Impl->ShardIndex;
+}
+
+int cmCTest::GetShardCount() const
+{
+  return this->Impl->ShardCount;
+}
+
 bool cmCTest::ShouldCompressTestOutput()
 {
   return this->Impl->CompressTestOutput;
@@ -1899,6 +1921,26 @@ bool cmCTest::HandleCommandLineArguments(size_t& i,
     }
   }
 
+  else if (this->CheckArgument(arg, "--shard"_s)) {
+    if (i >= args.size() - 1) {
+      errormsg = "'--shard' requires an argument";
+      return false;
+    }
+    i++;
+    cmsys::RegularExpression shardRegex("^([0-9]+)/([0-9]+)$");
+    unsigned long index = 0;
+    unsigned long count = 0;
+    if (!shardRegex.find(args[i]) ||
+        !cmStrToULong(shardRegex.match(1), &index) ||
+        !cmStrToULong(shardRegex.match(2), &count) || index < 1 ||
+        index > count || count > 100000) {
+      errormsg = cmStrCat("'--shard' given invalid value '", args[i], "'");
+      return false;
+    }
+    this->Impl->ShardIndex = static_cast<int>(index);
+    this->Impl->ShardCount = static_cast<int>(count);
+  }
+
   else if (this->CheckArgument(arg, "--test-load"_s) && i < args.size() - 1) {
     i++;
     unsigned long load;
@@ -1910,6 +1952,19 @@ bool cmCTest::HandleCommandLineArguments(size_t& i,
     }
   }
 
+  else if (this->CheckArgument(arg, "--test-pressure"_s) &&
+           i < args.size() - 1) {
+    i++;
+    unsigned long pressure;
+    if (cmStrToULong(args[i], &pressure) && pressure <= 100) {
+      this->Impl->TestPressure = pressure;
+    } else {
+      cmCTestLog(this, WARNING,
+                 "Invalid value for 'Test Pressure' : " << args[i]
+                                                        << std::endl);
+    }
+  }
+
   else if (this->CheckArgument(arg, "--no-compress-output"_s)) {
     this->Impl->CompressTestOutput = false;
   }
@@ -2320,6 +2375,16 @@ int cmCTest::Run(std::vector<std::string>& args, std::string* output)
       this->Impl->ScheduleType = "Random";
     }
 
+    // --schedule-report
+    if (this->CheckArgument(arg, "--schedule-report"_s)) {
+      this->Impl->ScheduleReport = true;
+    }
+
+    // --cache-results
+    if (this->CheckArgument(arg, "--cache-results"_s)) {
+      this->Impl->CacheResults = true;
+    }
+
     // pass the argument to all the handlers as well, but i may no longer be
     // set to what it was originally so I'm not sure this is working as
     // intended
@@ -2557,6 +2622,16 @@ void cmCTest::SetScheduleType(std::string const& type)
   this->Impl->ScheduleType = type;
 }
 
+bool cmCTest::GetScheduleReport() const
+{
+  return this->Impl->ScheduleReport;
+}
+
+bool cmCTest::GetCacheResults() const
+{
+  return this->Impl->CacheResults;
+}
+
 int cmCTest::ReadCustomConfigurationFileTree(const std::string& dir,
                                              cmMakefile* mf)
 {
@@ -123,6 +123,15 @@ public:
   unsigned long GetTestLoad() const;
   void SetTestLoad(unsigned long);
 
+  /** The CPU or memory pressure in percent above which fewer tests are
+      started, or zero.  */
+  unsigned long GetTestPressure() const;
+
+  /** The shard of the tests to run, counted from one, and the number of
+      shards, or zero to run all tests.  */
+  int GetShardIndex() const;
+  int GetShardCount() const;
+
   /**
    * Check if CTest file exists
    */
@@ -214,6 +223,12 @@ public:
   std::string GetScheduleType() const;
   void SetScheduleType(std::string const& type);
 
+  /** Whether to report the predicted and actual test schedule */
+  bool GetScheduleReport() const;
+
+  /** Whether to skip tests that passed before with the same inputs */
+  bool GetCacheResults() const;
+
   /** The max output width */
   int GetMaxTestNameWidth() const;
   void SetMaxTestNameWidth(int w);
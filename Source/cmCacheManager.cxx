@@ -3,10 +3,13 @@
 #include "cmCacheManager.h"
 
 #include <algorithm>
+#include <cstdint>
 #include <cstdio>
 #include <cstring>
+#include <iterator>
 #include <sstream>
 #include <string>
+#include <utility>
 
 #include "cmsys/FStream.hxx"
 #include "cmsys/Glob.hxx"
@@ -19,6 +22,10 @@
 #include "cmSystemTools.h"
 #include "cmVersion.h"
 
+#if !defined(CMAKE_BOOTSTRAP)
+#  include "cmCryptoHash.h"
+#endif
+
 void cmCacheManager::CleanCMakeFiles(const std::string& path)
 {
   std::string glob = cmStrCat(path, "/CMakeFiles/*.cmake");
@@ -28,6 +35,96 @@ void cmCacheManager::CleanCMakeFiles(const std::string& path)
   std::for_each(files.begin(), files.end(), cmSystemTools::RemoveFile);
 }
 
+namespace {
+// Layout of CMakeFiles/CMakeCache.bin, all integers little-endian:
+//   "CMKCACHE", u32 version, u64 size and SHA-256 of CMakeCache.txt,
+//   u32 entry count, entries of { u32 type, key, value, help string }
+//   where each string is a u32 length followed by its bytes.
+char const BinaryCacheMagic[8] = { 'C', 'M', 'K', 'C', 'A', 'C', 'H', 'E' };
+std::uint32_t const BinaryCacheVersion = 2;
+std::size_t const BinaryCacheHashSize = 32;
+std::size_t const BinaryCacheHeaderSize = 8 + 4 + 8 + BinaryCacheHashSize + 4;
+
+std::string BinaryCachePath(std::string const& path)
+{
+  return cmStrCat(path, "/CMakeFiles/CMakeCache.bin");
+}
+
+// Identify the content of CMakeCache.txt by its size and hash.  The
+// modification time is not enough: an edit may keep it within its
+// granularity, and copies may preserve it.  Without a hash, i.e. during
+// bootstrap, the sidecar is not used.
+bool CacheFileStamp(std::string const& cacheFile, std::uint64_t& size,
+                    std::string& hash)
+{
+#if !defined(CMAKE_BOOTSTRAP)
+  std::vector<unsigned char> const bytes =
+    cmCryptoHash(cmCryptoHash::AlgoSHA256).ByteHashFile(cacheFile);
+  if (bytes.size() != BinaryCacheHashSize) {
+    return false;
+  }
+  size = cmSystemTools::FileLength(cacheFile);
+  hash.assign(bytes.begin(), bytes.end());
+  return true;
+#else
+  static_cast<void>(cacheFile);
+  static_cast<void>(size);
+  static_cast<void>(hash);
+  return false;
+#endif
+}
+
+void AppendUInt(std::string& out, std::uint64_t v, int bytes)
+{
+  for (int i = 0; i < bytes; ++i) {
+    out += static_cast<char>((v >> (8 * i)) & 0xFF);
+  }
+}
+
+class BinaryCacheParser
+{
+public:
+  explicit BinaryCacheParser(std::string const& data)
+    : Data(data)
+  {
+  }
+
+  bool ReadUInt(std::uint64_t& v, int bytes)
+  {
+    if (this->Data.size() - this->Pos < static_cast<std::size_t>(bytes)) {
+      return false;
+    }
+    v = 0;
+    for (int i = 0; i < bytes; ++i) {
+      v |= static_cast<std::uint64_t>(
+             static_cast<unsigned char>(this->Data[this->Pos + i]))
+        << (8 * i);
+    }
+    this->Pos += bytes;
+    return true;
+  }
+
+  bool ReadString(std::string& str)
+  {
+    std::uint64_t len;
+    if (!this->ReadUInt(len, 4) || this->Data.size() - this->Pos < len) {
+      return false;
+    }
+    str.assign(this->Data, this->Pos, static_cast<std::size_t>(len));
+    this->Pos += static_cast<std::size_t>(len);
+    return true;
+  }
+
+  void Skip(std::size_t bytes) { this->Pos += bytes; }
+
+  bool AtEnd() const { return this->Pos == this->Data.size(); }
+
+private:
+  std::string const& Data;
+  std::size_t Pos = 0;
+};
+}
+
 bool cmCacheManager::LoadCache(const std::string& path, bool internal,
                                std::set<std::string>& excludes,
                                std::set<std::string>& includes)
@@ -42,78 +139,48 @@ bool cmCacheManager::LoadCache(const std::string& path, bool internal,
     return false;
   }
 
-  cmsys::ifstream fin(cacheFile.c_str());
-  if (!fin) {
-    return false;
-  }
-  const char* realbuffer;
-  std::string buffer;
-  std::string entryKey;
-  unsigned int lineno = 0;
-  while (fin) {
-    // Format is key:type=value
-    std::string helpString;
-    CacheEntry e;
-    cmSystemTools::GetLineFromStream(fin, buffer);
-    lineno++;
-    realbuffer = buffer.c_str();
-    while (*realbuffer != '0' &&
-           (*realbuffer == ' ' || *realbuffer == '\t' || *realbuffer == '\r' ||
-            *realbuffer == '\n')) {
-      if (*realbuffer == '\n') {
-        lineno++;
-      }
-      realbuffer++;
+  // Use the binary sidecar if it still describes CMakeCache.txt and
+  // fall back to parsing the text, e.g. after it was edited by hand.
+  std::vector<ParsedEntry> entries;
+  if (!ReadBinaryCache(path, cacheFile, entries)) {
+    entries.clear();
+    cmsys::ifstream fin(cacheFile.c_str());
+    if (!fin) {
+      return false;
     }
-    // skip blank lines and comment lines
-    if (realbuffer[0] == '#' || realbuffer[0] == 0) {
+    ParseCacheFile(fin, cacheFile, entries, true);
+  }
+
+  for (ParsedEntry& pe : entries) {
+    if (excludes.find(pe.Key) != excludes.end()) {
       continue;
     }
-    while (realbuffer[0] == '/' && realbuffer[1] == '/') {
-      if ((realbuffer[2] == '\\') && (realbuffer[3] == 'n')) {
-        helpString += '\n';
-        helpString += &realbuffer[4];
-      } else {
-        helpString += &realbuffer[2];
-      }
-      cmSystemTools::GetLineFromStream(fin, buffer);
-      lineno++;
-      realbuffer = buffer.c_str();
-      if (!fin) {
-        continue;
+    CacheEntry e;
+    e.Value = std::move(pe.Value);
+    e.Type = pe.Type;
+    e.SetProperty("HELPSTRING", pe.HelpString.c_str());
+    // Load internal values if internal is set.
+    // If the entry is not internal to the cache being loaded
+    // or if it is in the list of internal entries to be
+    // imported, load it.
+    if (internal || (e.Type != cmStateEnums::INTERNAL) ||
+        (includes.find(pe.Key) != includes.end())) {
+      // If we are loading the cache from another project,
+      // make all loaded entries internal so that it is
+      // not visible in the gui
+      if (!internal) {
+        e.Type = cmStateEnums::INTERNAL;
+        std::string helpString = cmStrCat(
+          "DO NOT EDIT, ", pe.Key,
+          " loaded from external file.  "
+          "To change this value edit this file: ",
+          path, "/CMakeCache.txt");
+        e.SetProperty("HELPSTRING", helpString.c_str());
       }
-    }
-    e.SetProperty("HELPSTRING", helpString.c_str());
-    if (cmState::ParseCacheEntry(realbuffer, entryKey, e.Value, e.Type)) {
-      if (excludes.find(entryKey) == excludes.end()) {
-        // Load internal values if internal is set.
-        // If the entry is not internal to the cache being loaded
-        // or if it is in the list of internal entries to be
-        // imported, load it.
-        if (internal || (e.Type != cmStateEnums::INTERNAL) ||
-            (includes.find(entryKey) != includes.end())) {
-          // If we are loading the cache from another project,
-          // make all loaded entries internal so that it is
-          // not visible in the gui
-          if (!internal) {
-            e.Type = cmStateEnums::INTERNAL;
-            helpString = cmStrCat("DO NOT EDIT, ", entryKey,
-                                  " loaded from external file.  "
-                                  "To change this value edit this file: ",
-                                  path, "/CMakeCache.txt");
-            e.SetProperty("HELPSTRING", helpString.c_str());
-          }
-          if (!this->ReadPropertyEntry(entryKey, e)) {
-            e.Initialized = true;
-            this->Cache[entryKey] = e;
-          }
-        }
+      if (!this->ReadPropertyEntry(pe.Key, e)) {
+        e.Initialized = true;
+        this->Cache[pe.Key] = std::move(e);
       }
-    } else {
-      std::ostringstream error;
-      error << "Parse error in cache file " << cacheFile << " on line "
-            << lineno << ". Offending entry: " << realbuffer;
-      cmSystemTools::Error(error.str());
     }
   }
   this->CacheMajorVersion = 0;
@@ -165,6 +232,175 @@ bool cmCacheManager::LoadCache(const std::string& path, bool internal,
   return true;
 }
 
+bool cmCacheManager::ParseCacheFile(std::istream& fin,
+                                    std::string const& cacheFile,
+                                    std::vector<ParsedEntry>& entries,
+                                    bool reportErrors)
+{
+  bool ok = true;
+  const char* realbuffer;
+  std::string buffer;
+  unsigned int lineno = 0;
+  while (fin) {
+    // Format is key:type=value
+    ParsedEntry e;
+    cmSystemTools::GetLineFromStream(fin, buffer);
+    lineno++;
+    realbuffer = buffer.c_str();
+    while (*realbuffer != '0' &&
+           (*realbuffer == ' ' || *realbuffer == '\t' || *realbuffer == '\r' ||
+            *realbuffer == '\n')) {
+      if (*realbuffer == '\n') {
+        lineno++;
+      }
+      realbuffer++;
+    }
+    // skip blank lines and comment lines
+    if (realbuffer[0] == '#' || realbuffer[0] == 0) {
+      continue;
+    }
+    while (realbuffer[0] == '/' && realbuffer[1] == '/') {
+      if ((realbuffer[2] == '\\') && (realbuffer[3] == 'n')) {
+        e.HelpString += '\n';
+        e.HelpString += &realbuffer[4];
+      } else {
+        e.HelpString += &realbuffer[2];
+      }
+      cmSystemTools::GetLineFromStream(fin, buffer);
+      lineno++;
+      realbuffer = buffer.c_str();
+      if (!fin) {
+        continue;
+      }
+    }
+    if (cmState::ParseCacheEntry(realbuffer, e.Key, e.Value, e.Type)) {
+      entries.push_back(std::move(e));
+    } else {
+      ok = false;
+      if (reportErrors) {
+        std::ostringstream error;
+        error << "Parse error in cache file " << cacheFile << " on line "
+              << lineno << ". Offending entry: " << realbuffer;
+        cmSystemTools::Error(error.str());
+      }
+    }
+  }
+  return ok;
+}
+
+bool cmCacheManager::ReadBinaryCache(std::string const& path,
+                                     std::string const& cacheFile,
+                                     std::vector<ParsedEntry>& entries)
+{
+  std::uint64_t textSize;
+  std::string textHash;
+  if (!CacheFileStamp(cacheFile, textSize, textHash)) {
+    return false;
+  }
+  std::string const binaryFile = BinaryCachePath(path);
+  cmsys::ifstream fin(binaryFile.c_str(), std::ios::in | std::ios::binary);
+  if (!fin) {
+    return false;
+  }
+
+  // Check the header before reading the rest of the file.
+  std::string data(BinaryCacheHeaderSize, '\0');
+  if (!fin.read(&data[0], BinaryCacheHeaderSize) ||
+      data.compare(0, sizeof(BinaryCacheMagic), BinaryCacheMagic,
+                   sizeof(BinaryCacheMagic)) != 0) {
+    return false;
+  }
+  std::uint64_t version;
+  std::uint64_t size;
+  std::uint64_t count;
+  {
+    BinaryCacheParser header(data);
+    header.ReadUInt(version, 8); // skip magic
+    if (!header.ReadUInt(version, 4) || version != BinaryCacheVersion ||
+        !header.ReadUInt(size, 8) || size != textSize ||
+        data.compare(8 + 4 + 8, BinaryCacheHashSize, textHash) != 0) {
+      return false;
+    }
+    header.Skip(BinaryCacheHashSize);
+    if (!header.ReadUInt(count, 4)) {
+      return false;
+    }
+  }
+  data.assign(std::istreambuf_iterator<char>(fin),
+              std::istreambuf_iterator<char>());
+
+  BinaryCacheParser parser(data);
+  entries.reserve(static_cast<std::size_t>(count));
+  for (std::uint64_t i = 0; i < count; ++i) {
+    ParsedEntry e;
+    std::uint64_t type;
+    if (!parser.ReadUInt(type, 4) || type > cmStateEnums::UNINITIALIZED ||
+        !parser.ReadString(e.Key) || !parser.ReadString(e.Value) ||
+        !parser.ReadString(e.HelpString)) {
+      return false;
+    }
+    e.Type = static_cast<cmStateEnums::CacheEntryType>(type);
+    entries.push_back(std::move(e));
+  }
+  return parser.AtEnd();
+}
+
+void cmCacheManager::WriteBinaryCache(std::string const& path,
+                                      std::string const& cacheFile)
+{
+  std::string const binaryFile = BinaryCachePath(path);
+  std::uint64_t textSize;
+  std::string textHash;
+  if (!CacheFileStamp(cacheFile, textSize, textHash)) {
+    return;
+  }
+
+  // Nothing to do if the sidecar already matches CMakeCache.txt, which
+  // is the case whenever the cache has not changed.
+  {
+    cmsys::ifstream fin(binaryFile.c_str(), std::ios::in | std::ios::binary);
+    std::string header(BinaryCacheHeaderSize, '\0');
+    if (fin && fin.read(&header[0], BinaryCacheHeaderSize)) {
+      std::string expect(BinaryCacheMagic, sizeof(BinaryCacheMagic));
+      AppendUInt(expect, BinaryCacheVersion, 4);
+      AppendUInt(expect, textSize, 8);
+      expect += textHash;
+      if (header.compare(0, expect.size(), expect) == 0) {
+        return;
+      }
+    }
+  }
+
+  // Record what loading the text file produces so that both formats
+  // always load the same entries.
+  std::vector<ParsedEntry> entries;
+  {
+    cmsys::ifstream fin(cacheFile.c_str());
+    if (!fin || !ParseCacheFile(fin, cacheFile, entries, false)) {
+      cmSystemTools::RemoveFile(binaryFile);
+      return;
+    }
+  }
+
+  std::string data(BinaryCacheMagic, sizeof(BinaryCacheMagic));
+  AppendUInt(data, BinaryCacheVersion, 4);
+  AppendUInt(data, textSize, 8);
+  data += textHash;
+  AppendUInt(data, entries.size(), 4);
+  for (ParsedEntry const& e : entries) {
+    AppendUInt(data, static_cast<std::uint64_t>(e.Type), 4);
+    for (std::string const* str : { &e.Key, &e.Value, &e.HelpString }) {
+      AppendUInt(data, str->size(), 4);
+      data += *str;
+    }
+  }
+
+  cmGeneratedFileStream fout;
+  fout.Open(binaryFile, true, true);
+  fout.write(data.data(), static_cast<std::streamsize>(data.size()));
+  fout.Close();
+}
+
 const char* cmCacheManager::PersistentProperties[] = { "ADVANCED", "MODIFIED",
                                                        "STRINGS" };
 
@@ -349,6 +585,7 @@ bool cmCacheManager::SaveCache(const std::string& path, cmMessenger* messenger)
   }
   checkCache << "# This file is generated by cmake for dependency checking "
                 "of the CMakeCache.txt file\n";
+  this->WriteBinaryCache(path, cacheFile);
   return true;
 }
 
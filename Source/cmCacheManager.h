@@ -178,6 +178,28 @@ public:
   void RemoveCacheEntry(const std::string& key);
 
 private:
+  struct ParsedEntry
+  {
+    std::string Key;
+    std::string Value;
+    std::string HelpString;
+    cmStateEnums::CacheEntryType Type = cmStateEnums::UNINITIALIZED;
+  };
+
+  //! Parse the entries of a CMakeCache.txt file.  Returns false on errors.
+  static bool ParseCacheFile(std::istream& fin, std::string const& cacheFile,
+                             std::vector<ParsedEntry>& entries,
+                             bool reportErrors);
+
+  //! Read the entries from the binary sidecar if it matches the text file.
+  static bool ReadBinaryCache(std::string const& path,
+                              std::string const& cacheFile,
+                              std::vector<ParsedEntry>& entries);
+
+  //! Bring the binary sidecar up to date with the text file.
+  static void WriteBinaryCache(std::string const& path,
+                               std::string const& cacheFile);
+
   //! Get a cache entry object for a key
   CacheEntry* GetCacheEntry(const std::string& key);
   const CacheEntry* GetCacheEntry(const std::string& key) const;
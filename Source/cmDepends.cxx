@@ -14,6 +14,9 @@
 #include "cmStringAlgorithms.h"
 #include "cmSystemTools.h"
 
+char const cmDepends::DatabaseMagic[8] = { 'C', 'M', 'D', 'E',
+                                           'P', 'E', 'N', 'D' };
+
 cmDepends::cmDepends(cmLocalUnixMakefileGenerator3* lg, std::string targetDir)
   : LocalGenerator(lg)
   , TargetDirectory(std::move(targetDir))
@@ -22,7 +25,8 @@ cmDepends::cmDepends(cmLocalUnixMakefileGenerator3* lg, std::string targetDir)
 
 cmDepends::~cmDepends() = default;
 
-bool cmDepends::Write(std::ostream& makeDepends, std::ostream& internalDepends)
+bool cmDepends::Write(std::ostream& makeDepends,
+                      DependencyMap& internalDepends)
 {
   std::map<std::string, std::set<std::string>> dependencies;
   {
@@ -43,6 +47,7 @@ bool cmDepends::Write(std::ostream& makeDepends, std::ostream& internalDepends)
       dependencies[obj].insert(src);
     }
   }
+  this->PrepareDependencies(dependencies);
   for (auto const& d : dependencies) {
     // Write the dependencies for this pair.
     if (!this->WriteDependencies(d.second, d.first, makeDepends,
@@ -54,19 +59,26 @@ bool cmDepends::Write(std::ostream& makeDepends, std::ostream& internalDepends)
   return this->Finalize(makeDepends, internalDepends);
 }
 
-bool cmDepends::Finalize(std::ostream& /*unused*/, std::ostream& /*unused*/)
+bool cmDepends::Finalize(std::ostream& /*unused*/, DependencyMap& /*unused*/)
 {
   return true;
 }
 
+void cmDepends::PrepareDependencies(
+  std::map<std::string, std::set<std::string>> const& /*unused*/)
+{
+}
+
 bool cmDepends::Check(const std::string& makeFile,
                       const std::string& internalFile,
-                      DependencyMap& validDeps)
+                      DependencyMap& validDeps, bool needValidDeps)
 {
   // Check whether dependencies must be regenerated.
   bool okay = true;
-  cmsys::ifstream fin(internalFile.c_str());
-  if (!(fin && this->CheckDependencies(fin, internalFile, validDeps))) {
+  Database db;
+  if (!(ReadDatabase(internalFile, db) &&
+        this->CheckDependencies(db, internalFile, validDeps,
+                                needValidDeps))) {
     // Clear all dependencies so they will be regenerated.
     this->Clear(makeFile);
     cmSystemTools::RemoveFile(internalFile);
@@ -93,15 +105,179 @@ void cmDepends::Clear(const std::string& file)
 bool cmDepends::WriteDependencies(const std::set<std::string>& /*unused*/,
                                   const std::string& /*unused*/,
                                   std::ostream& /*unused*/,
-                                  std::ostream& /*unused*/)
+                                  DependencyMap& /*unused*/)
 {
   // This should be implemented by the subclass.
   return false;
 }
 
-bool cmDepends::CheckDependencies(std::istream& internalDepends,
+void cmDepends::AppendU32(std::string& out, std::uint32_t v)
+{
+  for (int i = 0; i < 4; ++i) {
+    out += static_cast<char>((v >> (8 * i)) & 0xFF);
+  }
+}
+
+bool cmDepends::ReadU32(std::string const& data, std::size_t& pos,
+                        std::uint32_t& v)
+{
+  if (data.size() - pos < 4) {
+    return false;
+  }
+  auto const* p = reinterpret_cast<unsigned char const*>(&data[pos]);
+  v = static_cast<std::uint32_t>(p[0]) |
+    (static_cast<std::uint32_t>(p[1]) << 8) |
+    (static_cast<std::uint32_t>(p[2]) << 16) |
+    (static_cast<std::uint32_t>(p[3]) << 24);
+  pos += 4;
+  return true;
+}
+
+void cmDepends::AppendString(std::string& out, std::string const& s)
+{
+  AppendU32(out, static_cast<std::uint32_t>(s.size()));
+  out += s;
+}
+
+bool cmDepends::ReadString(std::string const& data, std::size_t& pos,
+                           std::string& s)
+{
+  std::uint32_t length;
+  if (!ReadU32(data, pos, length) || length > data.size() - pos) {
+    return false;
+  }
+  s.assign(data, pos, length);
+  pos += length;
+  return true;
+}
+
+bool cmDepends::ReadBinaryFile(std::string const& file, std::string& data)
+{
+  cmsys::ifstream fin(file.c_str(), std::ios::in | std::ios::binary);
+  if (!fin) {
+    return false;
+  }
+  data.resize(cmSystemTools::FileLength(file));
+  fin.read(&data[0], static_cast<std::streamsize>(data.size()));
+  data.resize(static_cast<std::size_t>(fin.gcount()));
+  return true;
+}
+
+bool cmDepends::WriteDatabase(const std::string& file,
+                              DependencyMap const& internalDepends)
+{
+  // Number the paths in the order they are first used.
+  std::map<std::string, std::uint32_t> index;
+  std::vector<std::string const*> paths;
+  auto indexOf = [&index, &paths](std::string const& path) {
+    auto const inserted =
+      index.emplace(path, static_cast<std::uint32_t>(paths.size()));
+    if (inserted.second) {
+      paths.push_back(&path);
+    }
+    return inserted.first->second;
+  };
+  std::string objects;
+  std::string dependencies;
+  std::uint32_t dependencyCount = 0;
+  for (auto const& d : internalDepends) {
+    AppendU32(objects, indexOf(d.first));
+    AppendU32(objects, static_cast<std::uint32_t>(d.second.size()));
+    for (std::string const& dep : d.second) {
+      AppendU32(dependencies, indexOf(dep));
+    }
+    dependencyCount += static_cast<std::uint32_t>(d.second.size());
+  }
+
+  std::string data(DatabaseMagic, sizeof(DatabaseMagic));
+  AppendU32(data, DatabaseVersion);
+  AppendU32(data, static_cast<std::uint32_t>(paths.size()));
+  AppendU32(data, static_cast<std::uint32_t>(internalDepends.size()));
+  AppendU32(data, dependencyCount);
+  for (std::string const* path : paths) {
+    AppendString(data, *path);
+  }
+  data += objects;
+  data += dependencies;
+
+  // This should not be copy-if-different because dependencies are
+  // re-scanned when it is older than the DependInfo.cmake.
+  cmGeneratedFileStream fout;
+  fout.Open(file, false, true);
+  if (!fout) {
+    return false;
+  }
+  fout.write(data.data(), static_cast<std::streamsize>(data.size()));
+  return fout.Close();
+}
+
+bool cmDepends::ReadDatabase(const std::string& file, Database& db)
+{
+  std::string data;
+  if (!ReadBinaryFile(file, data)) {
+    return false;
+  }
+  if (data.compare(0, sizeof(DatabaseMagic), DatabaseMagic,
+                   sizeof(DatabaseMagic)) != 0) {
+    // This may be a text file written by an older version.
+    return false;
+  }
+
+  std::size_t pos = sizeof(DatabaseMagic);
+  std::uint32_t version;
+  std::uint32_t pathCount;
+  std::uint32_t objectCount;
+  std::uint32_t dependencyCount;
+  if (!ReadU32(data, pos, version) || version != DatabaseVersion ||
+      !ReadU32(data, pos, pathCount) || !ReadU32(data, pos, objectCount) ||
+      !ReadU32(data, pos, dependencyCount) ||
+      // Every path takes at least its length.
+      pathCount > (data.size() - pos) / 4) {
+    return false;
+  }
+
+  db.Paths.resize(pathCount);
+  for (std::string& path : db.Paths) {
+    if (!ReadString(data, pos, path)) {
+      return false;
+    }
+  }
+
+  std::size_t const remaining = data.size() - pos;
+  if (objectCount > remaining / 8 ||
+      dependencyCount != (remaining - objectCount * 8) / 4 ||
+      (remaining - objectCount * 8) % 4 != 0) {
+    return false;
+  }
+  db.Objects.resize(objectCount);
+  std::uint32_t first = 0;
+  for (Database::Object& object : db.Objects) {
+    ReadU32(data, pos, object.Path);
+    ReadU32(data, pos, object.DependencyCount);
+    if (object.Path >= pathCount ||
+        object.DependencyCount > dependencyCount - first) {
+      return false;
+    }
+    object.FirstDependency = first;
+    first += object.DependencyCount;
+  }
+  if (first != dependencyCount) {
+    return false;
+  }
+  db.Dependencies.resize(dependencyCount);
+  for (std::uint32_t& dependency : db.Dependencies) {
+    ReadU32(data, pos, dependency);
+    if (dependency >= pathCount) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool cmDepends::CheckDependencies(Database const& internalDepends,
                                   const std::string& internalDependsFileName,
-                                  DependencyMap& validDeps)
+                                  DependencyMap& validDeps,
+                                  bool needValidDeps)
 {
   // Read internal depends file time
   cmFileTime internalDependsTime;
@@ -110,94 +286,83 @@ bool cmDepends::CheckDependencies(std::istream& internalDepends,
     return false;
   }
 
-  // Parse dependencies from the stream.  If any dependee is missing
-  // or newer than the depender then dependencies should be
-  // regenerated.
-  bool okay = true;
-  bool dependerExists = false;
-
-  std::string line;
-  line.reserve(1024);
-  std::string depender;
-  std::string dependee;
-  cmFileTime dependerTime;
-  cmFileTime dependeeTime;
-  std::vector<std::string>* currentDependencies = nullptr;
-
-  while (std::getline(internalDepends, line)) {
-    // Check if this an empty or a comment line
-    if (line.empty() || line.front() == '#') {
-      continue;
-    }
-    // Drop carriage return character at the end
-    if (line.back() == '\r') {
-      line.pop_back();
-      if (line.empty()) {
-        continue;
-      }
-    }
-    // Check if this a depender line
-    if (line.front() != ' ') {
-      depender = line;
-      dependerExists = this->FileTimeCache->Load(depender, dependerTime);
-      // If we erase validDeps[this->Depender] by overwriting it with an empty
-      // vector, we lose dependencies for dependers that have multiple
-      // entries. No need to initialize the entry, std::map will do so on first
-      // access.
-      currentDependencies = &validDeps[depender];
-      continue;
-    }
+  // Read the time of every file once.  A path that does not exist keeps
+  // no time.
+  std::vector<cmFileTime> times(internalDepends.Paths.size());
+  std::vector<bool> exists(internalDepends.Paths.size());
+  for (std::size_t i = 0; i < internalDepends.Paths.size(); ++i) {
+    exists[i] =
+      this->FileTimeCache->Load(internalDepends.Paths[i], times[i]);
+  }
 
-    // This is a dependee line
-    dependee = line.substr(1);
+  // If any dependee is missing or newer than the depender then
+  // dependencies should be regenerated.
+  bool okay = true;
+  std::vector<Database::Object const*> validObjects;
+  for (Database::Object const& object : internalDepends.Objects) {
+    std::string const& depender = internalDepends.Paths[object.Path];
+    bool const dependerExists = exists[object.Path];
+    auto const first =
+      internalDepends.Dependencies.begin() + object.FirstDependency;
+    auto const last = first + object.DependencyCount;
 
-    // Add dependee to depender's list
-    if (currentDependencies != nullptr) {
-      currentDependencies->push_back(dependee);
+    // Only the first missing and the newest dependee matter.
+    auto missing = last;
+    auto newest = last;
+    for (auto d = first; d != last; ++d) {
+      if (!exists[*d]) {
+        missing = d;
+        break;
+      }
+      if (newest == last || times[*newest].Older(times[*d])) {
+        newest = d;
+      }
     }
 
     // Dependencies must be regenerated
-    // * if the dependee does not exist
-    // * if the depender exists and is older than the dependee.
-    // * if the depender does not exist, but the dependee is newer than the
+    // * if a dependee does not exist
+    // * if the depender exists and is older than a dependee.
+    // * if the depender does not exist, but a dependee is newer than the
     //   depends file
     bool regenerate = false;
-    bool dependeeExists = this->FileTimeCache->Load(dependee, dependeeTime);
-    if (!dependeeExists) {
+    if (missing != last) {
       // The dependee does not exist.
       regenerate = true;
 
       // Print verbose output.
       if (this->Verbose) {
-        cmSystemTools::Stdout(cmStrCat("Dependee \"", dependee,
-                                       "\" does not exist for depender \"",
-                                       depender, "\".\n"));
+        cmSystemTools::Stdout(
+          cmStrCat("Dependee \"", internalDepends.Paths[*missing],
+                   "\" does not exist for depender \"", depender, "\".\n"));
       }
+    } else if (newest == last) {
+      // There are no dependees.
     } else if (dependerExists) {
       // The dependee and depender both exist.  Compare file times.
-      if (dependerTime.Older(dependeeTime)) {
+      if (times[object.Path].Older(times[*newest])) {
         // The depender is older than the dependee.
         regenerate = true;
 
         // Print verbose output.
         if (this->Verbose) {
-          cmSystemTools::Stdout(cmStrCat("Dependee \"", dependee,
-                                         "\" is newer than depender \"",
-                                         depender, "\".\n"));
+          cmSystemTools::Stdout(
+            cmStrCat("Dependee \"", internalDepends.Paths[*newest],
+                     "\" is newer than depender \"", depender, "\".\n"));
         }
       }
     } else {
       // The dependee exists, but the depender doesn't. Regenerate if the
       // internalDepends file is older than the dependee.
-      if (internalDependsTime.Older(dependeeTime)) {
+      if (internalDependsTime.Older(times[*newest])) {
         // The depends-file is older than the dependee.
         regenerate = true;
 
         // Print verbose output.
         if (this->Verbose) {
-          cmSystemTools::Stdout(cmStrCat("Dependee \"", dependee,
-                                         "\" is newer than depends file \"",
-                                         internalDependsFileName, "\".\n"));
+          cmSystemTools::Stdout(cmStrCat(
+            "Dependee \"", internalDepends.Paths[*newest],
+            "\" is newer than depends file \"", internalDependsFileName,
+            "\".\n"));
         }
       }
     }
@@ -206,22 +371,30 @@ bool cmDepends::CheckDependencies(std::istream& internalDepends,
       // Dependencies must be regenerated.
       okay = false;
 
-      // Remove the information of this depender from the map, it needs
-      // to be rescanned
-      if (currentDependencies != nullptr) {
-        validDeps.erase(depender);
-        currentDependencies = nullptr;
-      }
-
       // Remove the depender to be sure it is rebuilt.
       if (dependerExists) {
         cmSystemTools::RemoveFile(depender);
         this->FileTimeCache->Remove(depender);
-        dependerExists = false;
       }
+      continue;
     }
+    validObjects.push_back(&object);
   }
 
+  // Copying the dependencies is the most expensive part of the check,
+  // so skip it if nothing will be scanned.
+  if (okay && !needValidDeps) {
+    return okay;
+  }
+  for (Database::Object const* object : validObjects) {
+    std::vector<std::string>& dependencies =
+      validDeps[internalDepends.Paths[object->Path]];
+    auto const first =
+      internalDepends.Dependencies.begin() + object->FirstDependency;
+    for (auto d = first; d != first + object->DependencyCount; ++d) {
+      dependencies.push_back(internalDepends.Paths[*d]);
+    }
+  }
   return okay;
 }
 
@@ -5,6 +5,7 @@
 
 #include "cmConfigure.h" // IWYU pragma: keep
 
+#include <cstdint>
 #include <iosfwd>
 #include <map>
 #include <set>
@@ -20,6 +21,19 @@ class cmLocalUnixMakefileGenerator3;
  * This class is responsible for maintaining a .depends.make file in
  * the build tree corresponding to an object file.  Subclasses help it
  * maintain dependencies for particular languages.
+ *
+ * The dependencies are also recorded in the binary depend.internal
+ * database of the target, which is used to check whether they must be
+ * scanned again.  Layout (all integers little-endian):
+ *
+ *   header:       "CMDEPEND", u32 version,
+ *                 u32 path count, u32 object count, u32 dependency count
+ *   paths:        path count * { u32 length, length bytes }
+ *   objects:      object count * { u32 path, u32 dependency count }
+ *   dependencies: dependency count * u32 path
+ *
+ * Every path is stored once, so checking the database reads the time of
+ * each file once however many objects depend on it.
  */
 class cmDepends
 {
@@ -60,15 +74,16 @@ public:
   virtual ~cmDepends();
 
   /** Write dependencies for the target file.  */
-  bool Write(std::ostream& makeDepends, std::ostream& internalDepends);
+  bool Write(std::ostream& makeDepends, DependencyMap& internalDepends);
 
   /** Check dependencies for the target file.  Returns true if
       dependencies are okay and false if they must be generated.  If
       they must be generated Clear has already been called to wipe out
       the old dependencies.
-      Dependencies which are still valid will be stored in validDeps. */
+      Dependencies which are still valid will be stored in validDeps
+      unless all of them are valid and needValidDeps is false.  */
   bool Check(const std::string& makeFile, const std::string& internalFile,
-             DependencyMap& validDeps);
+             DependencyMap& validDeps, bool needValidDeps = true);
 
   /** Clear dependencies for the target file so they will be regenerated.  */
   void Clear(const std::string& file);
@@ -76,24 +91,65 @@ public:
   /** Set the file comparison object */
   void SetFileTimeCache(cmFileTimeCache* fc) { this->FileTimeCache = fc; }
 
+  /** The internal dependency database as it is stored in the file.  */
+  struct Database
+  {
+    struct Object
+    {
+      std::uint32_t Path;
+      std::uint32_t FirstDependency;
+      std::uint32_t DependencyCount;
+    };
+    std::vector<std::string> Paths;
+    std::vector<Object> Objects;
+    std::vector<std::uint32_t> Dependencies;
+  };
+
+  /** Write the internal dependency database of a target.  */
+  static bool WriteDatabase(const std::string& file,
+                            DependencyMap const& internalDepends);
+
+  /** Read the internal dependency database of a target.  Return false if
+      the file does not exist or is not a valid database.  */
+  static bool ReadDatabase(const std::string& file, Database& db);
+
+  static char const DatabaseMagic[8];
+  static std::uint32_t const DatabaseVersion = 1;
+
 protected:
   // Write dependencies for the target file to the given stream.
   // Return true for success and false for failure.
   virtual bool WriteDependencies(const std::set<std::string>& sources,
                                  const std::string& obj,
                                  std::ostream& makeDepends,
-                                 std::ostream& internalDepends);
+                                 DependencyMap& internalDepends);
+
+  // Prepare writing the dependencies of all object files of the target,
+  // given as a map from object file to its sources.
+  virtual void PrepareDependencies(
+    std::map<std::string, std::set<std::string>> const& objects);
 
-  // Check dependencies for the target file in the given stream.
+  // Check dependencies for the target file in the given database.
   // Return false if dependencies must be regenerated and true
   // otherwise.
-  virtual bool CheckDependencies(std::istream& internalDepends,
+  virtual bool CheckDependencies(Database const& internalDepends,
                                  const std::string& internalDependsFileName,
-                                 DependencyMap& validDeps);
+                                 DependencyMap& validDeps,
+                                 bool needValidDeps);
 
   // Finalize the dependency information for the target.
   virtual bool Finalize(std::ostream& makeDepends,
-                        std::ostream& internalDepends);
+                        DependencyMap& internalDepends);
+
+  // Encoding of the binary files written by the scanners.  The readers
+  // return false and leave the position unspecified on truncated input.
+  static void AppendU32(std::string& out, std::uint32_t v);
+  static bool ReadU32(std::string const& data, std::size_t& pos,
+                      std::uint32_t& v);
+  static void AppendString(std::string& out, std::string const& s);
+  static bool ReadString(std::string const& data, std::size_t& pos,
+                         std::string& s);
+  static bool ReadBinaryFile(std::string const& file, std::string& data);
 
   // The local generator.
   cmLocalUnixMakefileGenerator3* LocalGenerator;
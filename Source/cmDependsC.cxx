@@ -2,24 +2,42 @@
    file Copyright.txt or https://cmake.org/licensing for details.  */
 #include "cmDependsC.h"
 
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <queue>
 #include <utility>
 
+#if !defined(CMAKE_BOOTSTRAP)
+#  include <functional>
+#  include <thread>
+#endif
+
 #include "cmsys/FStream.hxx"
 
 #include "cmFileTime.h"
+#include "cmGeneratedFileStream.h"
 #include "cmLocalUnixMakefileGenerator3.h"
 #include "cmMakefile.h"
 #include "cmStringAlgorithms.h"
 #include "cmSystemTools.h"
 
+#if !defined(CMAKE_BOOTSTRAP)
+#  include "cmWorkerPool.h"
+#endif
+
+// The include lines are matched by ParseIncludeLine below rather than by
+// this expression.  It is still recorded in the cache file because it
+// documents what is matched.
 #define INCLUDE_REGEX_LINE                                                    \
   "^[ \t]*[#%][ \t]*(include|import)[ \t]*[<\"]([^\">]+)([\">])"
 
 #define INCLUDE_REGEX_LINE_MARKER "#IncludeRegexLine: "
-#define INCLUDE_REGEX_SCAN_MARKER "#IncludeRegexScan: "
-#define INCLUDE_REGEX_COMPLAIN_MARKER "#IncludeRegexComplain: "
 #define INCLUDE_REGEX_TRANSFORM_MARKER "#IncludeRegexTransform: "
 
+char const cmDependsC::CacheMagic[8] = { 'C', 'M', 'I', 'N',
+                                         'C', 'L', 'U', 'D' };
+
 cmDependsC::cmDependsC() = default;
 
 cmDependsC::cmDependsC(cmLocalUnixMakefileGenerator3* lg,
@@ -48,19 +66,23 @@ cmDependsC::cmDependsC(cmLocalUnixMakefileGenerator3* lg,
     }
   }
 
-  this->IncludeRegexLine.compile(INCLUDE_REGEX_LINE);
   this->IncludeRegexScan.compile(scanRegex);
   this->IncludeRegexComplain.compile(complainRegex);
   this->IncludeRegexLineString = INCLUDE_REGEX_LINE_MARKER INCLUDE_REGEX_LINE;
-  this->IncludeRegexScanString =
-    cmStrCat(INCLUDE_REGEX_SCAN_MARKER, scanRegex);
-  this->IncludeRegexComplainString =
-    cmStrCat(INCLUDE_REGEX_COMPLAIN_MARKER, complainRegex);
 
   this->SetupTransforms();
 
-  this->CacheFileName =
-    cmStrCat(this->TargetDirectory, '/', lang, ".includecache");
+  this->DependeeRules = mf->IsOn("CMAKE_DEPENDS_DEPENDEE_RULES");
+
+  // The include lines of a file depend only on the transforms.  Without
+  // them, share the cache between all targets of the build tree.
+  if (this->TransformRules.empty()) {
+    this->CacheFileName = cmStrCat(lg->GetBinaryDirectory(),
+                                   "/CMakeFiles/CMakeIncludeCache.bin");
+  } else {
+    this->CacheFileName =
+      cmStrCat(this->TargetDirectory, '/', lang, ".includecache");
+  }
 
   this->ReadCacheFile();
 }
@@ -73,7 +95,7 @@ cmDependsC::~cmDependsC()
 bool cmDependsC::WriteDependencies(const std::set<std::string>& sources,
                                    const std::string& obj,
                                    std::ostream& makeDepends,
-                                   std::ostream& internalDepends)
+                                   DependencyMap& internalDepends)
 {
   // Make sure this is a scanning instance.
   if (sources.empty() || sources.begin()->empty()) {
@@ -105,107 +127,21 @@ bool cmDependsC::WriteDependencies(const std::set<std::string>& sources,
   }
 
   if (!haveDeps) {
-    // Walk the dependency graph starting with the source file.
-    int srcFiles = static_cast<int>(sources.size());
-    this->Encountered.clear();
-
-    for (std::string const& src : sources) {
-      UnscannedEntry root;
-      root.FileName = src;
-      this->Unscanned.push(root);
-      this->Encountered.insert(src);
-    }
-
-    std::set<std::string> scanned;
-    while (!this->Unscanned.empty()) {
-      // Get the next file to scan.
-      UnscannedEntry current = this->Unscanned.front();
-      this->Unscanned.pop();
-
-      // If not a full path, find the file in the include path.
-      std::string fullName;
-      if ((srcFiles > 0) || cmSystemTools::FileIsFullPath(current.FileName)) {
-        if (cmSystemTools::FileExists(current.FileName, true)) {
-          fullName = current.FileName;
-        }
-      } else if (!current.QuotedLocation.empty() &&
-                 cmSystemTools::FileExists(current.QuotedLocation, true)) {
-        // The include statement producing this entry was a double-quote
-        // include and the included file is present in the directory of
-        // the source containing the include statement.
-        fullName = current.QuotedLocation;
-      } else {
-        auto headerLocationIt =
-          this->HeaderLocationCache.find(current.FileName);
-        if (headerLocationIt != this->HeaderLocationCache.end()) {
-          fullName = headerLocationIt->second;
-        } else {
-          for (std::string const& iPath : this->IncludePath) {
-            // Construct the name of the file as if it were in the current
-            // include directory.  Avoid using a leading "./".
-            std::string tmpPath =
-              cmSystemTools::CollapseFullPath(current.FileName, iPath);
-
-            // Look for the file in this location.
-            if (cmSystemTools::FileExists(tmpPath, true)) {
-              fullName = tmpPath;
-              this->HeaderLocationCache[current.FileName] = std::move(tmpPath);
-              break;
-            }
-          }
-        }
-      }
-
-      // Complain if the file cannot be found and matches the complain
-      // regex.
-      if (fullName.empty() &&
-          this->IncludeRegexComplain.find(current.FileName)) {
-        cmSystemTools::Error("Cannot find file \"" + current.FileName + "\".");
-        return false;
-      }
-
-      // Scan the file if it was found and has not been scanned already.
-      if (!fullName.empty() && (scanned.find(fullName) == scanned.end())) {
-        // Record scanned files.
-        scanned.insert(fullName);
-
-        // Check whether this file is already in the cache
-        auto fileIt = this->FileCache.find(fullName);
-        if (fileIt != this->FileCache.end()) {
-          fileIt->second.Used = true;
-          dependencies.insert(fullName);
-          for (UnscannedEntry const& inc : fileIt->second.UnscannedEntries) {
-            if (this->Encountered.find(inc.FileName) ==
-                this->Encountered.end()) {
-              this->Encountered.insert(inc.FileName);
-              this->Unscanned.push(inc);
-            }
-          }
-        } else {
-
-          // Try to scan the file.  Just leave it out if we cannot find
-          // it.
-          cmsys::ifstream fin(fullName.c_str());
-          if (fin) {
-            cmsys::FStream::BOM bom = cmsys::FStream::ReadBOM(fin);
-            if (bom == cmsys::FStream::BOM_None ||
-                bom == cmsys::FStream::BOM_UTF8) {
-              // Add this file as a dependency.
-              dependencies.insert(fullName);
-
-              // Scan this file for new dependencies.  Pass the directory
-              // containing the file to handle double-quote includes.
-              std::string dir = cmSystemTools::GetFilenamePath(fullName);
-              this->Scan(fin, dir, fullName);
-            } else {
-              // Skip file with encoding we do not implement.
-            }
-          }
-        }
-      }
-
-      srcFiles--;
+    // Use the result of scanning ahead if there is one.
+    ScanResult result;
+    auto const resultIt = this->ScanResults.find(obj);
+    if (resultIt != this->ScanResults.end()) {
+      result = std::move(resultIt->second);
+      this->ScanResults.erase(resultIt);
+    } else {
+      Matcher matcher = this->GetMatcher();
+      this->ScanSources(sources, matcher, result);
+    }
+    if (!result.Error.empty()) {
+      cmSystemTools::Error(result.Error);
+      return false;
     }
+    dependencies = std::move(result.Dependencies);
   }
 
   // Write the dependencies to the output stream.  Makefile rules
@@ -213,170 +149,524 @@ bool cmDependsC::WriteDependencies(const std::set<std::string>& sources,
   // convert the dependencies to paths relative to the home output
   // directory.  We must do the same here.
   std::string obj_m = this->LocalGenerator->ConvertToMakefilePath(obj_i);
-  internalDepends << obj_i << '\n';
+  std::vector<std::string>& internalDeps = internalDepends[obj_i];
 
   for (std::string const& dep : dependencies) {
-    makeDepends << obj_m << ": "
-                << this->LocalGenerator->ConvertToMakefilePath(
-                     this->LocalGenerator->MaybeConvertToRelativePath(binDir,
-                                                                      dep))
-                << '\n';
-    internalDepends << ' ' << dep << '\n';
+    std::string dep_m = this->LocalGenerator->ConvertToMakefilePath(
+      this->LocalGenerator->MaybeConvertToRelativePath(binDir, dep));
+    makeDepends << obj_m << ": " << dep_m << '\n';
+    internalDeps.push_back(dep);
+    if (this->DependeeRules) {
+      this->Dependees.insert(std::move(dep_m));
+    }
   }
   makeDepends << '\n';
 
   return true;
 }
 
-void cmDependsC::ReadCacheFile()
+#if !defined(CMAKE_BOOTSTRAP)
+namespace {
+class cmDependsCScanJob : public cmWorkerPool::JobT
 {
-  if (this->CacheFileName.empty()) {
-    return;
-  }
-  cmsys::ifstream fin(this->CacheFileName.c_str());
-  if (!fin) {
-    return;
+public:
+  cmDependsCScanJob(std::function<void(unsigned int)> scan)
+    : Scan(std::move(scan))
+  {
   }
 
-  std::string line;
-  cmIncludeLines* cacheEntry = nullptr;
-  bool haveFileName = false;
+  void Process() override { this->Scan(this->WorkerIndex()); }
+
+private:
+  std::function<void(unsigned int)> Scan;
+};
 
-  cmFileTime cacheFileTime;
-  bool const cacheFileTimeGood = cacheFileTime.Load(this->CacheFileName);
-  while (cmSystemTools::GetLineFromStream(fin, line)) {
-    if (line.empty()) {
-      cacheEntry = nullptr;
-      haveFileName = false;
+class cmDependsCEndJob : public cmWorkerPool::JobFenceT
+{
+public:
+  void Process() override { this->Pool()->Abort(); }
+};
+}
+#endif
+
+void cmDependsC::PrepareDependencies(
+  std::map<std::string, std::set<std::string>> const& objects)
+{
+#if !defined(CMAKE_BOOTSTRAP)
+  // Collect the objects whose dependencies must be scanned.
+  std::string const& binDir = this->LocalGenerator->GetBinaryDirectory();
+  std::vector<std::pair<std::set<std::string> const*, ScanResult*>> pending;
+  for (auto const& object : objects) {
+    if (object.first.empty() || object.second.empty() ||
+        object.second.begin()->empty()) {
       continue;
     }
-    // the first line after an empty line is the name of the parsed file
-    if (!haveFileName) {
-      haveFileName = true;
+    if (this->ValidDeps != nullptr &&
+        this->ValidDeps->count(
+          this->LocalGenerator->MaybeConvertToRelativePath(
+            binDir, object.first)) != 0) {
+      continue;
+    }
+    pending.emplace_back(&object.second, &this->ScanResults[object.first]);
+  }
 
-      cmFileTime fileTime;
-      bool const res = cacheFileTimeGood && fileTime.Load(line);
-      bool const newer = res && cacheFileTime.Newer(fileTime);
+  unsigned int const threads = std::min<unsigned int>(
+    std::max(std::thread::hardware_concurrency(), 1u),
+    static_cast<unsigned int>(std::min<std::size_t>(pending.size(), 16)));
+  if (threads <= 1) {
+    // Scan the objects one by one while writing their dependencies.
+    this->ScanResults.clear();
+    return;
+  }
 
-      if (res && newer) // cache is newer than the parsed file
-      {
-        cacheEntry = &this->FileCache[line];
+  // Each worker thread walks include graphs with its own matcher.  The
+  // file cache is shared between them.
+  std::vector<Matcher> matchers(threads, this->GetMatcher());
+  cmWorkerPool pool;
+  pool.SetThreadCount(threads);
+  for (auto const& p : pending) {
+    pool.EmplaceJob<cmDependsCScanJob>(
+      [this, &matchers, p](unsigned int worker) {
+        this->ScanSources(*p.first, matchers[worker], *p.second);
+      });
+  }
+  pool.EmplaceJob<cmDependsCEndJob>();
+  pool.Process();
+#else
+  static_cast<void>(objects);
+#endif
+}
+
+cmDependsC::Matcher cmDependsC::GetMatcher() const
+{
+  return Matcher{ this->IncludeRegexScan, this->IncludeRegexComplain,
+                  this->IncludeRegexTransform };
+}
+
+void cmDependsC::ScanSources(std::set<std::string> const& sources,
+                             Matcher& matcher, ScanResult& result)
+{
+  // Walk the dependency graph starting with the source file.
+  int srcFiles = static_cast<int>(sources.size());
+  std::set<std::string> encountered;
+  std::queue<UnscannedEntry> unscanned;
+
+  for (std::string const& src : sources) {
+    UnscannedEntry root;
+    root.FileName = src;
+    unscanned.push(root);
+    encountered.insert(src);
+  }
+
+  std::set<std::string> scanned;
+  while (!unscanned.empty()) {
+    // Get the next file to scan.
+    UnscannedEntry current = std::move(unscanned.front());
+    unscanned.pop();
+
+    // If not a full path, find the file in the include path.
+    std::string fullName;
+    if ((srcFiles > 0) || cmSystemTools::FileIsFullPath(current.FileName)) {
+      if (cmSystemTools::FileExists(current.FileName, true)) {
+        fullName = current.FileName;
       }
-      // file doesn't exist, check that the regular expressions
-      // haven't changed
-      else if (!res) {
-        if (cmHasLiteralPrefix(line, INCLUDE_REGEX_LINE_MARKER)) {
-          if (line != this->IncludeRegexLineString) {
-            return;
-          }
-        } else if (cmHasLiteralPrefix(line, INCLUDE_REGEX_SCAN_MARKER)) {
-          if (line != this->IncludeRegexScanString) {
-            return;
-          }
-        } else if (cmHasLiteralPrefix(line, INCLUDE_REGEX_COMPLAIN_MARKER)) {
-          if (line != this->IncludeRegexComplainString) {
-            return;
-          }
-        } else if (cmHasLiteralPrefix(line, INCLUDE_REGEX_TRANSFORM_MARKER)) {
-          if (line != this->IncludeRegexTransformString) {
-            return;
+    } else if (!current.QuotedLocation.empty() &&
+               cmSystemTools::FileExists(current.QuotedLocation, true)) {
+      // The include statement producing this entry was a double-quote
+      // include and the included file is present in the directory of
+      // the source containing the include statement.
+      fullName = current.QuotedLocation;
+    } else {
+      fullName = this->FindHeader(current.FileName);
+    }
+
+    // Complain if the file cannot be found and matches the complain
+    // regex.
+    if (fullName.empty() && matcher.Complain.find(current.FileName)) {
+      result.Error = "Cannot find file \"" + current.FileName + "\".";
+      return;
+    }
+
+    // Scan the file if it was found and has not been scanned already.
+    if (!fullName.empty() && scanned.insert(fullName).second) {
+      // Just leave the file out if we cannot read it.
+      if (cmIncludeLines const* lines =
+            this->GetIncludeLines(fullName, matcher)) {
+        // Add this file as a dependency.
+        result.Dependencies.insert(fullName);
+
+        // Queue the files it includes if they have not yet been
+        // encountered and match the regular expression for recursive
+        // scanning.  Note that this check does not account for the
+        // possibility of two headers with the same name in different
+        // directories when one is included by double-quotes and the
+        // other by angle brackets.  It also does not work properly if
+        // two header files with the same name exist in different
+        // directories, and both are included from a file their own
+        // directory by simply using "filename.h" (#12619)
+        // This kind of problem will be fixed when a more
+        // preprocessor-like implementation of this scanner is created.
+        for (UnscannedEntry const& inc : lines->UnscannedEntries) {
+          if (matcher.Scan.find(inc.FileName) &&
+              encountered.insert(inc.FileName).second) {
+            unscanned.push(inc);
           }
         }
       }
-    } else if (cacheEntry != nullptr) {
-      UnscannedEntry entry;
-      entry.FileName = line;
-      if (cmSystemTools::GetLineFromStream(fin, line)) {
-        if (line != "-") {
-          entry.QuotedLocation = line;
-        }
-        cacheEntry->UnscannedEntries.push_back(std::move(entry));
-      }
+    }
+
+    srcFiles--;
+  }
+}
+
+std::string cmDependsC::FindHeader(std::string const& fileName)
+{
+  {
+#if !defined(CMAKE_BOOTSTRAP)
+    std::lock_guard<std::mutex> lock(this->CacheMutex);
+#endif
+    auto const it = this->HeaderLocationCache.find(fileName);
+    if (it != this->HeaderLocationCache.end()) {
+      return it->second;
+    }
+  }
+  for (std::string const& iPath : this->IncludePath) {
+    // Construct the name of the file as if it were in the current
+    // include directory.  Avoid using a leading "./".
+    std::string tmpPath = cmSystemTools::CollapseFullPath(fileName, iPath);
+
+    // Look for the file in this location.
+    if (cmSystemTools::FileExists(tmpPath, true)) {
+#if !defined(CMAKE_BOOTSTRAP)
+      std::lock_guard<std::mutex> lock(this->CacheMutex);
+#endif
+      this->HeaderLocationCache[fileName] = tmpPath;
+      return tmpPath;
     }
   }
+  return std::string();
 }
 
-void cmDependsC::WriteCacheFile() const
+cmDependsC::cmIncludeLines const* cmDependsC::GetIncludeLines(
+  std::string const& fullName, Matcher& matcher)
+{
+  // Entries handed out are never modified again, so they may be used
+  // without holding the lock.
+  {
+#if !defined(CMAKE_BOOTSTRAP)
+    std::lock_guard<std::mutex> lock(this->CacheMutex);
+#endif
+    auto const it = this->FileCache.find(fullName);
+    if (it != this->FileCache.end() && it->second.Checked) {
+      return &it->second;
+    }
+  }
+
+  cmIncludeLines lines;
+  cmFileTime fileTime;
+  if (fileTime.Load(fullName)) {
+    lines.Time = fileTime.GetNS();
+    lines.Size = cmSystemTools::FileLength(fullName);
+  }
+  lines.Checked = true;
+
+  // Use an entry read from the cache file if the file did not change.
+  {
+#if !defined(CMAKE_BOOTSTRAP)
+    std::lock_guard<std::mutex> lock(this->CacheMutex);
+#endif
+    auto const it = this->FileCache.find(fullName);
+    if (it != this->FileCache.end() &&
+        (it->second.Checked ||
+         (it->second.Time == lines.Time && it->second.Size == lines.Size))) {
+      it->second.Checked = true;
+      return &it->second;
+    }
+  }
+
+  // Try to scan the file.  It is read as a whole so that the scanner can
+  // search it for directives without splitting it into lines first.
+  cmsys::ifstream fin(fullName.c_str(), std::ios::in | std::ios::binary);
+  if (!fin) {
+    return nullptr;
+  }
+  cmsys::FStream::BOM bom = cmsys::FStream::ReadBOM(fin);
+  if (bom != cmsys::FStream::BOM_None && bom != cmsys::FStream::BOM_UTF8) {
+    // Skip file with encoding we do not implement.
+    return nullptr;
+  }
+  std::string content;
+  content.reserve(lines.Size);
+  char buffer[16384];
+  while (fin.read(buffer, sizeof(buffer)) || fin.gcount() > 0) {
+    content.append(buffer, static_cast<std::size_t>(fin.gcount()));
+  }
+  // Pass the directory containing the file to handle double-quote
+  // includes.
+  this->Scan(content, cmSystemTools::GetFilenamePath(fullName),
+             lines.UnscannedEntries, matcher);
+
+#if !defined(CMAKE_BOOTSTRAP)
+  std::lock_guard<std::mutex> lock(this->CacheMutex);
+#endif
+  cmIncludeLines& entry = this->FileCache[fullName];
+  // Another thread may have scanned the file meanwhile.
+  if (!entry.Checked) {
+    entry = std::move(lines);
+    this->FileCacheChanged = true;
+  }
+  return &entry;
+}
+
+bool cmDependsC::Finalize(std::ostream& makeDepends,
+                          DependencyMap& /*unused*/)
+{
+  for (std::string const& dep : this->Dependees) {
+    makeDepends << dep << ":\n";
+  }
+  if (!this->Dependees.empty()) {
+    makeDepends << '\n';
+  }
+  return true;
+}
+
+void cmDependsC::ReadCacheFile()
 {
   if (this->CacheFileName.empty()) {
     return;
   }
-  cmsys::ofstream cacheOut(this->CacheFileName.c_str());
-  if (!cacheOut) {
+  std::string data;
+  if (!ReadBinaryFile(this->CacheFileName, data) ||
+      data.compare(0, sizeof(CacheMagic), CacheMagic, sizeof(CacheMagic)) !=
+        0) {
+    // This may be a text file written by an older version.
     return;
   }
 
-  cacheOut << this->IncludeRegexLineString << "\n\n";
-  cacheOut << this->IncludeRegexScanString << "\n\n";
-  cacheOut << this->IncludeRegexComplainString << "\n\n";
-  cacheOut << this->IncludeRegexTransformString << "\n\n";
+  // The cache is only valid for the expressions used to produce it.
+  std::size_t pos = sizeof(CacheMagic);
+  std::uint32_t version;
+  std::string regexLine;
+  std::string regexTransform;
+  std::uint32_t entryCount;
+  if (!ReadU32(data, pos, version) || version != CacheVersion ||
+      !ReadString(data, pos, regexLine) ||
+      regexLine != this->IncludeRegexLineString ||
+      !ReadString(data, pos, regexTransform) ||
+      regexTransform != this->IncludeRegexTransformString ||
+      !ReadU32(data, pos, entryCount)) {
+    return;
+  }
 
-  for (auto const& fileIt : this->FileCache) {
-    if (fileIt.second.Used) {
-      cacheOut << fileIt.first << '\n';
-
-      for (UnscannedEntry const& inc : fileIt.second.UnscannedEntries) {
-        cacheOut << inc.FileName << '\n';
-        if (inc.QuotedLocation.empty()) {
-          cacheOut << '-' << '\n';
-        } else {
-          cacheOut << inc.QuotedLocation << '\n';
-        }
+  // Read all entries before using any of them so that a truncated file
+  // is ignored as a whole.
+  std::vector<std::pair<std::string, cmIncludeLines>> entries;
+  for (std::uint32_t i = 0; i < entryCount; ++i) {
+    std::pair<std::string, cmIncludeLines> entry;
+    std::uint32_t timeLow;
+    std::uint32_t timeHigh;
+    std::uint32_t size;
+    std::uint32_t includeCount;
+    if (!ReadString(data, pos, entry.first) ||
+        !ReadU32(data, pos, timeLow) || !ReadU32(data, pos, timeHigh) ||
+        !ReadU32(data, pos, size) || !ReadU32(data, pos, includeCount)) {
+      return;
+    }
+    entry.second.Time = static_cast<long long>(
+      (static_cast<std::uint64_t>(timeHigh) << 32) | timeLow);
+    entry.second.Size = size;
+    for (std::uint32_t j = 0; j < includeCount; ++j) {
+      UnscannedEntry include;
+      if (!ReadString(data, pos, include.FileName) ||
+          !ReadString(data, pos, include.QuotedLocation)) {
+        return;
       }
-      cacheOut << '\n';
+      entry.second.UnscannedEntries.push_back(std::move(include));
+    }
+    entries.push_back(std::move(entry));
+  }
+  if (pos != data.size()) {
+    return;
+  }
+
+  // Entries already present are kept since they are newer.
+  for (auto& entry : entries) {
+    this->FileCache.emplace(std::move(entry));
+  }
+}
+
+void cmDependsC::WriteCacheFile()
+{
+  if (this->CacheFileName.empty() || !this->FileCacheChanged) {
+    return;
+  }
+
+  // Other processes may have updated the cache since it was read.
+  // Merge their entries before replacing the file.
+  this->ReadCacheFile();
+
+  // Drop entries of files that were removed or changed since they were
+  // scanned so that the shared cache does not grow without bound.  The
+  // entries used by this process were already checked.
+  for (auto it = this->FileCache.begin(); it != this->FileCache.end();) {
+    cmFileTime fileTime;
+    if (it->second.Checked ||
+        (fileTime.Load(it->first) && fileTime.GetNS() == it->second.Time &&
+         cmSystemTools::FileLength(it->first) == it->second.Size)) {
+      ++it;
+    } else {
+      it = this->FileCache.erase(it);
     }
   }
+
+  std::string data(CacheMagic, sizeof(CacheMagic));
+  AppendU32(data, CacheVersion);
+  AppendString(data, this->IncludeRegexLineString);
+  AppendString(data, this->IncludeRegexTransformString);
+  AppendU32(data, static_cast<std::uint32_t>(this->FileCache.size()));
+  for (auto const& fileIt : this->FileCache) {
+    auto const time = static_cast<std::uint64_t>(fileIt.second.Time);
+    AppendString(data, fileIt.first);
+    AppendU32(data, static_cast<std::uint32_t>(time & 0xFFFFFFFF));
+    AppendU32(data, static_cast<std::uint32_t>(time >> 32));
+    AppendU32(data, static_cast<std::uint32_t>(fileIt.second.Size));
+    AppendU32(
+      data,
+      static_cast<std::uint32_t>(fileIt.second.UnscannedEntries.size()));
+    for (UnscannedEntry const& inc : fileIt.second.UnscannedEntries) {
+      AppendString(data, inc.FileName);
+      AppendString(data, inc.QuotedLocation);
+    }
+  }
+
+  // Replace the file atomically since other processes may read it
+  // concurrently.
+  cmGeneratedFileStream cacheOut;
+  cacheOut.Open(this->CacheFileName, false, true);
+  if (!cacheOut) {
+    return;
+  }
+  cacheOut.write(data.data(), static_cast<std::streamsize>(data.size()));
 }
 
-void cmDependsC::Scan(std::istream& is, const std::string& directory,
-                      const std::string& fullName)
+void cmDependsC::Scan(cm::string_view content, const std::string& directory,
+                      std::vector<UnscannedEntry>& includes,
+                      Matcher& matcher)
 {
-  cmIncludeLines& newCacheEntry = this->FileCache[fullName];
-  newCacheEntry.Used = true;
+  char const* const begin = content.data();
+  char const* const end = begin + content.size();
+
+  // Directives start with '#' or '%', which are rare in other lines.
+  // Search the content for these characters directly and only look at
+  // the lines containing them.  The position of the next occurrence of
+  // each character is kept until the search passes it.
+  char const* nextHash = nullptr;
+  char const* nextPercent = nullptr;
+  auto findNext = [end](char const*& next, char const* from, char c) {
+    if (next == nullptr || (next != end && next < from)) {
+      next = static_cast<char const*>(std::memchr(from, c, end - from));
+      if (next == nullptr) {
+        next = end;
+      }
+    }
+  };
+  for (char const* from = begin; from < end;) {
+    findNext(nextHash, from, '#');
+    findNext(nextPercent, from, '%');
+    char const* const directive = std::min(nextHash, nextPercent);
+    if (directive == end) {
+      break;
+    }
+
+    // The character must be preceded only by blanks on its line.
+    char const* lineBegin = directive;
+    while (lineBegin != begin &&
+           (lineBegin[-1] == ' ' || lineBegin[-1] == '\t')) {
+      --lineBegin;
+    }
+    if (lineBegin != begin && lineBegin[-1] != '\n') {
+      from = directive + 1;
+      continue;
+    }
+    char const* lineEnd = static_cast<char const*>(
+      std::memchr(directive, '\n', end - directive));
+    from = lineEnd ? lineEnd + 1 : end;
+    if (lineEnd == nullptr) {
+      lineEnd = end;
+    }
+    if (lineEnd != lineBegin && lineEnd[-1] == '\r') {
+      --lineEnd;
+    }
+    cm::string_view line(lineBegin, lineEnd - lineBegin);
 
-  // Read one line at a time.
-  std::string line;
-  while (cmSystemTools::GetLineFromStream(is, line)) {
     // Transform the line content first.
+    std::string transformed;
     if (!this->TransformRules.empty()) {
-      this->TransformLine(line);
+      transformed = std::string(line);
+      this->TransformLine(transformed, matcher);
+      line = transformed;
     }
 
     // Match include directives.
-    if (this->IncludeRegexLine.find(line)) {
-      // Get the file being included.
-      UnscannedEntry entry;
-      entry.FileName = this->IncludeRegexLine.match(2);
+    UnscannedEntry entry;
+    bool quoted;
+    if (ParseIncludeLine(line, entry.FileName, quoted)) {
       cmSystemTools::ConvertToUnixSlashes(entry.FileName);
-      if (this->IncludeRegexLine.match(3) == "\"" &&
-          !cmSystemTools::FileIsFullPath(entry.FileName)) {
+      if (quoted && !cmSystemTools::FileIsFullPath(entry.FileName)) {
         // This was a double-quoted include with a relative path.  We
         // must check for the file in the directory containing the
         // file we are scanning.
         entry.QuotedLocation =
           cmSystemTools::CollapseFullPath(entry.FileName, directory);
       }
+      includes.push_back(std::move(entry));
+    }
+  }
+}
 
-      // Queue the file if it has not yet been encountered and it
-      // matches the regular expression for recursive scanning.  Note
-      // that this check does not account for the possibility of two
-      // headers with the same name in different directories when one
-      // is included by double-quotes and the other by angle brackets.
-      // It also does not work properly if two header files with the same
-      // name exist in different directories, and both are included from a
-      // file their own directory by simply using "filename.h" (#12619)
-      // This kind of problem will be fixed when a more
-      // preprocessor-like implementation of this scanner is created.
-      if (this->IncludeRegexScan.find(entry.FileName)) {
-        newCacheEntry.UnscannedEntries.push_back(entry);
-        if (this->Encountered.find(entry.FileName) ==
-            this->Encountered.end()) {
-          this->Encountered.insert(entry.FileName);
-          this->Unscanned.push(entry);
-        }
-      }
+bool cmDependsC::ParseIncludeLine(cm::string_view line, std::string& fileName,
+                                  bool& quoted)
+{
+  // Match the line as INCLUDE_REGEX_LINE does.
+  char const* c = line.data();
+  char const* const end = c + line.size();
+  auto skipBlanks = [&c, end]() {
+    while (c != end && (*c == ' ' || *c == '\t')) {
+      ++c;
     }
+  };
+  auto skipWord = [&c, end](cm::string_view word) {
+    if (static_cast<std::size_t>(end - c) < word.size() ||
+        std::memcmp(c, word.data(), word.size()) != 0) {
+      return false;
+    }
+    c += word.size();
+    return true;
+  };
+
+  skipBlanks();
+  if (c == end || (*c != '#' && *c != '%')) {
+    return false;
+  }
+  ++c;
+  skipBlanks();
+  if (!skipWord("include") && !skipWord("import")) {
+    return false;
+  }
+  skipBlanks();
+  if (c == end || (*c != '<' && *c != '"')) {
+    return false;
   }
+  char const* const name = ++c;
+  while (c != end && *c != '"' && *c != '>') {
+    ++c;
+  }
+  if (c == end || c == name) {
+    return false;
+  }
+  fileName.assign(name, c);
+  quoted = *c == '"';
+  return true;
 }
 
 void cmDependsC::SetupTransforms()
@@ -428,20 +718,20 @@ void cmDependsC::ParseTransform(std::string const& xform)
   this->TransformRules[name] = value;
 }
 
-void cmDependsC::TransformLine(std::string& line)
+void cmDependsC::TransformLine(std::string& line, Matcher& matcher)
 {
   // Check for a transform rule match.  Return if none.
-  if (!this->IncludeRegexTransform.find(line)) {
+  if (!matcher.Transform.find(line)) {
     return;
   }
-  auto tri = this->TransformRules.find(this->IncludeRegexTransform.match(3));
+  auto tri = this->TransformRules.find(matcher.Transform.match(3));
   if (tri == this->TransformRules.end()) {
     return;
   }
 
   // Construct the transformed line.
-  std::string newline = this->IncludeRegexTransform.match(1);
-  std::string arg = this->IncludeRegexTransform.match(4);
+  std::string newline = matcher.Transform.match(1);
+  std::string arg = matcher.Transform.match(4);
   for (char c : tri->second) {
     if (c == '%') {
       newline += arg;
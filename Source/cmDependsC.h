@@ -5,13 +5,19 @@
 
 #include "cmConfigure.h" // IWYU pragma: keep
 
+#include <cstdint>
 #include <iosfwd>
 #include <map>
-#include <queue>
 #include <set>
 #include <string>
 #include <vector>
 
+#if !defined(CMAKE_BOOTSTRAP)
+#  include <mutex>
+#endif
+
+#include <cm/string_view>
+
 #include "cmsys/RegularExpression.hxx"
 
 #include "cmDepends.h"
@@ -20,6 +26,21 @@ class cmLocalUnixMakefileGenerator3;
 
 /** \class cmDependsC
  * \brief Dependency scanner for C and C++ object files.
+ *
+ * The include lines of every scanned file are kept in a cache keyed by
+ * the modification time and size of the file.  Unless include transforms
+ * are in effect, the cache does not depend on the target and is shared by
+ * all targets of the build tree.  The objects of a target are scanned in
+ * parallel.
+ *
+ * The cache is stored in the same encoding as the depend.internal
+ * database (all integers little-endian, strings as u32 length and bytes):
+ *
+ *   header:  "CMINCLUD", u32 version, string include regex,
+ *            string transform regex, u32 entry count
+ *   entries: entry count * { string path, u32 time low, u32 time high,
+ *            u32 size, u32 include count,
+ *            include count * { string name, string quoted location } }
  */
 class cmDependsC : public cmDepends
 {
@@ -36,26 +57,67 @@ public:
   cmDependsC(cmDependsC const&) = delete;
   cmDependsC& operator=(cmDependsC const&) = delete;
 
+  // Data structures for dependency graph walk.
+  struct UnscannedEntry
+  {
+    std::string FileName;
+    std::string QuotedLocation;
+  };
+
+  struct cmIncludeLines
+  {
+    // All include lines of the file, before IncludeRegexScan is applied.
+    std::vector<UnscannedEntry> UnscannedEntries;
+    // Modification time and size of the file when it was scanned.
+    long long Time = 0;
+    unsigned long Size = 0;
+    // Whether the file is known to match Time and Size.
+    bool Checked = false;
+  };
+
 protected:
   // Implement writing/checking methods required by superclass.
   bool WriteDependencies(const std::set<std::string>& sources,
                          const std::string& obj, std::ostream& makeDepends,
-                         std::ostream& internalDepends) override;
+                         DependencyMap& internalDepends) override;
+  bool Finalize(std::ostream& makeDepends,
+                DependencyMap& internalDepends) override;
+  void PrepareDependencies(
+    std::map<std::string, std::set<std::string>> const& objects) override;
+
+  // Regular expressions used while scanning.  Matching stores state in
+  // the expressions, so each scanning thread works on its own copy.
+  struct Matcher
+  {
+    cmsys::RegularExpression Scan;
+    cmsys::RegularExpression Complain;
+    cmsys::RegularExpression Transform;
+  };
 
-  // Method to scan a single file.
-  void Scan(std::istream& is, const std::string& directory,
-            const std::string& fullName);
+  // Result of walking the include graph of one object file.
+  struct ScanResult
+  {
+    std::set<std::string> Dependencies;
+    std::string Error;
+  };
 
-  // Regular expression to identify C preprocessor include directives.
-  cmsys::RegularExpression IncludeRegexLine;
+  Matcher GetMatcher() const;
+  void ScanSources(std::set<std::string> const& sources, Matcher& matcher,
+                   ScanResult& result);
+
+  // Method to scan the content of a single file.
+  void Scan(cm::string_view content, const std::string& directory,
+            std::vector<UnscannedEntry>& includes, Matcher& matcher);
+
+  // Match a C preprocessor include directive.
+  static bool ParseIncludeLine(cm::string_view line, std::string& fileName,
+                               bool& quoted);
 
   // Regular expressions to choose which include files to scan
   // recursively and which to complain about not finding.
   cmsys::RegularExpression IncludeRegexScan;
   cmsys::RegularExpression IncludeRegexComplain;
   std::string IncludeRegexLineString;
-  std::string IncludeRegexScanString;
-  std::string IncludeRegexComplainString;
 
   // Regex to transform #include lines.
   std::string IncludeRegexTransformString;
@@ -64,33 +126,34 @@ protected:
   TransformRulesType TransformRules;
   void SetupTransforms();
   void ParseTransform(std::string const& xform);
-  void TransformLine(std::string& line);
-
-public:
-  // Data structures for dependency graph walk.
-  struct UnscannedEntry
-  {
-    std::string FileName;
-    std::string QuotedLocation;
-  };
+  void TransformLine(std::string& line, Matcher& matcher);
 
-  struct cmIncludeLines
-  {
-    std::vector<UnscannedEntry> UnscannedEntries;
-    bool Used = false;
-  };
+  cmIncludeLines const* GetIncludeLines(std::string const& fullName,
+                                        Matcher& matcher);
+  std::string FindHeader(std::string const& fileName);
 
-protected:
   const DependencyMap* ValidDeps = nullptr;
-  std::set<std::string> Encountered;
-  std::queue<UnscannedEntry> Unscanned;
+
+  // Results of objects scanned ahead by PrepareDependencies.
+  std::map<std::string, ScanResult> ScanResults;
 
   std::map<std::string, cmIncludeLines> FileCache;
   std::map<std::string, std::string> HeaderLocationCache;
+  bool FileCacheChanged = false;
+#if !defined(CMAKE_BOOTSTRAP)
+  std::mutex CacheMutex;
+#endif
 
   std::string CacheFileName;
+  static char const CacheMagic[8];
+  static std::uint32_t const CacheVersion = 1;
+
+  // Dependees that get an empty rule so that make does not fail when
+  // one of them is removed.
+  bool DependeeRules = false;
+  std::set<std::string> Dependees;
 
-  void WriteCacheFile() const;
+  void WriteCacheFile();
   void ReadCacheFile();
 };
 
@@ -0,0 +1,150 @@
+/* Distributed under the OSI-approved BSD 3-Clause License.  See accompanying
+   file Copyright.txt or https://cmake.org/licensing for details.  */
+#include "cmDependsCompiler.h"
+
+#include <algorithm>
+#include <set>
+#include <utility>
+
+#include "cmFileTimeCache.h"
+#include "cmGccDepfileReader.h"
+#include "cmGccDepfileReaderTypes.h"
+#include "cmGeneratedFileStream.h"
+#include "cmGlobalGenerator.h"
+#include "cmLocalUnixMakefileGenerator3.h"
+#include "cmStringAlgorithms.h"
+#include "cmSystemTools.h"
+#include "cmake.h"
+
+cmDependsCompiler::cmDependsCompiler(cmLocalUnixMakefileGenerator3* lg,
+                                     std::string targetDir)
+  : LocalGenerator(lg)
+  , DatabaseFile(cmStrCat(targetDir, "/compiler_depend.internal"))
+  , MakeFile(cmStrCat(targetDir, "/compiler_depend.make"))
+{
+}
+
+bool cmDependsCompiler::Check(std::vector<std::string> const& files,
+                              std::string const& infoFile)
+{
+  // Dependency files are removed once merged, so any existing one is new.
+  for (std::size_t i = 1; i < files.size(); i += 2) {
+    if (cmSystemTools::FileExists(files[i], true)) {
+      return false;
+    }
+  }
+
+  // The objects of the target may have changed with the info file.
+  cmFileTimeCache* ftc = this->LocalGenerator->GetGlobalGenerator()
+                           ->GetCMakeInstance()
+                           ->GetFileTimeCache();
+  int result;
+  return ftc->Compare(this->DatabaseFile, infoFile, &result) && result >= 0;
+}
+
+bool cmDependsCompiler::Write(std::vector<std::string> const& files)
+{
+  DependencyMap recorded;
+  this->ReadDatabase(recorded);
+
+  // The compiler runs in the current binary directory, so relative paths
+  // in the dependency files are relative to it.
+  std::string const& currentBinDir =
+    this->LocalGenerator->GetCurrentBinaryDirectory();
+
+  DependencyMap deps;
+  std::vector<std::string> merged;
+  for (std::size_t i = 0; i + 1 < files.size(); i += 2) {
+    std::string const& obj = files[i];
+    std::string const& depFile = files[i + 1];
+    std::vector<std::string>& objDeps = deps[obj];
+    if (cmSystemTools::FileExists(depFile, true)) {
+      merged.push_back(depFile);
+      for (cmGccStyleDependency const& dep :
+           cmReadGccDepfile(depFile.c_str())) {
+        for (std::string const& path : dep.paths) {
+          objDeps.push_back(
+            cmSystemTools::CollapseFullPath(path, currentBinDir));
+        }
+      }
+      std::sort(objDeps.begin(), objDeps.end());
+      objDeps.erase(std::unique(objDeps.begin(), objDeps.end()),
+                    objDeps.end());
+    }
+    // Keep what was recorded if there is nothing new, e.g. because the
+    // dependency file could not be parsed.
+    if (objDeps.empty()) {
+      auto const it = recorded.find(obj);
+      if (it != recorded.end()) {
+        objDeps = std::move(it->second);
+      }
+    }
+  }
+
+  if (!cmDepends::WriteDatabase(this->DatabaseFile, deps) ||
+      !this->WriteMakeFile(deps)) {
+    return false;
+  }
+  for (std::string const& depFile : merged) {
+    cmSystemTools::RemoveFile(depFile);
+  }
+  return true;
+}
+
+void cmDependsCompiler::ReadDatabase(DependencyMap& deps) const
+{
+  cmDepends::Database db;
+  if (!cmDepends::ReadDatabase(this->DatabaseFile, db)) {
+    return;
+  }
+  for (cmDepends::Database::Object const& object : db.Objects) {
+    std::vector<std::string>& objDeps = deps[db.Paths[object.Path]];
+    auto const first = db.Dependencies.begin() + object.FirstDependency;
+    for (auto it = first; it != first + object.DependencyCount; ++it) {
+      objDeps.push_back(db.Paths[*it]);
+    }
+  }
+}
+
+bool cmDependsCompiler::WriteMakeFile(DependencyMap const& deps) const
+{
+  // This should be copy-if-different because the make tool may try to
+  // reload it needlessly otherwise.
+  cmGeneratedFileStream makeDepends(
+    this->MakeFile, false,
+    this->LocalGenerator->GetGlobalGenerator()->GetMakefileEncoding());
+  makeDepends.SetCopyIfDifferent(true);
+  if (!makeDepends) {
+    return false;
+  }
+  this->LocalGenerator->WriteDisclaimer(makeDepends);
+
+  // Write the paths relative to the home output directory like the rules
+  // in build.make.
+  std::string const& binDir = this->LocalGenerator->GetBinaryDirectory();
+  auto makePath = [this, &binDir](std::string const& path) {
+    return this->LocalGenerator->ConvertToMakefilePath(
+      this->LocalGenerator->MaybeConvertToRelativePath(binDir, path));
+  };
+
+  std::set<std::string> dependees;
+  for (auto const& d : deps) {
+    if (d.second.empty()) {
+      continue;
+    }
+    makeDepends << makePath(d.first) << ':';
+    for (std::string const& dep : d.second) {
+      std::string dep_m = makePath(dep);
+      makeDepends << " \\\n  " << dep_m;
+      dependees.insert(std::move(dep_m));
+    }
+    makeDepends << "\n\n";
+  }
+
+  // Write an empty rule for every dependee so that make does not fail
+  // when one of them is removed.
+  for (std::string const& dep : dependees) {
+    makeDepends << dep << ":\n";
+  }
+  return true;
+}
@@ -0,0 +1,53 @@
+/* Distributed under the OSI-approved BSD 3-Clause License.  See accompanying
+   file Copyright.txt or https://cmake.org/licensing for details.  */
+#ifndef cmDependsCompiler_h
+#define cmDependsCompiler_h
+
+#include "cmConfigure.h" // IWYU pragma: keep
+
+#include <string>
+#include <vector>
+
+#include "cmDepends.h"
+
+class cmLocalUnixMakefileGenerator3;
+
+/** \class cmDependsCompiler
+ * \brief Collect the dependency files written by the compiler.
+ *
+ * Objects compiled with CMAKE_DEPENDS_USE_COMPILER write a gcc-style
+ * dependency file next to the object.  These files are merged into the
+ * dependency database of the target, compiler_depend.internal, and then
+ * removed.  The database has the binary format of depend.internal, see
+ * cmDepends.  From the database the compiler_depend.make file included
+ * by the build.make file of the target is written.
+ */
+class cmDependsCompiler
+{
+public:
+  cmDependsCompiler(cmLocalUnixMakefileGenerator3* lg, std::string targetDir);
+
+  cmDependsCompiler(cmDependsCompiler const&) = delete;
+  cmDependsCompiler& operator=(cmDependsCompiler const&) = delete;
+
+  /** Check whether compiler_depend.make is up to date.  The files are
+      given as pairs of an object file and its dependency file.  */
+  bool Check(std::vector<std::string> const& files,
+             std::string const& infoFile);
+
+  /** Merge the existing dependency files into the database and write
+      compiler_depend.make.  */
+  bool Write(std::vector<std::string> const& files);
+
+private:
+  using DependencyMap = cmDepends::DependencyMap;
+
+  void ReadDatabase(DependencyMap& deps) const;
+  bool WriteMakeFile(DependencyMap const& deps) const;
+
+  cmLocalUnixMakefileGenerator3* LocalGenerator;
+  std::string DatabaseFile;
+  std::string MakeFile;
+};
+
+#endif
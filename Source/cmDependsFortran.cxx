@@ -102,7 +102,7 @@ cmDependsFortran::~cmDependsFortran() = default;
 bool cmDependsFortran::WriteDependencies(const std::set<std::string>& sources,
                                          const std::string& obj,
                                          std::ostream& /*makeDepends*/,
-                                         std::ostream& /*internalDepends*/)
+                                         DependencyMap& /*internalDepends*/)
 {
   // Make sure this is a scanning instance.
   if (sources.empty() || sources.begin()->empty()) {
@@ -147,7 +147,7 @@ bool cmDependsFortran::WriteDependencies(const std::set<std::string>& sources,
 }
 
 bool cmDependsFortran::Finalize(std::ostream& makeDepends,
-                                std::ostream& internalDepends)
+                                DependencyMap& internalDepends)
 {
   // Prepare the module search process.
   this->LocateModules();
@@ -309,7 +309,7 @@ bool cmDependsFortran::WriteDependenciesReal(std::string const& obj,
                                              std::string const& mod_dir,
                                              std::string const& stamp_dir,
                                              std::ostream& makeDepends,
-                                             std::ostream& internalDepends)
+                                             DependencyMap& internalDepends)
 {
   // Get the source file for this object.
   std::string const& src = info.Source;
@@ -318,13 +318,14 @@ bool cmDependsFortran::WriteDependenciesReal(std::string const& obj,
   std::string binDir = this->LocalGenerator->GetBinaryDirectory();
   std::string obj_i = this->MaybeConvertToRelativePath(binDir, obj);
   std::string obj_m = cmSystemTools::ConvertToOutputPath(obj_i);
-  internalDepends << obj_i << "\n " << src << '\n';
+  std::vector<std::string>& internalDeps = internalDepends[obj_i];
+  internalDeps.push_back(src);
   for (std::string const& i : info.Includes) {
     makeDepends << obj_m << ": "
                 << cmSystemTools::ConvertToOutputPath(
                      this->MaybeConvertToRelativePath(binDir, i))
                 << '\n';
-    internalDepends << ' ' << i << '\n';
+    internalDeps.push_back(i);
   }
   makeDepends << '\n';
 
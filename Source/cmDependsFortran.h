@@ -53,7 +53,7 @@ public:
 protected:
   // Finalize the dependency information for the target.
   bool Finalize(std::ostream& makeDepends,
-                std::ostream& internalDepends) override;
+                DependencyMap& internalDepends) override;
 
   // Find all the modules required by the target.
   void LocateModules();
@@ -65,7 +65,7 @@ protected:
   // Implement writing/checking methods required by superclass.
   bool WriteDependencies(const std::set<std::string>& sources,
                          const std::string& file, std::ostream& makeDepends,
-                         std::ostream& internalDepends) override;
+                         DependencyMap& internalDepends) override;
 
   // Actually write the dependencies to the streams.
   bool WriteDependenciesReal(std::string const& obj,
@@ -73,7 +73,7 @@ protected:
                              std::string const& mod_dir,
                              std::string const& stamp_dir,
                              std::ostream& makeDepends,
-                             std::ostream& internalDepends);
+                             DependencyMap& internalDepends);
 
   // The source file from which to start scanning.
   std::string SourceFile;
@@ -11,7 +11,7 @@ cmDependsJava::~cmDependsJava() = default;
 bool cmDependsJava::WriteDependencies(const std::set<std::string>& sources,
                                       const std::string& /*obj*/,
                                       std::ostream& /*makeDepends*/,
-                                      std::ostream& /*internalDepends*/)
+                                      DependencyMap& /*internalDepends*/)
 {
   // Make sure this is a scanning instance.
   if (sources.empty() || sources.begin()->empty()) {
@@ -23,8 +23,9 @@ bool cmDependsJava::WriteDependencies(const std::set<std::string>& sources,
 }
 
 bool cmDependsJava::CheckDependencies(
-  std::istream& /*internalDepends*/,
-  const std::string& /*internalDependsFileName*/, DependencyMap& /*validDeps*/)
+  Database const& /*internalDepends*/,
+  const std::string& /*internalDependsFileName*/, DependencyMap& /*validDeps*/,
+  bool /*needValidDeps*/)
 {
   return true;
 }
@@ -31,10 +31,11 @@ protected:
   // Implement writing/checking methods required by superclass.
   bool WriteDependencies(const std::set<std::string>& sources,
                          const std::string& file, std::ostream& makeDepends,
-                         std::ostream& internalDepends) override;
-  bool CheckDependencies(std::istream& internalDepends,
+                         DependencyMap& internalDepends) override;
+  bool CheckDependencies(Database const& internalDepends,
                          const std::string& internalDependsFileName,
-                         DependencyMap& validDeps) override;
+                         DependencyMap& validDeps,
+                         bool needValidDeps) override;
 };
 
 #endif
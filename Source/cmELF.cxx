@@ -145,6 +145,7 @@ public:
   virtual std::vector<char> EncodeDynamicEntries(
     const cmELF::DynamicEntryList&) = 0;
   virtual StringEntry const* GetDynamicSectionString(unsigned int tag) = 0;
+  virtual std::vector<std::string> GetNeededLibraries() = 0;
   virtual void PrintInfo(std::ostream& os) const = 0;
 
   // Lookup the SONAME in the DYNAMIC section.
@@ -256,6 +257,9 @@ public:
   // Lookup a string from the dynamic section with the given tag.
   StringEntry const* GetDynamicSectionString(unsigned int tag) override;
 
+  // Lookup the strings of all DT_NEEDED entries in the dynamic section.
+  std::vector<std::string> GetNeededLibraries() override;
+
   // Print information about the ELF file.
   void PrintInfo(std::ostream& os) const override
   {
@@ -668,6 +672,54 @@ cmELF::StringEntry const* cmELFInternalImpl<Types>::GetDynamicSectionString(
   return nullptr;
 }
 
+template <class Types>
+std::vector<std::string> cmELFInternalImpl<Types>::GetNeededLibraries()
+{
+  std::vector<std::string> needed;
+
+  // Try reading the dynamic section.
+  if (!this->LoadDynamicSection()) {
+    return needed;
+  }
+
+  // Get the string table referenced by the DYNAMIC section.
+  ELF_Shdr const& sec = this->SectionHeaders[this->DynamicSectionIndex];
+  if (sec.sh_link >= this->SectionHeaders.size()) {
+    this->SetErrorMessage("Section DYNAMIC has invalid string table index.");
+    return needed;
+  }
+  ELF_Shdr const& strtab = this->SectionHeaders[sec.sh_link];
+
+  for (ELF_Dyn const& dyn : this->DynamicSectionEntries) {
+    if (static_cast<tagtype>(dyn.d_tag) != static_cast<tagtype>(DT_NEEDED)) {
+      continue;
+    }
+    // Make sure the position given is within the string section.
+    if (dyn.d_un.d_val >= strtab.sh_size) {
+      this->SetErrorMessage("Section DYNAMIC references string beyond "
+                            "the end of its string section.");
+      return std::vector<std::string>();
+    }
+
+    // Read the null-terminated string.
+    unsigned long last = static_cast<unsigned long>(dyn.d_un.d_val);
+    unsigned long end = static_cast<unsigned long>(strtab.sh_size);
+    this->Stream->seekg(strtab.sh_offset + last);
+    std::string name;
+    char c;
+    while (last != end && this->Stream->get(c) && c) {
+      name += c;
+      ++last;
+    }
+    if (!(*this->Stream)) {
+      this->SetErrorMessage("Dynamic section specifies unreadable NEEDED.");
+      return std::vector<std::string>();
+    }
+    needed.push_back(std::move(name));
+  }
+  return needed;
+}
+
 //============================================================================
 // External class implementation.
 
@@ -830,6 +882,16 @@ cmELF::StringEntry const* cmELF::GetRunPath()
   return nullptr;
 }
 
+std::vector<std::string> cmELF::GetNeededLibraries()
+{
+  if (this->Valid() &&
+      (this->Internal->GetFileType() == cmELF::FileTypeExecutable ||
+       this->Internal->GetFileType() == cmELF::FileTypeSharedLibrary)) {
+    return this->Internal->GetNeededLibraries();
+  }
+  return std::vector<std::string>();
+}
+
 void cmELF::PrintInfo(std::ostream& os) const
 {
   if (this->Valid()) {
@@ -99,6 +99,10 @@ public:
   /** Get the RUNPATH field if any.  */
   StringEntry const* GetRunPath();
 
+  /** Get the names of the libraries in the DT_NEEDED entries, in the
+      order they are listed.  */
+  std::vector<std::string> GetNeededLibraries();
+
   /** Print human-readable information about the ELF file.  */
   void PrintInfo(std::ostream& os) const;
 
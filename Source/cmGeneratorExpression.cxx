@@ -13,8 +13,14 @@
 #include "cmGeneratorExpressionEvaluator.h"
 #include "cmGeneratorExpressionLexer.h"
 #include "cmGeneratorExpressionParser.h"
+#include "cmLocalGenerator.h"
 #include "cmStringAlgorithms.h"
 #include "cmSystemTools.h"
+#include "cmake.h"
+
+#if !defined(CMAKE_BOOTSTRAP)
+#  include "cmMakefileProfilingData.h"
+#endif
 
 cmGeneratorExpression::cmGeneratorExpression(cmListFileBacktrace backtrace)
   : Backtrace(std::move(backtrace))
@@ -68,6 +74,15 @@ const std::string& cmCompiledGeneratorExpression::EvaluateWithContext(
     return this->Input;
   }
 
+#if !defined(CMAKE_BOOTSTRAP)
+  cmMakefileProfilingData* profilingData = nullptr;
+  cmake* cm = context.LG ? context.LG->GetCMakeInstance() : nullptr;
+  if (cm && cm->IsProfilingEnabled()) {
+    profilingData = &cm->GetProfilingOutput();
+    profilingData->StartGenexEntry(this->Backtrace, this->Input);
+  }
+#endif
+
   this->Output.clear();
 
   for (const auto& it : this->Evaluators) {
@@ -93,6 +108,12 @@ const std::string& cmCompiledGeneratorExpression::EvaluateWithContext(
 
   this->DependTargets = context.DependTargets;
   this->AllTargetsSeen = context.AllTargets;
+
+#if !defined(CMAKE_BOOTSTRAP)
+  if (profilingData) {
+    profilingData->StopGenexEntry();
+  }
+#endif
   return this->Output;
 }
 
@@ -1408,20 +1408,38 @@ bool cmGlobalGenerator::Compute()
   }
   this->FinalizeTargetCompileInfo();
 
-  this->CreateGenerationObjects();
+  {
+#if !defined(CMAKE_BOOTSTRAP)
+    auto profilingEntry = this->CMakeInstance->CreateProfilingEntry(
+      "generate", "CreateGenerationObjects");
+#endif
+    this->CreateGenerationObjects();
+  }
 
   // at this point this->LocalGenerators has been filled,
   // so create the map from project name to vector of local generators
   this->FillProjectMap();
 
   // Add automatically generated sources (e.g. unity build).
-  if (!this->AddAutomaticSources()) {
-    return false;
+  {
+#if !defined(CMAKE_BOOTSTRAP)
+    auto profilingEntry = this->CMakeInstance->CreateProfilingEntry(
+      "generate", "AddAutomaticSources");
+#endif
+    if (!this->AddAutomaticSources()) {
+      return false;
+    }
   }
 
   // Iterate through all targets and set up AUTOMOC, AUTOUIC and AUTORCC
-  if (!this->QtAutoGen()) {
-    return false;
+  {
+#if !defined(CMAKE_BOOTSTRAP)
+    auto profilingEntry =
+      this->CMakeInstance->CreateProfilingEntry("generate", "QtAutoGen");
+#endif
+    if (!this->QtAutoGen()) {
+      return false;
+    }
   }
 
   // Add generator specific helper commands
@@ -1433,9 +1451,15 @@ bool cmGlobalGenerator::Compute()
   // features) at this point. While processing the compile features we also
   // calculate and cache the language standard required by the compile
   // features.
-  for (const auto& localGen : this->LocalGenerators) {
-    if (!localGen->ComputeTargetCompileFeatures()) {
-      return false;
+  {
+#if !defined(CMAKE_BOOTSTRAP)
+    auto profilingEntry = this->CMakeInstance->CreateProfilingEntry(
+      "generate", "ComputeTargetCompileFeatures");
+#endif
+    for (const auto& localGen : this->LocalGenerators) {
+      if (!localGen->ComputeTargetCompileFeatures()) {
+        return false;
+      }
     }
   }
 
@@ -1452,8 +1476,14 @@ bool cmGlobalGenerator::Compute()
 
   // Trace the dependencies, after that no custom commands should be added
   // because their dependencies might not be handled correctly
-  for (const auto& localGen : this->LocalGenerators) {
-    localGen->TraceDependencies();
+  {
+#if !defined(CMAKE_BOOTSTRAP)
+    auto profilingEntry = this->CMakeInstance->CreateProfilingEntry(
+      "generate", "TraceDependencies");
+#endif
+    for (const auto& localGen : this->LocalGenerators) {
+      localGen->TraceDependencies();
+    }
   }
 
   // Make sure that all (non-imported) targets have source files added!
@@ -1494,12 +1524,23 @@ void cmGlobalGenerator::Generate()
   // it builds by default.
   this->InitializeProgressMarks();
 
-  this->ProcessEvaluationFiles();
+  {
+#if !defined(CMAKE_BOOTSTRAP)
+    auto profilingEntry = this->CMakeInstance->CreateProfilingEntry(
+      "generate", "ProcessEvaluationFiles");
+#endif
+    this->ProcessEvaluationFiles();
+  }
 
   this->CMakeInstance->UpdateProgress("Generating", 0.1f);
 
   // Generate project files
   for (unsigned int i = 0; i < this->LocalGenerators.size(); ++i) {
+#if !defined(CMAKE_BOOTSTRAP)
+    auto profilingEntry = this->CMakeInstance->CreateProfilingEntry(
+      "directory",
+      this->LocalGenerators[i]->GetMakefile()->GetCurrentBinaryDirectory());
+#endif
     this->SetCurrentMakefile(this->LocalGenerators[i]->GetMakefile());
     this->LocalGenerators[i]->Generate();
     if (!this->LocalGenerators[i]->GetMakefile()->IsOn(
@@ -1572,6 +1613,10 @@ void cmGlobalGenerator::Generate()
 
 bool cmGlobalGenerator::ComputeTargetDepends()
 {
+#if !defined(CMAKE_BOOTSTRAP)
+  auto profilingEntry = this->CMakeInstance->CreateProfilingEntry(
+    "generate", "ComputeTargetDepends");
+#endif
   cmComputeTargetDepends ctd(this);
   if (!ctd.Compute()) {
     return false;
@@ -5,7 +5,9 @@
 #include <algorithm>
 #include <cctype>
 #include <cstdio>
+#include <iterator>
 #include <sstream>
+#include <thread>
 
 #include <cm/iterator>
 #include <cm/memory>
@@ -42,6 +44,7 @@
 #include "cmTarget.h"
 #include "cmTargetDepend.h"
 #include "cmVersion.h"
+#include "cmWorkerPool.h"
 #include "cmake.h"
 
 const char* cmGlobalNinjaGenerator::NINJA_BUILD_FILE = "build.ninja";
@@ -112,32 +115,94 @@ std::string cmGlobalNinjaGenerator::EncodeRuleName(std::string const& name)
   return encoded;
 }
 
-std::string cmGlobalNinjaGenerator::EncodeLiteral(const std::string& lit)
+namespace {
+// Characters that have to be escaped with '$' by EncodeLiteral and, in
+// addition, by EncodePath.
+enum : unsigned char
 {
-  std::string result = lit;
-  cmSystemTools::ReplaceString(result, "$", "$$");
-  cmSystemTools::ReplaceString(result, "\n", "$\n");
-  if (this->IsMultiConfig()) {
-    cmSystemTools::ReplaceString(result,
-                                 cmStrCat('$', this->GetCMakeCFGIntDir()),
-                                 this->GetCMakeCFGIntDir());
+  EscapeLiteral = 1,
+  EscapePath = 2
+};
+
+struct EscapeTable
+{
+  EscapeTable()
+    : Flags()
+  {
+    this->Flags[static_cast<unsigned char>('$')] = EscapeLiteral | EscapePath;
+    this->Flags[static_cast<unsigned char>('\n')] = EscapeLiteral | EscapePath;
+    this->Flags[static_cast<unsigned char>(' ')] = EscapePath;
+    this->Flags[static_cast<unsigned char>(':')] = EscapePath;
+  }
+
+  unsigned char Flags[256];
+};
+
+EscapeTable const Escapes;
+
+// Append the escaped form of the input in a single pass.  Runs of
+// characters that need no escaping are copied at once.  Occurrences of
+// the given configuration placeholder are copied verbatim so that ninja
+// expands them.
+void AppendEscaped(std::string& out, cm::string_view in, unsigned char mask,
+                   cm::string_view cfgIntDir)
+{
+  std::size_t begin = 0;
+  for (std::size_t i = 0; i < in.size(); ++i) {
+    char const c = in[i];
+    if (!(Escapes.Flags[static_cast<unsigned char>(c)] & mask)) {
+      continue;
+    }
+    if (c == '$' && !cfgIntDir.empty() &&
+        in.substr(i, cfgIntDir.size()) == cfgIntDir) {
+      i += cfgIntDir.size() - 1;
+      continue;
+    }
+    out.append(in.data() + begin, i - begin);
+    out += '$';
+    out += c;
+    begin = i + 1;
   }
+  out.append(in.data() + begin, in.size() - begin);
+}
+}
+
+std::string cmGlobalNinjaGenerator::EncodeLiteral(const std::string& lit)
+{
+  std::string result;
+  this->AppendEncodedLiteral(result, lit);
   return result;
 }
 
 std::string cmGlobalNinjaGenerator::EncodePath(const std::string& path)
 {
-  std::string result = path;
+  std::string result;
+  this->AppendEncodedPath(result, path);
+  return result;
+}
+
+void cmGlobalNinjaGenerator::AppendEncodedLiteral(std::string& out,
+                                                  cm::string_view lit)
+{
+  AppendEscaped(out, lit, EscapeLiteral,
+                this->IsMultiConfig() ? this->GetCMakeCFGIntDir()
+                                      : cm::string_view());
+}
+
+void cmGlobalNinjaGenerator::AppendEncodedPath(std::string& out,
+                                               cm::string_view path)
+{
 #ifdef _WIN32
+  std::string converted(path);
   if (this->IsGCCOnWindows())
-    std::replace(result.begin(), result.end(), '\\', '/');
+    std::replace(converted.begin(), converted.end(), '\\', '/');
   else
-    std::replace(result.begin(), result.end(), '/', '\\');
+    std::replace(converted.begin(), converted.end(), '/', '\\');
+  path = converted;
 #endif
-  result = EncodeLiteral(result);
-  cmSystemTools::ReplaceString(result, " ", "$ ");
-  cmSystemTools::ReplaceString(result, ":", "$:");
-  return result;
+  AppendEscaped(out, path, EscapePath,
+                this->IsMultiConfig() ? this->GetCMakeCFGIntDir()
+                                      : cm::string_view());
 }
 
 void cmGlobalNinjaGenerator::WriteBuild(std::ostream& os,
@@ -166,7 +231,8 @@ void cmGlobalNinjaGenerator::WriteBuild(std::ostream& os,
   {
     // Write explicit outputs
     for (std::string const& output : build.Outputs) {
-      buildStr += cmStrCat(' ', EncodePath(output));
+      buildStr += ' ';
+      this->AppendEncodedPath(buildStr, output);
       if (this->ComputingUnknownDependencies) {
         this->CombinedBuildOutputs.insert(output);
       }
@@ -175,7 +241,8 @@ void cmGlobalNinjaGenerator::WriteBuild(std::ostream& os,
     if (!build.ImplicitOuts.empty()) {
       buildStr += " |";
       for (std::string const& implicitOut : build.ImplicitOuts) {
-        buildStr += cmStrCat(' ', EncodePath(implicitOut));
+        buildStr += ' ';
+        this->AppendEncodedPath(buildStr, implicitOut);
       }
     }
     buildStr += ':';
@@ -190,14 +257,16 @@ void cmGlobalNinjaGenerator::WriteBuild(std::ostream& os,
 
     // Write explicit dependencies.
     for (std::string const& explicitDep : build.ExplicitDeps) {
-      arguments += cmStrCat(' ', EncodePath(explicitDep));
+      arguments += ' ';
+      this->AppendEncodedPath(arguments, explicitDep);
     }
 
     // Write implicit dependencies.
     if (!build.ImplicitDeps.empty()) {
       arguments += " |";
       for (std::string const& implicitDep : build.ImplicitDeps) {
-        arguments += cmStrCat(' ', EncodePath(implicitDep));
+        arguments += ' ';
+        this->AppendEncodedPath(arguments, implicitDep);
       }
     }
 
@@ -205,7 +274,8 @@ void cmGlobalNinjaGenerator::WriteBuild(std::ostream& os,
     if (!build.OrderOnlyDeps.empty()) {
       arguments += " ||";
       for (std::string const& orderOnlyDep : build.OrderOnlyDeps) {
-        arguments += cmStrCat(' ', EncodePath(orderOnlyDep));
+        arguments += ' ';
+        this->AppendEncodedPath(arguments, orderOnlyDep);
       }
     }
 
@@ -242,6 +312,24 @@ void cmGlobalNinjaGenerator::WriteBuild(std::ostream& os,
   os << buildStr << arguments << assignments << "\n";
 }
 
+std::string const& cmGlobalNinjaGenerator::PoolVariable(
+  std::ostream& os, std::string const& prefix, std::string const& value)
+{
+  auto& pool = this->PooledVariables[&os];
+  auto it = pool.find(value);
+  if (it == pool.end()) {
+    // Per-target files are included with subninja and thus have their own
+    // scope.  Number their variables locally so that the contents of a file
+    // do not depend on the targets generated before it.
+    std::string name = cmStrCat(
+      prefix, '_',
+      this->PerTargetFiles ? pool.size() + 1 : ++this->PooledVariableCount);
+    cmGlobalNinjaGenerator::WriteVariable(os, name, value);
+    it = pool.emplace(value, std::move(name)).first;
+  }
+  return it->second;
+}
+
 void cmGlobalNinjaGenerator::AddCustomCommandRule()
 {
   cmNinjaRule rule("CUSTOM_COMMAND");
@@ -417,6 +505,14 @@ void cmGlobalNinjaGenerator::WriteInclude(std::ostream& os,
   os << "include " << filename << "\n";
 }
 
+void cmGlobalNinjaGenerator::WriteSubninja(std::ostream& os,
+                                           const std::string& filename,
+                                           const std::string& comment)
+{
+  cmGlobalNinjaGenerator::WriteComment(os, comment);
+  os << "subninja " << filename << "\n";
+}
+
 void cmGlobalNinjaGenerator::WriteDefault(std::ostream& os,
                                           const cmNinjaDeps& targets,
                                           const std::string& comment)
@@ -496,8 +592,15 @@ void cmGlobalNinjaGenerator::Generate()
   for (auto& it : this->Configs) {
     it.second.TargetDependsClosures.clear();
   }
+  this->TargetIndices.clear();
+  this->IndexedTargets.clear();
+  this->PooledVariables.clear();
+  this->PooledVariableCount = 0;
+  this->PerTargetFileNames.clear();
 
   this->InitOutputPathPrefix();
+  this->PerTargetFiles = this->LocalGenerators[0]->GetMakefile()->IsOn(
+    "CMAKE_NINJA_PER_TARGET_FILES");
   this->TargetAll = this->NinjaOutputPath("all");
   this->CMakeCacheFile = this->NinjaOutputPath("CMakeCache.txt");
 
@@ -958,22 +1061,26 @@ static void EnsureTrailingSlash(std::string& path)
 }
 
 std::string const& cmGlobalNinjaGenerator::ConvertToNinjaPath(
-  const std::string& path) const
+  cm::string_view path) const
 {
   auto const f = ConvertToNinjaPathCache.find(path);
   if (f != ConvertToNinjaPathCache.end()) {
     return f->second;
   }
 
+  // The deque never moves its elements, so the key views stay valid.
+  ConvertToNinjaPathKeys.emplace_back(path);
+  std::string const& key = ConvertToNinjaPathKeys.back();
+
   const auto& ng =
     cm::static_reference_cast<cmLocalNinjaGenerator>(this->LocalGenerators[0]);
   std::string const& bin_dir = ng.GetState()->GetBinaryDirectory();
-  std::string convPath = ng.MaybeConvertToRelativePath(bin_dir, path);
+  std::string convPath = ng.MaybeConvertToRelativePath(bin_dir, key);
   convPath = this->NinjaOutputPath(convPath);
 #ifdef _WIN32
   std::replace(convPath.begin(), convPath.end(), '/', '\\');
 #endif
-  return ConvertToNinjaPathCache.emplace(path, std::move(convPath))
+  return ConvertToNinjaPathCache.emplace(key, std::move(convPath))
     .first->second;
 }
 
@@ -1147,52 +1254,97 @@ void cmGlobalNinjaGenerator::AppendTargetDependsClosure(
   cmGeneratorTarget const* target, cmNinjaDeps& outputs,
   const std::string& config)
 {
-  cmNinjaOuts outs;
-  this->AppendTargetDependsClosure(target, outs, config, true);
-  cm::append(outputs, outs);
+  this->AppendTargetSetOutputs(this->GetTargetDependsClosure(target, config),
+                               outputs, config);
 }
 
 void cmGlobalNinjaGenerator::AppendTargetDependsClosure(
-  cmGeneratorTarget const* target, cmNinjaOuts& outputs,
-  const std::string& config, bool omit_self)
-{
-
-  // try to locate the target in the cache
-  auto find = this->Configs[config].TargetDependsClosures.lower_bound(target);
-
-  if (find == this->Configs[config].TargetDependsClosures.end() ||
-      find->first != target) {
-    // We now calculate the closure outputs by inspecting the dependent
-    // targets recursively.
-    // For that we have to distinguish between a local result set that is only
-    // relevant for filling the cache entries properly isolated and a global
-    // result set that is relevant for the result of the top level call to
-    // AppendTargetDependsClosure.
-    cmNinjaOuts this_outs; // this will be the new cache entry
-
-    for (auto const& dep_target : this->GetTargetDirectDepends(target)) {
-      if (!dep_target->IsInBuildSystem() ||
-          (this->EnableCrossConfigBuild() && !dep_target.IsCross())) {
-        continue;
-      }
-
-      // Collect the dependent targets for _this_ target
-      this->AppendTargetDependsClosure(dep_target, this_outs, config, false);
+  std::set<cmGeneratorTarget*> const& targets, cmNinjaDeps& outputs,
+  const std::string& config)
+{
+  auto i = targets.begin();
+  if (i == targets.end()) {
+    return;
+  }
+  TargetSet common = this->GetTargetDependsClosure(*i, config);
+  for (++i; i != targets.end(); ++i) {
+    TargetSet const& closure = this->GetTargetDependsClosure(*i, config);
+    common.resize(std::min(common.size(), closure.size()));
+    for (std::size_t w = 0; w < common.size(); ++w) {
+      common[w] &= closure[w];
     }
-    find = this->Configs[config].TargetDependsClosures.emplace_hint(
-      find, target, std::move(this_outs));
   }
+  this->AppendTargetSetOutputs(common, outputs, config);
+}
 
-  // now fill the outputs of the final result from the newly generated cache
-  // entry
-  outputs.insert(find->second.begin(), find->second.end());
+std::size_t cmGlobalNinjaGenerator::GetTargetIndex(
+  cmGeneratorTarget const* target)
+{
+  auto const ins =
+    this->TargetIndices.emplace(target, this->IndexedTargets.size());
+  if (ins.second) {
+    this->IndexedTargets.push_back(target);
+  }
+  return ins.first->second;
+}
+
+cmGlobalNinjaGenerator::TargetSet const&
+cmGlobalNinjaGenerator::GetTargetDependsClosure(
+  cmGeneratorTarget const* target, const std::string& config)
+{
+  auto& closures = this->Configs[config].TargetDependsClosures;
+  auto const find = closures.find(target);
+  if (find != closures.end()) {
+    return find->second;
+  }
+
+  // The closure of a target is the union of its direct dependencies and
+  // their closures.  References to the cached sets of the dependencies stay
+  // valid while the map grows.
+  TargetSet closure;
+  for (auto const& dep_target : this->GetTargetDirectDepends(target)) {
+    if (!dep_target->IsInBuildSystem() ||
+        (this->EnableCrossConfigBuild() && !dep_target.IsCross())) {
+      continue;
+    }
+
+    TargetSet const& depClosure =
+      this->GetTargetDependsClosure(dep_target, config);
+    if (closure.size() < depClosure.size()) {
+      closure.resize(depClosure.size());
+    }
+    for (std::size_t w = 0; w < depClosure.size(); ++w) {
+      closure[w] |= depClosure[w];
+    }
+
+    std::size_t const index = this->GetTargetIndex(dep_target);
+    if (closure.size() <= index / 64) {
+      closure.resize(index / 64 + 1);
+    }
+    closure[index / 64] |= std::uint64_t(1) << (index % 64);
+  }
+  return closures.emplace(target, std::move(closure)).first->second;
+}
 
-  // finally generate the outputs of the target itself, if applicable
+void cmGlobalNinjaGenerator::AppendTargetSetOutputs(TargetSet const& targets,
+                                                    cmNinjaDeps& outputs,
+                                                    const std::string& config)
+{
   cmNinjaDeps outs;
-  if (!omit_self) {
-    this->AppendTargetOutputs(target, outs, config, DependOnTargetArtifact);
+  for (std::size_t w = 0; w < targets.size(); ++w) {
+    if (targets[w] == 0) {
+      continue;
+    }
+    for (std::size_t bit = 0; bit < 64; ++bit) {
+      if (targets[w] & (std::uint64_t(1) << bit)) {
+        this->AppendTargetOutputs(this->IndexedTargets[w * 64 + bit], outs,
+                                  config, DependOnTargetArtifact);
+      }
+    }
   }
-  outputs.insert(outs.begin(), outs.end());
+  std::sort(outs.begin(), outs.end());
+  outs.erase(std::unique(outs.begin(), outs.end()), outs.end());
+  cm::append(outputs, outs);
 }
 
 void cmGlobalNinjaGenerator::AddTargetAlias(const std::string& alias,
@@ -1657,6 +1809,12 @@ void cmGlobalNinjaGenerator::WriteTargetRebuildManifest(std::ostream& os)
                                            msg.str());
   }
 
+  // The per-target files are only rewritten if they change, so ninja must
+  // check which outputs the regeneration touched.
+  if (this->PerTargetFiles && this->SupportsManifestRestat()) {
+    reBuild.Variables["restat"] = "1";
+  }
+
   std::sort(reBuild.ImplicitDeps.begin(), reBuild.ImplicitDeps.end());
   reBuild.ImplicitDeps.erase(
     std::unique(reBuild.ImplicitDeps.begin(), reBuild.ImplicitDeps.end()),
@@ -2220,6 +2378,297 @@ struct cmDyndepObjectInfo
   std::vector<std::string> Requires;
 };
 
+namespace {
+struct cmFlatJsonMember
+{
+  std::string Name;
+  bool IsArray = false;
+  std::vector<std::string> Values;
+};
+
+/** Parse a JSON object whose members are strings or arrays of strings.
+
+    This is the shape of the .ddi and <lang>Modules.json files we write
+    ourselves, so reading them does not need a full JSON parser.  Anything
+    outside of this subset, including \u escapes, is rejected and left to
+    Json::Reader.  */
+class cmFlatJsonParser
+{
+public:
+  explicit cmFlatJsonParser(cm::string_view in)
+    : In(in)
+  {
+  }
+
+  bool Parse(std::vector<cmFlatJsonMember>& members)
+  {
+    this->SkipSpace();
+    if (!this->Consume('{')) {
+      return false;
+    }
+    this->SkipSpace();
+    if (!this->Consume('}')) {
+      do {
+        cmFlatJsonMember member;
+        this->SkipSpace();
+        if (!this->ParseString(member.Name)) {
+          return false;
+        }
+        this->SkipSpace();
+        if (!this->Consume(':')) {
+          return false;
+        }
+        this->SkipSpace();
+        if (this->Consume('[')) {
+          member.IsArray = true;
+          this->SkipSpace();
+          if (!this->Consume(']')) {
+            do {
+              this->SkipSpace();
+              member.Values.emplace_back();
+              if (!this->ParseString(member.Values.back())) {
+                return false;
+              }
+              this->SkipSpace();
+            } while (this->Consume(','));
+            if (!this->Consume(']')) {
+              return false;
+            }
+          }
+        } else {
+          member.Values.emplace_back();
+          if (!this->ParseString(member.Values.back())) {
+            return false;
+          }
+        }
+        members.push_back(std::move(member));
+        this->SkipSpace();
+      } while (this->Consume(','));
+      if (!this->Consume('}')) {
+        return false;
+      }
+    }
+    this->SkipSpace();
+    return this->Pos == this->In.size();
+  }
+
+private:
+  void SkipSpace()
+  {
+    while (this->Pos < this->In.size() &&
+           (this->In[this->Pos] == ' ' || this->In[this->Pos] == '\t' ||
+            this->In[this->Pos] == '\n' || this->In[this->Pos] == '\r')) {
+      ++this->Pos;
+    }
+  }
+
+  bool Consume(char c)
+  {
+    if (this->Pos < this->In.size() && this->In[this->Pos] == c) {
+      ++this->Pos;
+      return true;
+    }
+    return false;
+  }
+
+  bool ParseString(std::string& out)
+  {
+    if (!this->Consume('"')) {
+      return false;
+    }
+    while (this->Pos < this->In.size()) {
+      // Copy runs of plain characters at once.
+      std::size_t const begin = this->Pos;
+      while (this->Pos < this->In.size() && this->In[this->Pos] != '"' &&
+             this->In[this->Pos] != '\\' &&
+             static_cast<unsigned char>(this->In[this->Pos]) >= 0x20) {
+        ++this->Pos;
+      }
+      out.append(this->In.data() + begin, this->Pos - begin);
+      if (this->Pos == this->In.size()) {
+        break;
+      }
+      char const c = this->In[this->Pos++];
+      if (c == '"') {
+        return true;
+      }
+      if (c != '\\' || this->Pos == this->In.size()) {
+        return false;
+      }
+      switch (this->In[this->Pos++]) {
+        case '"':
+          out += '"';
+          break;
+        case '\\':
+          out += '\\';
+          break;
+        case '/':
+          out += '/';
+          break;
+        case 'b':
+          out += '\b';
+          break;
+        case 'f':
+          out += '\f';
+          break;
+        case 'n':
+          out += '\n';
+          break;
+        case 'r':
+          out += '\r';
+          break;
+        case 't':
+          out += '\t';
+          break;
+        default:
+          return false;
+      }
+    }
+    return false;
+  }
+
+  cm::string_view In;
+  std::size_t Pos = 0;
+};
+
+/** Read a flat JSON object, see cmFlatJsonParser.  Sets exists to false
+    if the file cannot be opened.  Returns false and sets the error of
+    Json::Reader if the file is not valid or cannot be opened.  */
+bool ReadFlatJson(std::string const& path, Json::Value& fallback,
+                  std::vector<cmFlatJsonMember>& members, bool& exists,
+                  std::string& error)
+{
+  cmsys::ifstream fin(path.c_str(), std::ios::in | std::ios::binary);
+  exists = static_cast<bool>(fin);
+  std::string content;
+  if (exists) {
+    content.assign(std::istreambuf_iterator<char>(fin),
+                   std::istreambuf_iterator<char>());
+    if (cmFlatJsonParser(content).Parse(members)) {
+      return true;
+    }
+  }
+  members.clear();
+  Json::Reader reader;
+  if (!reader.parse(content, fallback, false)) {
+    error = reader.getFormattedErrorMessages();
+    return false;
+  }
+  return true;
+}
+
+struct cmDyndepInput
+{
+  std::string Path;
+  bool IsModuleMap = false;
+
+  // Results, written by the job reading the file.
+  bool Exists = false;
+  bool Failed = false;
+  std::string Error;
+  cmDyndepObjectInfo Object;
+  std::vector<std::pair<std::string, std::string>> Modules;
+};
+
+void ReadDyndepInput(cmDyndepInput& input)
+{
+  Json::Value json;
+  std::vector<cmFlatJsonMember> members;
+  if (!ReadFlatJson(input.Path, json, members, input.Exists, input.Error)) {
+    // A linked target without a module map provides no modules.
+    input.Failed = input.Exists || !input.IsModuleMap;
+    return;
+  }
+
+  if (input.IsModuleMap) {
+    if (!json.isNull()) {
+      if (json.isObject()) {
+        for (Json::Value::iterator i = json.begin(); i != json.end(); ++i) {
+          input.Modules.emplace_back(i.key().asString(), i->asString());
+        }
+      }
+      return;
+    }
+    for (cmFlatJsonMember& member : members) {
+      if (!member.IsArray) {
+        input.Modules.emplace_back(std::move(member.Name),
+                                   std::move(member.Values[0]));
+      }
+    }
+    return;
+  }
+
+  cmDyndepObjectInfo& info = input.Object;
+  if (!json.isNull()) {
+    info.Object = json["object"].asString();
+    Json::Value const& ddi_provides = json["provides"];
+    if (ddi_provides.isArray()) {
+      for (auto const& ddi_provide : ddi_provides) {
+        info.Provides.push_back(ddi_provide.asString());
+      }
+    }
+    Json::Value const& ddi_requires = json["requires"];
+    if (ddi_requires.isArray()) {
+      for (auto const& ddi_require : ddi_requires) {
+        info.Requires.push_back(ddi_require.asString());
+      }
+    }
+    return;
+  }
+  for (cmFlatJsonMember& member : members) {
+    if (member.Name == "object" && !member.IsArray) {
+      info.Object = std::move(member.Values[0]);
+    } else if (member.Name == "provides" && member.IsArray) {
+      info.Provides = std::move(member.Values);
+    } else if (member.Name == "requires" && member.IsArray) {
+      info.Requires = std::move(member.Values);
+    }
+  }
+}
+
+class cmDyndepReadJob : public cmWorkerPool::JobT
+{
+public:
+  explicit cmDyndepReadJob(cmDyndepInput& input)
+    : Input(input)
+  {
+  }
+
+  void Process() override { ReadDyndepInput(this->Input); }
+
+private:
+  cmDyndepInput& Input;
+};
+
+class cmDyndepEndJob : public cmWorkerPool::JobFenceT
+{
+public:
+  void Process() override { this->Pool()->Abort(); }
+};
+
+// Read the inputs of a dyndep file, in parallel if there are several.
+void ReadDyndepInputs(std::vector<cmDyndepInput>& inputs)
+{
+  unsigned int const threads = std::min<unsigned int>(
+    std::max(std::thread::hardware_concurrency(), 1u),
+    static_cast<unsigned int>(std::min<std::size_t>(inputs.size(), 16)));
+  if (threads <= 1) {
+    for (cmDyndepInput& input : inputs) {
+      ReadDyndepInput(input);
+    }
+    return;
+  }
+
+  cmWorkerPool pool;
+  pool.SetThreadCount(threads);
+  for (cmDyndepInput& input : inputs) {
+    pool.EmplaceJob<cmDyndepReadJob>(input);
+  }
+  pool.EmplaceJob<cmDyndepEndJob>();
+  pool.Process();
+}
+}
+
 bool cmGlobalNinjaGenerator::WriteDyndepFile(
   std::string const& dir_top_src, std::string const& dir_top_bld,
   std::string const& dir_cur_src, std::string const& dir_cur_bld,
@@ -2241,57 +2690,44 @@ bool cmGlobalNinjaGenerator::WriteDyndepFile(
     this->LocalGenerators.push_back(std::move(lgd));
   }
 
+  // Read the ddi files and the module maps of the linked targets together.
+  std::vector<cmDyndepInput> inputs(arg_ddis.size() +
+                                    linked_target_dirs.size());
+  for (std::size_t i = 0; i < arg_ddis.size(); ++i) {
+    inputs[i].Path = arg_ddis[i];
+  }
+  for (std::size_t i = 0; i < linked_target_dirs.size(); ++i) {
+    cmDyndepInput& input = inputs[arg_ddis.size() + i];
+    input.Path =
+      cmStrCat(linked_target_dirs[i], "/", arg_lang, "Modules.json");
+    input.IsModuleMap = true;
+  }
+  ReadDyndepInputs(inputs);
+
   std::vector<cmDyndepObjectInfo> objects;
-  for (std::string const& arg_ddi : arg_ddis) {
-    // Load the ddi file and compute the module file paths it provides.
-    Json::Value ddio;
-    Json::Value const& ddi = ddio;
-    cmsys::ifstream ddif(arg_ddi.c_str(), std::ios::in | std::ios::binary);
-    Json::Reader reader;
-    if (!reader.parse(ddif, ddio, false)) {
+  for (std::size_t i = 0; i < arg_ddis.size(); ++i) {
+    cmDyndepInput& input = inputs[i];
+    if (input.Failed) {
       cmSystemTools::Error(cmStrCat("-E cmake_ninja_dyndep failed to parse ",
-                                    arg_ddi,
-                                    reader.getFormattedErrorMessages()));
+                                    input.Path, input.Error));
       return false;
     }
-
-    cmDyndepObjectInfo info;
-    info.Object = ddi["object"].asString();
-    Json::Value const& ddi_provides = ddi["provides"];
-    if (ddi_provides.isArray()) {
-      for (auto const& ddi_provide : ddi_provides) {
-        info.Provides.push_back(ddi_provide.asString());
-      }
-    }
-    Json::Value const& ddi_requires = ddi["requires"];
-    if (ddi_requires.isArray()) {
-      for (auto const& ddi_require : ddi_requires) {
-        info.Requires.push_back(ddi_require.asString());
-      }
-    }
-    objects.push_back(std::move(info));
+    objects.push_back(std::move(input.Object));
   }
 
   // Map from module name to module file path, if known.
   std::map<std::string, std::string> mod_files;
 
   // Populate the module map with those provided by linked targets first.
-  for (std::string const& linked_target_dir : linked_target_dirs) {
-    std::string const ltmn =
-      cmStrCat(linked_target_dir, "/", arg_lang, "Modules.json");
-    Json::Value ltm;
-    cmsys::ifstream ltmf(ltmn.c_str(), std::ios::in | std::ios::binary);
-    Json::Reader reader;
-    if (ltmf && !reader.parse(ltmf, ltm, false)) {
+  for (std::size_t i = 0; i < linked_target_dirs.size(); ++i) {
+    cmDyndepInput const& input = inputs[arg_ddis.size() + i];
+    if (input.Failed) {
       cmSystemTools::Error(cmStrCat("-E cmake_ninja_dyndep failed to parse ",
-                                    linked_target_dir,
-                                    reader.getFormattedErrorMessages()));
+                                    linked_target_dirs[i], input.Error));
       return false;
     }
-    if (ltm.isObject()) {
-      for (Json::Value::iterator i = ltm.begin(); i != ltm.end(); ++i) {
-        mod_files[i.key().asString()] = i->asString();
-      }
+    for (auto const& mod : input.Modules) {
+      mod_files[mod.first] = mod.second;
     }
   }
 
@@ -2586,6 +3022,7 @@ void cmGlobalNinjaMultiGenerator::AddRebuildManifestOutputs(
   if (!this->DefaultFileConfig.empty()) {
     outputs.push_back(this->NinjaOutputPath(NINJA_BUILD_FILE));
   }
+  this->AddPerTargetFileOutputs(outputs);
 }
 
 void cmGlobalNinjaMultiGenerator::GetQtAutoGenConfigs(
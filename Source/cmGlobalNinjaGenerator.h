@@ -5,6 +5,9 @@
 
 #include "cmConfigure.h" // IWYU pragma: keep
 
+#include <cstddef>
+#include <cstdint>
+#include <deque>
 #include <iosfwd>
 #include <map>
 #include <memory>
@@ -16,6 +19,7 @@
 #include <vector>
 
 #include <cm/optional>
+#include <cm/string_view>
 
 #include "cm_codecvt.hxx"
 
@@ -80,6 +84,12 @@ public:
   std::string EncodeLiteral(const std::string& lit);
   std::string EncodePath(const std::string& path);
 
+  /// Append @a lit escaped as by EncodeLiteral to @a out.
+  void AppendEncodedLiteral(std::string& out, cm::string_view lit);
+
+  /// Append @a path escaped as by EncodePath to @a out.
+  void AppendEncodedPath(std::string& out, cm::string_view path);
+
   std::unique_ptr<cmLinkLineComputer> CreateLinkLineComputer(
     cmOutputConverter* outputConverter,
     cmStateDirectory const& stateDir) const override;
@@ -111,6 +121,30 @@ public:
   void WriteBuild(std::ostream& os, cmNinjaBuild const& build,
                   int cmdLineLimit = 0, bool* usedResponseFile = nullptr);
 
+  /**
+   * Return the name of a file-scope variable of @a os holding @a value.
+   * The variable is written to @a os before its first use so that build
+   * statements can refer to it instead of repeating the value.
+   * @warning no escaping of any kind is done here.
+   */
+  std::string const& PoolVariable(std::ostream& os, std::string const& prefix,
+                                  std::string const& value);
+
+  /// Forget the variables written by PoolVariable to a closed stream.
+  void ClearPooledVariables(std::ostream const& os)
+  {
+    this->PooledVariables.erase(&os);
+  }
+
+  /// Whether targets write their build statements to their own files.
+  bool GetPerTargetFiles() const { return this->PerTargetFiles; }
+
+  /// Record a per-target file so that regeneration lists it as an output.
+  void AddPerTargetFile(std::string path)
+  {
+    this->PerTargetFileNames.push_back(std::move(path));
+  }
+
   void WriteCustomCommandBuild(
     const std::string& command, const std::string& description,
     const std::string& comment, const std::string& depfile,
@@ -144,6 +178,13 @@ public:
   static void WriteInclude(std::ostream& os, const std::string& filename,
                            const std::string& comment = "");
 
+  /**
+   * Write a subninja statement including @a filename in a new scope with
+   * an optional @a comment to the @a os stream.
+   */
+  static void WriteSubninja(std::ostream& os, const std::string& filename,
+                            const std::string& comment = "");
+
   /**
    * Write a default target statement specifying @a targets as
    * the default targets.
@@ -240,7 +281,7 @@ public:
     return this->RulesFileStream.get();
   }
 
-  std::string const& ConvertToNinjaPath(const std::string& path) const;
+  std::string const& ConvertToNinjaPath(cm::string_view path) const;
 
   struct MapToNinjaPathImpl
   {
@@ -328,9 +369,12 @@ public:
   void AppendTargetDependsClosure(cmGeneratorTarget const* target,
                                   cmNinjaDeps& outputs,
                                   const std::string& config);
-  void AppendTargetDependsClosure(cmGeneratorTarget const* target,
-                                  cmNinjaOuts& outputs,
-                                  const std::string& config, bool omit_self);
+
+  /// Append the outputs of the targets that all of the given @a targets
+  /// depend on, directly or transitively, sorted.
+  void AppendTargetDependsClosure(
+    std::set<cmGeneratorTarget*> const& targets, cmNinjaDeps& outputs,
+    const std::string& config);
 
   void AppendDirectoryForConfig(const std::string& prefix,
                                 const std::string& config,
@@ -345,6 +389,13 @@ public:
   virtual void AddRebuildManifestOutputs(cmNinjaDeps& outputs) const
   {
     outputs.push_back(this->NinjaOutputPath(NINJA_BUILD_FILE));
+    this->AddPerTargetFileOutputs(outputs);
+  }
+
+  void AddPerTargetFileOutputs(cmNinjaDeps& outputs) const
+  {
+    outputs.insert(outputs.end(), this->PerTargetFileNames.begin(),
+                   this->PerTargetFileNames.end());
   }
 
   int GetRuleCmdLength(const std::string& name) { return RuleCmdLength[name]; }
@@ -470,9 +521,14 @@ private:
   void WriteTargetClean(std::ostream& os);
   void WriteTargetHelp(std::ostream& os);
 
-  void ComputeTargetDependsClosure(
-    cmGeneratorTarget const* target,
-    std::set<cmGeneratorTarget const*>& depends);
+  /// A set of targets as a bitset over their indices in IndexedTargets.
+  using TargetSet = std::vector<std::uint64_t>;
+
+  std::size_t GetTargetIndex(cmGeneratorTarget const* target);
+  TargetSet const& GetTargetDependsClosure(cmGeneratorTarget const* target,
+                                           const std::string& config);
+  void AppendTargetSetOutputs(TargetSet const& targets, cmNinjaDeps& outputs,
+                              const std::string& config);
 
   std::string CMakeCmd() const;
   std::string NinjaCmd() const;
@@ -520,8 +576,24 @@ private:
   TargetAliasMap TargetAliases;
   TargetAliasMap DefaultTargetAliases;
 
-  /// the local cache for calls to ConvertToNinjaPath
-  mutable std::unordered_map<std::string, std::string> ConvertToNinjaPathCache;
+  /// Variables written by PoolVariable, by stream and value.
+  std::unordered_map<std::ostream const*,
+                     std::unordered_map<std::string, std::string>>
+    PooledVariables;
+  unsigned int PooledVariableCount = 0;
+
+  bool PerTargetFiles = false;
+  std::vector<std::string> PerTargetFileNames;
+
+  /// Indices of the targets used in the TargetDependsClosures sets.
+  std::unordered_map<cmGeneratorTarget const*, std::size_t> TargetIndices;
+  std::vector<cmGeneratorTarget const*> IndexedTargets;
+
+  /// the local cache for calls to ConvertToNinjaPath, keyed by views of
+  /// the interned input paths so that a lookup does not allocate
+  mutable std::unordered_map<cm::string_view, std::string>
+    ConvertToNinjaPathCache;
+  mutable std::deque<std::string> ConvertToNinjaPathKeys;
 
   std::string NinjaCommand;
   std::string NinjaVersion;
@@ -548,7 +620,11 @@ private:
     /// The set of custom commands we have seen.
     std::set<cmCustomCommand const*> CustomCommands;
 
-    std::map<cmGeneratorTarget const*, cmNinjaOuts> TargetDependsClosures;
+    /// The targets each target depends on, directly or transitively.
+    /// Storing sets of target indices instead of their outputs keeps the
+    /// closures of large graphs small and cheap to merge.
+    std::unordered_map<cmGeneratorTarget const*, TargetSet>
+      TargetDependsClosures;
 
     TargetAliasMap TargetAliases;
 
@@ -19,6 +19,7 @@
 #include "cmLocalUnixMakefileGenerator3.h"
 #include "cmMakefile.h"
 #include "cmMakefileTargetGenerator.h"
+#include "cmMessageType.h"
 #include "cmOutputConverter.h"
 #include "cmProperty.h"
 #include "cmState.h"
@@ -132,8 +133,43 @@ void cmGlobalUnixMakefileGenerator3::Configure()
   this->cmGlobalGenerator::Configure();
 }
 
+bool cmGlobalUnixMakefileGenerator3::MakeProgramIsGNU() const
+{
+  // The non-recursive Makefile2 uses syntax that only GNU make accepts.
+  // Other make tools get the recursive Makefile2 so that the build works.
+  std::string const makeProgram = this->SelectMakeProgram(std::string());
+  std::vector<std::string> command;
+  command.push_back(makeProgram);
+  command.emplace_back("--version");
+  std::string version;
+  if (cmSystemTools::RunSingleCommand(command, &version, &version, nullptr,
+                                      nullptr, cmSystemTools::OUTPUT_NONE) &&
+      version.find("GNU Make") != std::string::npos) {
+    return true;
+  }
+  this->GetCMakeInstance()->IssueMessage(
+    MessageType::WARNING,
+    cmStrCat("CMAKE_MAKEFILE_NON_RECURSIVE is ignored because the make "
+             "program\n  ",
+             makeProgram,
+             "\nis not GNU make.  The targets are built recursively."));
+  return false;
+}
+
 void cmGlobalUnixMakefileGenerator3::Generate()
 {
+  // The Fortran module dependencies found by the depend step of a target
+  // must be read before its objects are built, which only a recursive
+  // make provides.  Duplicate custom targets would have clashing rules.
+  this->NonRecursive = this->AllowNonRecursive() &&
+    this->GlobalSettingIsOn("CMAKE_MAKEFILE_NON_RECURSIVE") &&
+    !this->GetLanguageEnabled("Fortran") &&
+    !this->GetCMakeInstance()->GetState()->GetGlobalPropertyAsBool(
+      "ALLOW_DUPLICATE_CUSTOM_TARGETS") &&
+    this->MakeProgramIsGNU();
+  this->NonRecursiveRules.clear();
+  this->NonRecursiveOutputs.clear();
+
   // first do superclass method
   this->cmGlobalGenerator::Generate();
 
@@ -256,6 +292,26 @@ void cmGlobalUnixMakefileGenerator3::WriteMainMakefile2()
 
   // Write special bottom targets
   lg.WriteSpecialTargetsBottom(makefileStream);
+
+  // Read the rules of all targets into this make process.
+  if (this->NonRecursive) {
+    lg.WriteDivider(makefileStream);
+    makefileStream << "# Rules of all targets.\n\n"
+                   << "# Skip the copies of rules that another target has.\n"
+                   << "CMAKE_MAKEFILE_NON_RECURSIVE = 1\n\n";
+    for (auto const& rules : this->NonRecursiveRules) {
+      auto const* tlg = static_cast<cmLocalUnixMakefileGenerator3 const*>(
+        rules.first->GetLocalGenerator());
+      std::string const buildMake = cmStrCat(
+        tlg->GetRelativeTargetDirectory(rules.first), "/build.make");
+      makefileStream << this->IncludeDirective << " "
+                     << cmSystemTools::ConvertToOutputPath(buildMake) << "\n"
+                     << rules.second << "\n";
+    }
+    for (auto const& output : this->NonRecursiveOutputs) {
+      makefileStream << output.second;
+    }
+  }
 }
 
 void cmGlobalUnixMakefileGenerator3::WriteMainCMakefile()
@@ -654,7 +710,14 @@ void cmGlobalUnixMakefileGenerator3::WriteConvenienceRules(
         // Write the rule.
         commands.clear();
         std::string tmp = "CMakeFiles/Makefile2";
-        commands.push_back(lg.GetRecursiveMakeCall(tmp, name));
+        if (this->NonRecursive) {
+          // The target name may be a file known to Makefile2.
+          commands.push_back(lg.GetRecursiveMakeCall(
+            tmp,
+            cmStrCat(lg.GetRelativeTargetDirectory(gtarget.get()), "/rule")));
+        } else {
+          commands.push_back(lg.GetRecursiveMakeCall(tmp, name));
+        }
         depends.clear();
         if (regenerate) {
           depends.emplace_back("cmake_check_build_system");
@@ -727,15 +790,15 @@ void cmGlobalUnixMakefileGenerator3::WriteConvenienceRules2(
       ruleFileStream << "# Target rules for target " << localName << "\n\n";
 
       commands.clear();
-      makeTargetName = cmStrCat(localName, "/depend");
-      commands.push_back(
-        lg.GetRecursiveMakeCall(makefileName, makeTargetName));
-
-      makeTargetName = cmStrCat(localName, "/build");
-      commands.push_back(
-        lg.GetRecursiveMakeCall(makefileName, makeTargetName));
+      std::string const dependName = cmStrCat(localName, "/depend");
+      std::string const buildName = cmStrCat(localName, "/build");
+      if (!this->NonRecursive) {
+        commands.push_back(lg.GetRecursiveMakeCall(makefileName, dependName));
+        commands.push_back(lg.GetRecursiveMakeCall(makefileName, buildName));
+      }
 
       // Write the rule.
+      std::string const orderName = cmStrCat(localName, "/order");
       localName += "/all";
       depends.clear();
 
@@ -764,6 +827,15 @@ void cmGlobalUnixMakefileGenerator3::WriteConvenienceRules2(
       }
 
       this->AppendGlobalTargetDepends(depends, gtarget.get());
+      if (this->NonRecursive) {
+        // The rules of the target are included below and wait for this
+        // one before anything of the target is built.
+        std::vector<std::string> no_commands;
+        lg.WriteMakeRule(ruleFileStream, "Order rule for target.", orderName,
+                         depends, no_commands, true);
+        depends.push_back(dependName);
+        depends.push_back(buildName);
+      }
       lg.WriteMakeRule(ruleFileStream, "All Build rule for target.", localName,
                        depends, commands, true);
 
@@ -803,6 +875,12 @@ void cmGlobalUnixMakefileGenerator3::WriteConvenienceRules2(
                        "Build rule for subdir invocation for target.",
                        localName, depends, commands, true);
 
+      // The included rules of a non-recursive build already provide the
+      // remaining rules, and the canonical name may be one of its files.
+      if (this->NonRecursive) {
+        continue;
+      }
+
       // Add a target with the canonical name (no prefix, suffix or path).
       commands.clear();
       depends.clear();
@@ -907,6 +985,28 @@ void cmGlobalUnixMakefileGenerator3::RecordTargetProgress(
   TargetProgress& tp = this->ProgressMap[tg->GetGeneratorTarget()];
   tp.NumberOfActions = tg->GetNumberOfProgressActions();
   tp.VariableFile = tg->GetProgressFileNameFull();
+  tp.VariablePrefix = tg->GetMakeVariablePrefix();
+}
+
+void cmGlobalUnixMakefileGenerator3::RecordNonRecursiveRules(
+  cmMakefileTargetGenerator* tg)
+{
+  this->NonRecursiveRules[tg->GetGeneratorTarget()] =
+    tg->GetNonRecursiveRules();
+}
+
+bool cmGlobalUnixMakefileGenerator3::ClaimCustomCommandOutput(
+  std::string const& output, std::string orderRule)
+{
+  auto const it = this->NonRecursiveOutputs.find(output);
+  if (it == this->NonRecursiveOutputs.end()) {
+    this->NonRecursiveOutputs.emplace(output, std::move(orderRule));
+    return true;
+  }
+  // The output cannot wait for the dependencies of one of the targets
+  // listing it without risking a cycle.
+  it->second.clear();
+  return false;
 }
 
 void cmGlobalUnixMakefileGenerator3::TargetProgress::WriteProgressVariables(
@@ -914,7 +1014,7 @@ void cmGlobalUnixMakefileGenerator3::TargetProgress::WriteProgressVariables(
 {
   cmGeneratedFileStream fout(this->VariableFile);
   for (unsigned long i = 1; i <= this->NumberOfActions; ++i) {
-    fout << "CMAKE_PROGRESS_" << i << " = ";
+    fout << this->VariablePrefix << "CMAKE_PROGRESS_" << i << " = ";
     if (total <= 100) {
       unsigned long num = i + current;
       fout << num;
@@ -54,6 +54,10 @@ struct cmDocumentationEntry;
  source.obj.depend is used as a marker to indicate when dependencies must be
  rescanned.
 
+ With CMAKE_MAKEFILE_NON_RECURSIVE, Makefile2 instead includes the
+ build.make file of every target and orders targets by order-only
+ prerequisites, so that a single make process builds all of them.
+
  Rules for custom commands follow the same model as rules for source files.
 
  */
@@ -153,6 +157,22 @@ public:
   /** Record per-target progress information.  */
   void RecordTargetProgress(cmMakefileTargetGenerator* tg);
 
+  /** Whether one make process builds all targets by reading their
+      build.make files into Makefile2.  See CMAKE_MAKEFILE_NON_RECURSIVE.  */
+  bool IsNonRecursive() const { return this->NonRecursive; }
+
+  /** Record the ordering rules Makefile2 adds after including the
+      build.make file of a target in a non-recursive build.  */
+  void RecordNonRecursiveRules(cmMakefileTargetGenerator* tg);
+
+  /** Return true if no other target wrote a rule for the given custom
+      command output yet.  A non-recursive build may have only one, other
+      targets write a copy that Makefile2 skips.  The given rule orders
+      the output after the dependencies of the target unless another
+      target lists the output too.  */
+  bool ClaimCustomCommandOutput(std::string const& output,
+                                std::string orderRule);
+
   void AddCXXCompileCommand(const std::string& sourceFile,
                             const std::string& workingDirectory,
                             const std::string& compileCommand);
@@ -163,6 +183,14 @@ public:
   /** Does the make tool tolerate .DELETE_ON_ERROR? */
   virtual bool AllowDeleteOnError() const { return true; }
 
+  /** Does the make tool support a non-recursive build?  It needs
+      order-only prerequisites and pattern-specific variables.  */
+  virtual bool AllowNonRecursive() const { return true; }
+
+  /** Is CMAKE_MAKE_PROGRAM a GNU make?  Warn about the non-recursive
+      build being ignored if not.  */
+  bool MakeProgramIsGNU() const;
+
   /** Does the make tool interpret '\#' as '#'?  */
   virtual bool CanEscapeOctothorpe() const;
 
@@ -236,6 +264,7 @@ protected:
   {
     unsigned long NumberOfActions = 0;
     std::string VariableFile;
+    std::string VariablePrefix;
     std::vector<unsigned long> Marks;
     void WriteProgressVariables(unsigned long total, unsigned long& current);
   };
@@ -250,6 +279,12 @@ protected:
 
   std::unique_ptr<cmGeneratedFileStream> CommandDatabase;
 
+  bool NonRecursive = false;
+  std::map<cmGeneratorTarget const*, std::string,
+           cmGeneratorTarget::StrictTargetComparison>
+    NonRecursiveRules;
+  std::map<std::string, std::string> NonRecursiveOutputs;
+
 private:
   const char* GetBuildIgnoreErrorsFlag() const override { return "-i"; }
   std::string GetEditCacheCommand() const override;
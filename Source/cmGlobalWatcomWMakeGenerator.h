@@ -53,6 +53,7 @@ public:
 
   bool AllowNotParallel() const override { return false; }
   bool AllowDeleteOnError() const override { return false; }
+  bool AllowNonRecursive() const override { return false; }
 
 protected:
   std::vector<GeneratedMakeCommand> GenerateBuildCommand(
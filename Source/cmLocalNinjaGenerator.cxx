@@ -95,6 +95,11 @@ void cmLocalNinjaGenerator::Generate()
     }
     auto tg = cmNinjaTargetGenerator::New(target.get());
     if (tg) {
+#if !defined(CMAKE_BOOTSTRAP)
+      auto profilingEntry =
+        this->GetCMakeInstance()->CreateProfilingEntry("target",
+                                                       target->GetName());
+#endif
       if (target->Target->IsPerConfig()) {
         for (auto const& config : this->GetConfigNames()) {
           tg->Generate(config);
@@ -642,25 +647,10 @@ void cmLocalNinjaGenerator::WriteCustomCommandBuildStatements(
     //
     // FIXME: This won't work in certain obscure scenarios involving indirect
     // dependencies.
-    auto j = i->second.begin();
-    assert(j != i->second.end());
+    assert(!i->second.empty());
     std::vector<std::string> ccTargetDeps;
     this->GetGlobalNinjaGenerator()->AppendTargetDependsClosure(
-      *j, ccTargetDeps, config);
-    std::sort(ccTargetDeps.begin(), ccTargetDeps.end());
-    ++j;
-
-    for (; j != i->second.end(); ++j) {
-      std::vector<std::string> jDeps;
-      std::vector<std::string> depsIntersection;
-      this->GetGlobalNinjaGenerator()->AppendTargetDependsClosure(*j, jDeps,
-                                                                  config);
-      std::sort(jDeps.begin(), jDeps.end());
-      std::set_intersection(ccTargetDeps.begin(), ccTargetDeps.end(),
-                            jDeps.begin(), jDeps.end(),
-                            std::back_inserter(depsIntersection));
-      ccTargetDeps = depsIntersection;
-    }
+      i->second, ccTargetDeps, config);
 
     this->WriteCustomCommandBuildStatement(i->first, ccTargetDeps, config);
   }
@@ -45,6 +45,7 @@
 // C/C++ scanner is needed for bootstrapping CMake.
 #include "cmDependsC.h"
 #ifndef CMAKE_BOOTSTRAP
+#  include "cmDependsCompiler.h"
 #  include "cmDependsFortran.h"
 #  include "cmDependsJava.h"
 #endif
@@ -107,8 +108,16 @@ void cmLocalUnixMakefileGenerator3::Generate()
     std::unique_ptr<cmMakefileTargetGenerator> tg(
       cmMakefileTargetGenerator::New(target.get()));
     if (tg) {
+#if !defined(CMAKE_BOOTSTRAP)
+      auto profilingEntry =
+        this->GetCMakeInstance()->CreateProfilingEntry("target",
+                                                       target->GetName());
+#endif
       tg->WriteRuleFiles();
       gg->RecordTargetProgress(tg.get());
+      if (gg->IsNonRecursive()) {
+        gg->RecordNonRecursiveRules(tg.get());
+      }
     }
   }
 
@@ -1294,6 +1303,21 @@ bool cmLocalUnixMakefileGenerator3::UpdateDependencies(
   std::string const internalDependFile = targetDir + "/depend.internal";
   std::string const dependFile = targetDir + "/depend.make";
 
+#ifndef CMAKE_BOOTSTRAP
+  // Merge the dependency files written by the compiler.
+  std::vector<std::string> const compilerDependFiles = cmExpandedList(
+    this->Makefile->GetSafeDefinition("CMAKE_DEPENDS_DEPENDENCY_FILES"));
+  if (!compilerDependFiles.empty()) {
+    cmDependsCompiler compilerDepends(this, targetDir);
+    if (!compilerDepends.Check(compilerDependFiles, tgtInfo)) {
+      this->ReadDirectoryInformation();
+      if (!compilerDepends.Write(compilerDependFiles)) {
+        return false;
+      }
+    }
+  }
+#endif
+
   // If the target DependInfo.cmake file has changed since the last
   // time dependencies were scanned then force rescanning.  This may
   // happen when a new source file is added and CMake regenerates the
@@ -1352,8 +1376,8 @@ bool cmLocalUnixMakefileGenerator3::UpdateDependencies(
     // dependency vector. This means that in the normal case, when only
     // few or one file have been edited, then also only this one file is
     // actually scanned again, instead of all files for this target.
-    needRescanDependencies =
-      !checker.Check(dependFile, internalDependFile, validDependencies);
+    needRescanDependencies = !checker.Check(
+      dependFile, internalDependFile, validDependencies, needRescanDependInfo);
   }
 
   if (needRescanDependInfo || needRescanDirInfo || needRescanDependencies) {
@@ -1374,9 +1398,7 @@ bool cmLocalUnixMakefileGenerator3::UpdateDependencies(
   return true;
 }
 
-bool cmLocalUnixMakefileGenerator3::ScanDependencies(
-  std::string const& targetDir, std::string const& dependFile,
-  std::string const& internalDependFile, cmDepends::DependencyMap& validDeps)
+void cmLocalUnixMakefileGenerator3::ReadDirectoryInformation()
 {
   // Read the directory information file.
   cmMakefile* mf = this->Makefile;
@@ -1414,6 +1436,14 @@ bool cmLocalUnixMakefileGenerator3::ScanDependencies(
   } else {
     cmSystemTools::Error("Directory Information file not found");
   }
+}
+
+bool cmLocalUnixMakefileGenerator3::ScanDependencies(
+  std::string const& targetDir, std::string const& dependFile,
+  std::string const& internalDependFile, cmDepends::DependencyMap& validDeps)
+{
+  this->ReadDirectoryInformation();
+  cmMakefile* mf = this->Makefile;
 
   // Open the make depends file.  This should be copy-if-different
   // because the make tool may try to reload it needlessly otherwise.
@@ -1424,17 +1454,10 @@ bool cmLocalUnixMakefileGenerator3::ScanDependencies(
     return false;
   }
 
-  // Open the cmake dependency tracking file.  This should not be
-  // copy-if-different because dependencies are re-scanned when it is
-  // older than the DependInfo.cmake.
-  cmGeneratedFileStream internalRuleFileStream(
-    internalDependFile, false, this->GlobalGenerator->GetMakefileEncoding());
-  if (!internalRuleFileStream) {
-    return false;
-  }
-
   this->WriteDisclaimer(ruleFileStream);
-  this->WriteDisclaimer(internalRuleFileStream);
+
+  // The dependencies recorded in the cmake dependency tracking file.
+  cmDepends::DependencyMap internalDepends;
 
   // for each language we need to scan, scan it
   std::vector<std::string> langs =
@@ -1464,11 +1487,11 @@ bool cmLocalUnixMakefileGenerator3::ScanDependencies(
         this->GlobalGenerator->GetCMakeInstance()->GetFileTimeCache());
       scanner->SetLanguage(lang);
       scanner->SetTargetDirectory(targetDir);
-      scanner->Write(ruleFileStream, internalRuleFileStream);
+      scanner->Write(ruleFileStream, internalDepends);
     }
   }
 
-  return true;
+  return cmDepends::WriteDatabase(internalDependFile, internalDepends);
 }
 
 void cmLocalUnixMakefileGenerator3::CheckMultipleOutputs(bool verbose)
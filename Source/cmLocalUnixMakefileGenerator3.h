@@ -239,6 +239,7 @@ protected:
   void AppendDirectoryCleanCommand(std::vector<std::string>& commands);
 
   // Helper methods for dependency updates.
+  void ReadDirectoryInformation();
   bool ScanDependencies(std::string const& targetDir,
                         std::string const& dependFile,
                         std::string const& internalDependFile,
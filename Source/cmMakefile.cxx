@@ -20,9 +20,6 @@
 #include <cmext/algorithm>
 #include <cmext/string_view>
 
-#include <cm3p/json/value.h>
-#include <cm3p/json/writer.h>
-
 #include "cmsys/FStream.hxx"
 #include "cmsys/RegularExpression.hxx"
 
@@ -58,6 +55,7 @@
 #include "cmTargetLinkLibraryType.h"
 #include "cmTest.h"
 #include "cmTestGenerator.h" // IWYU pragma: keep
+#include "cmTraceWriter.h"
 #include "cmVersion.h"
 #include "cmWorkingDirectory.h"
 #include "cmake.h"
@@ -315,8 +313,8 @@ void cmMakefile::PrintCommandTrace(const cmListFileFunction& lff) const
     }
   }
 
-  std::ostringstream msg;
-  std::vector<std::string> args;
+  cmTraceWriter::Record record;
+  std::vector<std::string>& args = record.Args;
   std::string temp;
   bool expand = this->GetCMakeInstance()->GetTraceExpand();
 
@@ -331,45 +329,20 @@ void cmMakefile::PrintCommandTrace(const cmListFileFunction& lff) const
     }
   }
 
-  switch (this->GetCMakeInstance()->GetTraceFormat()) {
-    case cmake::TraceFormat::TRACE_JSON_V1: {
-#ifndef CMAKE_BOOTSTRAP
-      Json::Value val;
-      Json::StreamWriterBuilder builder;
-      builder["indentation"] = "";
-      val["file"] = full_path;
-      val["line"] = static_cast<Json::Value::Int64>(lff.Line);
-      val["cmd"] = lff.Name.Original;
-      val["args"] = Json::Value(Json::arrayValue);
-      for (std::string const& arg : args) {
-        val["args"].append(arg);
-      }
-      val["time"] = cmSystemTools::GetTime();
-      val["frame"] =
-        static_cast<Json::Value::UInt64>(this->ExecutionStatusStack.size());
-      msg << Json::writeString(builder, val);
-#endif
-      break;
-    }
-    case cmake::TraceFormat::TRACE_HUMAN:
-      msg << full_path << "(" << lff.Line << "):  ";
-      msg << lff.Name.Original << "(";
-
-      for (std::string const& arg : args) {
-        msg << arg << " ";
-      }
-      msg << ")";
-      break;
-    case cmake::TraceFormat::TRACE_UNDEFINED:
-      msg << "INTERNAL ERROR: Trace format is TRACE_UNDEFINED";
-      break;
+  record.File = full_path;
+  record.Line = lff.Line;
+  record.Command = lff.Name.Original;
+  cmake::TraceFormat const format = this->GetCMakeInstance()->GetTraceFormat();
+  if (format == cmake::TraceFormat::TRACE_JSON_V1) {
+    record.Time = cmSystemTools::GetTime();
+    record.Frame = this->ExecutionStatusStack.size();
   }
 
-  auto& f = this->GetCMakeInstance()->GetTraceFile();
-  if (f) {
-    f << msg.str() << '\n';
+  // Formatting and writing to a trace file is done in the background.
+  if (cmTraceWriter* writer = this->GetCMakeInstance()->GetTraceWriter()) {
+    writer->Write(std::move(record));
   } else {
-    cmSystemTools::Message(msg.str());
+    cmSystemTools::Message(cmTraceWriter::Format(record, format));
   }
 }
 
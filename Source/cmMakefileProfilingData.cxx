@@ -6,19 +6,35 @@
 #include <stdexcept>
 #include <vector>
 
-#include <cm3p/json/value.h>
+#include <cm/memory>
+
 #include <cm3p/json/writer.h>
 
 #include "cmsys/FStream.hxx"
 #include "cmsys/SystemInformation.hxx"
 
 #include "cmListFileCache.h"
+#include "cmMakefileProfilingSummary.h"
 #include "cmStringAlgorithms.h"
 #include "cmSystemTools.h"
 
 cmMakefileProfilingData::cmMakefileProfilingData(
-  const std::string& profileStream)
+  const std::string& profileStream, Format format, cmState const* state)
 {
+  if (format == Format::Summary) {
+    // Probe the outputs now so that errors are reported up front.
+    std::string const foldedStream = profileStream + ".folded";
+    for (std::string const& path : { profileStream, foldedStream }) {
+      cmsys::ofstream probe(path.c_str(), std::ios::out | std::ios::trunc);
+      if (!probe.good()) {
+        throw std::runtime_error(std::string("Unable to open: ") + path);
+      }
+    }
+    this->Summary = cm::make_unique<cmMakefileProfilingSummary>(
+      profileStream, foldedStream, state);
+    return;
+  }
+
   std::ios::openmode omode = std::ios::out | std::ios::trunc;
   this->ProfileStream.open(profileStream.c_str(), omode);
   Json::StreamWriterBuilder wbuilder;
@@ -33,6 +49,17 @@ cmMakefileProfilingData::cmMakefileProfilingData(
 
 cmMakefileProfilingData::~cmMakefileProfilingData() noexcept
 {
+  if (this->Summary) {
+    try {
+      if (!this->Summary->Write()) {
+        cmSystemTools::Error("Error writing profiling output!");
+      }
+    } catch (...) {
+      cmSystemTools::Error("Error writing profiling output!");
+    }
+    return;
+  }
+
   if (this->ProfileStream.good()) {
     try {
       this->ProfileStream << "]";
@@ -46,6 +73,34 @@ cmMakefileProfilingData::~cmMakefileProfilingData() noexcept
 void cmMakefileProfilingData::StartEntry(const cmListFileFunction& lff,
                                          cmListFileContext const& lfc)
 {
+  if (this->Summary) {
+    this->Summary->StartEntry(lff, lfc);
+    return;
+  }
+
+  Json::Value argsValue;
+  if (!lff.Arguments.empty()) {
+    std::string args;
+    for (const auto& a : lff.Arguments) {
+      args += (args.empty() ? "" : " ") + a.Value;
+    }
+    argsValue["functionArgs"] = args;
+  }
+  argsValue["location"] = lfc.FilePath + ":" + std::to_string(lfc.Line);
+  this->StartEntry("cmake", lff.Name.Lower, std::move(argsValue));
+}
+
+void cmMakefileProfilingData::StartEntry(const std::string& category,
+                                         const std::string& name,
+                                         cm::optional<Json::Value> args)
+{
+  if (this->Summary) {
+    this->Summary->StartEntry(category, name);
+    return;
+  }
+
+  this->GenexEvaluationsAtStart.push_back(this->GenexEvaluations);
+
   /* Do not try again if we previously failed to write to output. */
   if (!this->ProfileStream.good()) {
     return;
@@ -58,24 +113,17 @@ void cmMakefileProfilingData::StartEntry(const cmListFileFunction& lff,
     cmsys::SystemInformation info;
     Json::Value v;
     v["ph"] = "B";
-    v["name"] = lff.Name.Lower;
-    v["cat"] = "cmake";
+    v["name"] = name;
+    v["cat"] = category;
     v["ts"] = Json::Value::UInt64(
       std::chrono::duration_cast<std::chrono::microseconds>(
         std::chrono::steady_clock::now().time_since_epoch())
         .count());
     v["pid"] = static_cast<int>(info.GetProcessId());
     v["tid"] = 0;
-    Json::Value argsValue;
-    if (!lff.Arguments.empty()) {
-      std::string args;
-      for (const auto& a : lff.Arguments) {
-        args += (args.empty() ? "" : " ") + a.Value;
-      }
-      argsValue["functionArgs"] = args;
+    if (args) {
+      v["args"] = *std::move(args);
     }
-    argsValue["location"] = lfc.FilePath + ":" + std::to_string(lfc.Line);
-    v["args"] = argsValue;
 
     this->JsonWriter->write(v, &this->ProfileStream);
   } catch (std::ios_base::failure& fail) {
@@ -88,6 +136,18 @@ void cmMakefileProfilingData::StartEntry(const cmListFileFunction& lff,
 
 void cmMakefileProfilingData::StopEntry()
 {
+  if (this->Summary) {
+    this->Summary->StopEntry();
+    return;
+  }
+
+  std::uint64_t genexEvaluations = 0;
+  if (!this->GenexEvaluationsAtStart.empty()) {
+    genexEvaluations =
+      this->GenexEvaluations - this->GenexEvaluationsAtStart.back();
+    this->GenexEvaluationsAtStart.pop_back();
+  }
+
   /* Do not try again if we previously failed to write to output. */
   if (!this->ProfileStream.good()) {
     return;
@@ -104,6 +164,9 @@ void cmMakefileProfilingData::StopEntry()
         .count());
     v["pid"] = static_cast<int>(info.GetProcessId());
     v["tid"] = 0;
+    if (genexEvaluations != 0) {
+      v["args"]["genexEvaluations"] = Json::Value::UInt64(genexEvaluations);
+    }
     this->JsonWriter->write(v, &this->ProfileStream);
   } catch (std::ios_base::failure& fail) {
     cmSystemTools::Error(
@@ -112,3 +175,48 @@ void cmMakefileProfilingData::StopEntry()
     cmSystemTools::Error("Error writing profiling output!");
   }
 }
+
+void cmMakefileProfilingData::StartGenexEntry(
+  cmListFileBacktrace const& backtrace, std::string const& input)
+{
+  ++this->GenexEvaluations;
+  if (this->Summary) {
+    if (!backtrace.Empty()) {
+      cmListFileContext const& lfc = backtrace.Top();
+      this->Summary->StartGenexEntry(cmStrCat(lfc.FilePath, ':', lfc.Line));
+    } else {
+      this->Summary->StartGenexEntry(input.substr(0, 80));
+    }
+  }
+}
+
+void cmMakefileProfilingData::StopGenexEntry()
+{
+  if (this->Summary) {
+    this->Summary->StopEntry();
+  }
+}
+
+cmMakefileProfilingData::RAII::RAII(RAII&& other) noexcept
+  : Data(other.Data)
+{
+  other.Data = nullptr;
+}
+
+cmMakefileProfilingData::RAII::~RAII()
+{
+  if (this->Data) {
+    this->Data->StopEntry();
+  }
+}
+
+cmMakefileProfilingData::RAII& cmMakefileProfilingData::RAII::operator=(
+  RAII&& other) noexcept
+{
+  if (this->Data) {
+    this->Data->StopEntry();
+  }
+  this->Data = other.Data;
+  other.Data = nullptr;
+  return *this;
+}
@@ -2,8 +2,15 @@
    file Copyright.txt or https://cmake.org/licensing for details.  */
 #ifndef cmMakefileProfilingData_h
 #define cmMakefileProfilingData_h
+#include <cstdint>
 #include <memory>
 #include <string>
+#include <utility>
+#include <vector>
+
+#include <cm/optional>
+
+#include <cm3p/json/value.h>
 
 #include "cmsys/FStream.hxx"
 
@@ -11,19 +18,66 @@ namespace Json {
 class StreamWriter;
 }
 
+class cmListFileBacktrace;
 class cmListFileContext;
+class cmMakefileProfilingSummary;
+class cmState;
 struct cmListFileFunction;
 
 class cmMakefileProfilingData
 {
 public:
-  cmMakefileProfilingData(const std::string&);
+  enum class Format
+  {
+    GoogleTrace,
+    Summary
+  };
+
+  cmMakefileProfilingData(const std::string&, Format = Format::GoogleTrace,
+                          cmState const* state = nullptr);
   ~cmMakefileProfilingData() noexcept;
   void StartEntry(const cmListFileFunction& lff, cmListFileContext const& lfc);
+  void StartEntry(const std::string& category, const std::string& name,
+                  cm::optional<Json::Value> args = cm::nullopt);
   void StopEntry();
 
+  /** Generator expression evaluations are counted in the trace format and
+      reported with each enclosing entry.  Only the aggregated summary
+      format times them individually; one event per evaluation would make
+      the trace far too large.  The entry is keyed by the call site of the
+      expression, or by its beginning if the call site is not known.  */
+  void StartGenexEntry(cmListFileBacktrace const& backtrace,
+                       std::string const& input);
+  void StopGenexEntry();
+
+  class RAII
+  {
+  public:
+    RAII() = delete;
+    RAII(const RAII&) = delete;
+    RAII(RAII&&) noexcept;
+
+    template <typename... Args>
+    RAII(cmMakefileProfilingData& data, Args&&... args)
+      : Data(&data)
+    {
+      this->Data->StartEntry(std::forward<Args>(args)...);
+    }
+
+    ~RAII();
+
+    RAII& operator=(const RAII&) = delete;
+    RAII& operator=(RAII&&) noexcept;
+
+  private:
+    cmMakefileProfilingData* Data = nullptr;
+  };
+
 private:
   cmsys::ofstream ProfileStream;
+  std::unique_ptr<cmMakefileProfilingSummary> Summary;
   std::unique_ptr<Json::StreamWriter> JsonWriter;
+  std::uint64_t GenexEvaluations = 0;
+  std::vector<std::uint64_t> GenexEvaluationsAtStart;
 };
 #endif
@@ -0,0 +1,183 @@
+/* Distributed under the OSI-approved BSD 3-Clause License.  See accompanying
+   file Copyright.txt or https://cmake.org/licensing for details.  */
+#include "cmMakefileProfilingSummary.h"
+
+#include <algorithm>
+#include <iomanip>
+#include <utility>
+
+#include "cmsys/FStream.hxx"
+
+#include "cmListFileCache.h"
+#include "cmState.h"
+#include "cmStringAlgorithms.h"
+
+namespace {
+std::string FoldedLabel(std::string label)
+{
+  // The folded stack format uses ';' to separate frames.
+  std::replace(label.begin(), label.end(), ';', ',');
+  return label;
+}
+
+double ToMilliseconds(std::chrono::steady_clock::duration d)
+{
+  return std::chrono::duration<double, std::milli>(d).count();
+}
+}
+
+cmMakefileProfilingSummary::cmMakefileProfilingSummary(
+  std::string summaryPath, std::string foldedPath, cmState const* state)
+  : SummaryPath(std::move(summaryPath))
+  , FoldedPath(std::move(foldedPath))
+  , State(state)
+{
+}
+
+void cmMakefileProfilingSummary::StartEntry(const cmListFileFunction& lff,
+                                            cmListFileContext const& lfc)
+{
+  std::string const& name = lff.Name.Lower;
+  if (name == "find_package") {
+    std::string package =
+      lff.Arguments.empty() ? std::string() : lff.Arguments.front().Value;
+    std::string label = cmStrCat(name, '(', package, ')');
+    this->PushFrame("find_package", std::move(package), lfc.FilePath, label);
+  } else if (name == "try_compile" || name == "try_run") {
+    this->PushFrame("try_compile",
+                    cmStrCat(lfc.FilePath, ':', lfc.Line, ' ', name),
+                    lfc.FilePath, name);
+  } else if (this->State && this->State->IsScriptedCommand(name)) {
+    this->PushFrame("function/macro", name, lfc.FilePath, name);
+  } else {
+    this->PushFrame("command", name, lfc.FilePath, name);
+  }
+}
+
+void cmMakefileProfilingSummary::StartEntry(std::string const& category,
+                                            std::string const& name)
+{
+  this->PushFrame(category, name, std::string(), name);
+}
+
+void cmMakefileProfilingSummary::StartGenexEntry(std::string const& key)
+{
+  this->PushFrame("genex", key, std::string(), "$<genex>");
+}
+
+void cmMakefileProfilingSummary::PushFrame(std::string category,
+                                           std::string key, std::string file,
+                                           std::string const& label)
+{
+  Frame frame;
+  if (!this->Frames.empty()) {
+    frame.Stack = this->Frames.back().Stack;
+    frame.Stack += ';';
+  }
+  // Start a new listfile frame whenever execution moves to another file.
+  if (!file.empty() &&
+      (this->Frames.empty() || this->Frames.back().File != file)) {
+    frame.Stack += FoldedLabel(file);
+    frame.Stack += ';';
+  }
+  frame.Stack += FoldedLabel(label);
+
+  ++this->Active[cmStrCat(category, '\n', key)];
+  if (!file.empty()) {
+    ++this->Active[cmStrCat("listfile\n", file)];
+  }
+
+  frame.Category = std::move(category);
+  frame.Key = std::move(key);
+  frame.File = std::move(file);
+  frame.Start = Clock::now();
+  this->Frames.push_back(std::move(frame));
+}
+
+void cmMakefileProfilingSummary::StopEntry()
+{
+  if (this->Frames.empty()) {
+    return;
+  }
+
+  Clock::duration const elapsed = Clock::now() - this->Frames.back().Start;
+  Frame frame = std::move(this->Frames.back());
+  this->Frames.pop_back();
+  if (!this->Frames.empty()) {
+    this->Frames.back().Children += elapsed;
+  }
+  Clock::duration const self = elapsed - frame.Children;
+
+  auto record = [this, elapsed, self](std::string const& category,
+                                      std::string const& key) {
+    Stats& stats = this->Categories[category][key];
+    ++stats.Count;
+    stats.Self += self;
+    if (--this->Active[cmStrCat(category, '\n', key)] == 0) {
+      stats.Total += elapsed;
+    }
+  };
+  record(frame.Category, frame.Key);
+  if (!frame.File.empty()) {
+    record("listfile", frame.File);
+  }
+
+  this->FoldedStacks[frame.Stack] += self;
+}
+
+bool cmMakefileProfilingSummary::Write()
+{
+  cmsys::ofstream summary(this->SummaryPath.c_str(),
+                          std::ios::out | std::ios::trunc);
+  if (!summary) {
+    return false;
+  }
+
+  summary << "CMake profiling summary\n"
+             "  count: number of calls (commands executed for listfiles)\n"
+             "  total: inclusive wall time in milliseconds\n"
+             "  self:  exclusive wall time in milliseconds\n";
+  summary << std::fixed << std::setprecision(3);
+
+  using Entry = std::pair<std::string const*, Stats const*>;
+  for (auto const& category : this->Categories) {
+    std::vector<Entry> entries;
+    entries.reserve(category.second.size());
+    for (auto const& e : category.second) {
+      entries.emplace_back(&e.first, &e.second);
+    }
+    std::stable_sort(entries.begin(), entries.end(),
+                     [](Entry const& l, Entry const& r) {
+                       return l.second->Total > r.second->Total;
+                     });
+
+    summary << "\n" << category.first << "\n";
+    summary << std::setw(10) << "count" << std::setw(14) << "total"
+            << std::setw(14) << "self"
+            << "  name\n";
+    for (Entry const& e : entries) {
+      summary << std::setw(10) << e.second->Count << std::setw(14)
+              << ToMilliseconds(e.second->Total) << std::setw(14)
+              << ToMilliseconds(e.second->Self) << "  " << *e.first << "\n";
+    }
+  }
+  summary.close();
+
+  cmsys::ofstream folded(this->FoldedPath.c_str(),
+                         std::ios::out | std::ios::trunc);
+  if (!folded) {
+    return false;
+  }
+  std::vector<std::pair<std::string, Clock::duration>> stacks(
+    this->FoldedStacks.begin(), this->FoldedStacks.end());
+  std::sort(stacks.begin(), stacks.end());
+  for (auto const& s : stacks) {
+    folded << s.first << ' '
+           << std::chrono::duration_cast<std::chrono::microseconds>(s.second)
+                .count()
+           << '\n';
+  }
+  folded.close();
+
+  return summary && folded;
+}
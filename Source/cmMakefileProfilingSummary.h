@@ -0,0 +1,78 @@
+/* Distributed under the OSI-approved BSD 3-Clause License.  See accompanying
+   file Copyright.txt or https://cmake.org/licensing for details.  */
+#ifndef cmMakefileProfilingSummary_h
+#define cmMakefileProfilingSummary_h
+
+#include "cmConfigure.h" // IWYU pragma: keep
+
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+class cmListFileContext;
+class cmState;
+struct cmListFileFunction;
+
+/** \class cmMakefileProfilingSummary
+ * \brief Aggregate profiling data instead of recording one event per call.
+ *
+ * Every entry is timed on a stack so that both the inclusive (total) and
+ * exclusive (self) time can be accumulated per listfile, per user-defined
+ * function or macro, per built-in command, per find_package() package, per
+ * try_compile() call site, per generator expression and per generate step.
+ * The result is written as a plain text table plus a folded-stack file
+ * suitable for flame graph tools.
+ */
+class cmMakefileProfilingSummary
+{
+public:
+  cmMakefileProfilingSummary(std::string summaryPath, std::string foldedPath,
+                             cmState const* state);
+
+  void StartEntry(const cmListFileFunction& lff, cmListFileContext const& lfc);
+  void StartEntry(std::string const& category, std::string const& name);
+  void StartGenexEntry(std::string const& key);
+  void StopEntry();
+
+  /** Write the summary table and folded stacks.  Returns false on error. */
+  bool Write();
+
+private:
+  using Clock = std::chrono::steady_clock;
+
+  struct Stats
+  {
+    std::uint64_t Count = 0;
+    Clock::duration Total = Clock::duration::zero();
+    Clock::duration Self = Clock::duration::zero();
+  };
+
+  struct Frame
+  {
+    std::string Category;
+    std::string Key;
+    std::string File;
+    std::string Stack;
+    Clock::time_point Start;
+    Clock::duration Children = Clock::duration::zero();
+  };
+
+  void PushFrame(std::string category, std::string key, std::string file,
+                 std::string const& label);
+
+  std::string SummaryPath;
+  std::string FoldedPath;
+  cmState const* State;
+
+  std::vector<Frame> Frames;
+  // Entries currently on the stack, used to avoid counting the total time
+  // of recursive invocations more than once.
+  std::unordered_map<std::string, unsigned int> Active;
+  std::map<std::string, std::map<std::string, Stats>> Categories;
+  std::unordered_map<std::string, Clock::duration> FoldedStacks;
+};
+
+#endif
@@ -142,6 +142,16 @@ void cmMakefileTargetGenerator::CreateRuleFile()
   // reset the progress count
   this->NumberOfProgressActions = 0;
 
+  // All build files of a non-recursive build are read by one make
+  // process, so the variables of a target are prefixed by its unique
+  // directory.  Names derived from the target name could clash, e.g.
+  // those of targets "a.b" and "a_b".
+  if (this->GlobalGenerator->IsNonRecursive()) {
+    this->MakeVariablePrefix = cmStrCat(
+      this->LocalGenerator->GetRelativeTargetDirectory(this->GeneratorTarget),
+      '/');
+  }
+
   // Open the rule file.  This should be copy-if-different because the
   // rules may depend on this file itself.
   this->BuildFileStream = cm::make_unique<cmGeneratedFileStream>(
@@ -293,6 +303,24 @@ void cmMakefileTargetGenerator::WriteCommonCodeRules()
            this->LocalGenerator->GetBinaryDirectory(), dependFileNameFull))
     << "\n\n";
 
+  // Include the dependencies written by the compiler for the target.
+  std::string compilerDependFileFull;
+  if (this->Makefile->IsOn("CMAKE_DEPENDS_USE_COMPILER")) {
+    compilerDependFileFull =
+      cmStrCat(this->TargetBuildDirectoryFull, "/compiler_depend.make");
+    this->CompilerDependFile = cmStrCat(
+      root,
+      cmSystemTools::ConvertToOutputPath(
+        this->LocalGenerator->MaybeConvertToRelativePath(
+          this->LocalGenerator->GetBinaryDirectory(),
+          compilerDependFileFull)));
+    *this->BuildFileStream
+      << "# Include any dependencies written by the compiler for this "
+         "target.\n"
+      << this->GlobalGenerator->IncludeDirective << " "
+      << this->CompilerDependFile << "\n\n";
+  }
+
   if (!this->NoRuleMessages) {
     // Include the progress variables for the target.
     *this->BuildFileStream
@@ -314,6 +342,15 @@ void cmMakefileTargetGenerator::WriteCommonCodeRules()
                   << this->GeneratorTarget->GetName() << ".\n"
                   << "# This may be replaced when dependencies are built.\n";
   }
+  if (!compilerDependFileFull.empty() &&
+      !cmSystemTools::FileExists(compilerDependFileFull)) {
+    cmGeneratedFileStream depFileStream(
+      compilerDependFileFull, false,
+      this->GlobalGenerator->GetMakefileEncoding());
+    depFileStream << "# Empty compiler generated dependencies file for "
+                  << this->GeneratorTarget->GetName() << ".\n"
+                  << "# This may be replaced when dependencies are built.\n";
+  }
 
   // Open the flags file.  This should be copy-if-different because the
   // rules may depend on this file itself.
@@ -355,6 +392,17 @@ void cmMakefileTargetGenerator::WriteTargetLanguageFlags()
 
   bool const escapeOctothorpe = this->GlobalGenerator->CanEscapeOctothorpe();
 
+  // All build files of a non-recursive build are read by one make
+  // process, so limit the flags to the objects of this target.
+  std::string scope;
+  if (this->GlobalGenerator->IsNonRecursive()) {
+    scope = cmStrCat(
+      this->LocalGenerator->ConvertToMakefilePath(
+        this->LocalGenerator->GetRelativeTargetDirectory(
+          this->GeneratorTarget)),
+      "/%: ");
+  }
+
   for (std::string const& language : languages) {
     std::string defines = this->GetDefines(language, this->GetConfigName());
     std::string includes = this->GetIncludes(language, this->GetConfigName());
@@ -363,8 +411,10 @@ void cmMakefileTargetGenerator::WriteTargetLanguageFlags()
       cmSystemTools::ReplaceString(defines, "#", "\\#");
       cmSystemTools::ReplaceString(includes, "#", "\\#");
     }
-    *this->FlagFileStream << language << "_DEFINES = " << defines << "\n\n";
-    *this->FlagFileStream << language << "_INCLUDES = " << includes << "\n\n";
+    *this->FlagFileStream << scope << language << "_DEFINES = " << defines
+                          << "\n\n";
+    *this->FlagFileStream << scope << language << "_INCLUDES = " << includes
+                          << "\n\n";
 
     std::vector<std::string> architectures;
     this->GeneratorTarget->GetAppleArchs(this->GetConfigName(), architectures);
@@ -376,8 +426,8 @@ void cmMakefileTargetGenerator::WriteTargetLanguageFlags()
       if (escapeOctothorpe) {
         cmSystemTools::ReplaceString(flags, "#", "\\#");
       }
-      *this->FlagFileStream << language << "_FLAGS" << arch << " = " << flags
-                            << "\n\n";
+      *this->FlagFileStream << scope << language << "_FLAGS" << arch << " = "
+                            << flags << "\n\n";
     }
   }
 }
@@ -476,8 +526,16 @@ void cmMakefileTargetGenerator::WriteObjectRuleFiles(
   objFullPath = cmSystemTools::CollapseFullPath(objFullPath);
   std::string srcFullPath =
     cmSystemTools::CollapseFullPath(source.GetFullPath());
-  this->LocalGenerator->AddImplicitDepends(this->GeneratorTarget, lang,
-                                           objFullPath, srcFullPath);
+  std::string const depfileFlags = this->GetCompilerDependFlags(lang);
+  if (depfileFlags.empty()) {
+    this->LocalGenerator->AddImplicitDepends(this->GeneratorTarget, lang,
+                                             objFullPath, srcFullPath);
+  } else {
+    // The compiler writes the dependencies and cmake_depends merges them.
+    this->CompilerDependFiles.push_back(objFullPath);
+    this->CompilerDependFiles.push_back(objFullPath + ".d");
+    this->CleanFiles.insert(obj + ".d");
+  }
 
   this->LocalGenerator->AppendRuleDepend(depends,
                                          this->FlagFileNameFull.c_str());
@@ -519,8 +577,10 @@ void cmMakefileTargetGenerator::WriteObjectRuleFiles(
         depends.push_back(
           this->GeneratorTarget->GetPchFile(config, lang, arch));
       }
-      this->LocalGenerator->AddImplicitDepends(this->GeneratorTarget, lang,
-                                               objFullPath, pchHeader);
+      if (depfileFlags.empty()) {
+        this->LocalGenerator->AddImplicitDepends(this->GeneratorTarget, lang,
+                                                 objFullPath, pchHeader);
+      }
     }
   }
 
@@ -886,12 +946,30 @@ void cmMakefileTargetGenerator::WriteObjectRuleFiles(
       }
     }
 
+    // Add the flags to write the dependency file.  The exported compile
+    // command does not get them.
+    std::string compileFlags = flags;
+    if (!depfileFlags.empty()) {
+      std::string objectDepfileFlags = depfileFlags;
+      cmSystemTools::ReplaceString(
+        objectDepfileFlags, "<DEPFILE>",
+        this->LocalGenerator->ConvertToOutputFormat(
+          cmStrCat(obj, ".d"), cmOutputConverter::SHELL));
+      cmSystemTools::ReplaceString(objectDepfileFlags, "<OBJECT>", shellObj);
+      cmSystemTools::ReplaceString(
+        objectDepfileFlags, "<CMAKE_C_COMPILER>",
+        this->Makefile->GetSafeDefinition("CMAKE_C_COMPILER"));
+      this->LocalGenerator->AppendFlags(compileFlags, objectDepfileFlags);
+    }
+    vars.Flags = compileFlags.c_str();
+
     // Expand placeholders in the commands.
     for (std::string& compileCommand : compileCommands) {
       compileCommand = cmStrCat(launcher, compileCommand);
       rulePlaceholderExpander->ExpandRuleVariables(this->LocalGenerator,
                                                    compileCommand, vars);
     }
+    vars.Flags = flags.c_str();
 
     // Change the command working directory to the local build tree.
     this->LocalGenerator->CreateCDCommand(
@@ -916,6 +994,7 @@ void cmMakefileTargetGenerator::WriteObjectRuleFiles(
   // Write the rule.
   this->WriteMakeRule(*this->BuildFileStream, nullptr, outputs, depends,
                       commands);
+  this->AddOrderOnlyDepend(relativeObj, "depend");
 
   bool do_preprocess_rules = lang_has_preprocessor &&
     this->LocalGenerator->GetCreatePreprocessedSourceRules();
@@ -1168,6 +1247,34 @@ void cmMakefileTargetGenerator::WriteTargetDependRules()
     << "\")\n";
   /* clang-format on */
 
+  // A non-recursive build reads depend.make before the depend step
+  // updates it, so a dependee removed since must not stop the build.
+  if (this->GlobalGenerator->IsNonRecursive()) {
+    *this->InfoFileStream << "\n"
+                          << "# Write empty rules for all dependees.\n"
+                          << "set(CMAKE_DEPENDS_DEPENDEE_RULES 1)\n";
+  }
+
+  // Store the dependency files written by the compiler.
+  if (!this->CompilerDependFiles.empty()) {
+    *this->InfoFileStream
+      << "\n"
+      << "# Pairs of object files and the dependency files written for them "
+         "by the compiler.\n"
+      << "set(CMAKE_DEPENDS_DEPENDENCY_FILES\n";
+    for (std::size_t i = 0; i + 1 < this->CompilerDependFiles.size();
+         i += 2) {
+      *this->InfoFileStream
+        << "  "
+        << cmOutputConverter::EscapeForCMake(this->CompilerDependFiles[i])
+        << " "
+        << cmOutputConverter::EscapeForCMake(
+             this->CompilerDependFiles[i + 1])
+        << "\n";
+    }
+    *this->InfoFileStream << "  )\n";
+  }
+
   // and now write the rule to use it
   std::vector<std::string> depends;
   std::vector<std::string> commands;
@@ -1236,6 +1343,46 @@ void cmMakefileTargetGenerator::WriteTargetDependRules()
   // Write the rule.
   this->LocalGenerator->WriteMakeRule(*this->BuildFileStream, nullptr,
                                       depTarget, depends, commands, true);
+  this->AddOrderOnlyDepend(depTarget, "order");
+
+  // A non-recursive build reads compiler_depend.make before the depend
+  // step merges the dependency files of the last build.  Let make merge
+  // them first and restart while any of them exists.
+  if (this->GlobalGenerator->IsNonRecursive() &&
+      !this->CompilerDependFiles.empty()) {
+    *this->BuildFileStream
+      << "# Merge the dependency files written by the compiler.\n"
+      << this->CompilerDependFile << ": $(wildcard";
+    for (std::size_t i = 1; i < this->CompilerDependFiles.size(); i += 2) {
+      *this->BuildFileStream
+        << ' '
+        << this->LocalGenerator->ConvertToMakefilePath(
+             this->LocalGenerator->MaybeConvertToRelativePath(
+               this->LocalGenerator->GetBinaryDirectory(),
+               this->CompilerDependFiles[i]));
+    }
+    *this->BuildFileStream << ")\n\t" << depCmd.str() << "\n\n";
+  }
+}
+
+std::string cmMakefileTargetGenerator::GetCompilerDependFlags(
+  std::string const& lang) const
+{
+  // Only the languages scanned by cmDependsC may use the compiler.  The
+  // Fortran scanner also finds the modules provided by the objects.
+  if (this->CompilerDependFile.empty() ||
+      !(lang == "C" || lang == "CXX" || lang == "OBJC" || lang == "OBJCXX" ||
+        lang == "CUDA")) {
+    return std::string();
+  }
+  // The dependency files are read in the format of GCC.  Compilers that
+  // write another format, e.g. IAR, TI or ARMCC, keep using the scanner.
+  if (this->Makefile->GetSafeDefinition(
+        cmStrCat("CMAKE_", lang, "_DEPFILE_FORMAT")) != "gcc") {
+    return std::string();
+  }
+  return this->Makefile->GetSafeDefinition(
+    cmStrCat("CMAKE_DEPFILE_FLAGS_", lang));
 }
 
 void cmMakefileTargetGenerator::DriveCustomCommands(
@@ -1268,18 +1415,29 @@ void cmMakefileTargetGenerator::WriteObjectDependRules(
 void cmMakefileTargetGenerator::GenerateCustomRuleFile(
   cmCustomCommandGenerator const& ccg)
 {
+  // A non-recursive build may have only one rule for an output, so the
+  // first target listing it writes the rule for all of them.  The others
+  // still need the rule when their build file is read alone, e.g. for
+  // the "<target>/fast" and preprocessing rules.
+  const std::vector<std::string>& outputs = ccg.GetOutputs();
+  bool const copy = this->GlobalGenerator->IsNonRecursive() &&
+    !this->GlobalGenerator->ClaimCustomCommandOutput(
+      outputs[0], this->GetOrderOnlyDepend(outputs[0], "order"));
+
   // Collect the commands.
   std::vector<std::string> commands;
   std::string comment = this->LocalGenerator->ConstructComment(ccg);
   if (!comment.empty()) {
-    // add in a progress call if needed
-    this->NumberOfProgressActions++;
+    // add in a progress call if needed, the copy of a rule has none
+    if (!copy) {
+      this->NumberOfProgressActions++;
+    }
     if (!this->NoRuleMessages) {
       cmLocalUnixMakefileGenerator3::EchoProgress progress;
       this->MakeEchoProgress(progress);
       this->LocalGenerator->AppendEcho(
         commands, comment, cmLocalUnixMakefileGenerator3::EchoGenerate,
-        &progress);
+        copy ? nullptr : &progress);
     }
   }
 
@@ -1294,9 +1452,16 @@ void cmMakefileTargetGenerator::GenerateCustomRuleFile(
   this->LocalGenerator->AppendCustomDepend(depends, ccg);
 
   // Write the rule.
-  const std::vector<std::string>& outputs = ccg.GetOutputs();
+  if (copy) {
+    // Makefile2 defines this when it reads all build files.
+    *this->BuildFileStream << "ifndef CMAKE_MAKEFILE_NON_RECURSIVE\n";
+  }
   bool symbolic = this->WriteMakeRule(*this->BuildFileStream, nullptr, outputs,
                                       depends, commands);
+  if (copy) {
+    *this->BuildFileStream << "endif\n\n";
+    return;
+  }
 
   // If the rule has changed make sure the output is rebuilt.
   if (!symbolic) {
@@ -1320,18 +1485,45 @@ void cmMakefileTargetGenerator::MakeEchoProgress(
   progress.Dir =
     cmStrCat(this->LocalGenerator->GetBinaryDirectory(), "/CMakeFiles");
   std::ostringstream progressArg;
-  progressArg << "$(CMAKE_PROGRESS_" << this->NumberOfProgressActions << ")";
+  progressArg << "$(" << this->MakeVariablePrefix << "CMAKE_PROGRESS_"
+              << this->NumberOfProgressActions << ")";
   progress.Arg = progressArg.str();
 }
 
+std::string cmMakefileTargetGenerator::GetOrderOnlyDepend(
+  std::string const& output, const char* rule) const
+{
+  std::string const tgt = this->LocalGenerator->ConvertToMakefilePath(
+    this->LocalGenerator->MaybeConvertToRelativePath(
+      this->LocalGenerator->GetBinaryDirectory(), output));
+  std::string const dep = this->LocalGenerator->ConvertToMakefilePath(
+    cmStrCat(
+      this->LocalGenerator->GetRelativeTargetDirectory(this->GeneratorTarget),
+      '/', rule));
+  // Add a space before the ":" to avoid drive letter confusion on Windows.
+  return cmStrCat(tgt, tgt.size() == 1 ? " : | " : ": | ", dep, '\n');
+}
+
+void cmMakefileTargetGenerator::AddOrderOnlyDepend(std::string const& output,
+                                                   const char* rule)
+{
+  if (this->GlobalGenerator->IsNonRecursive()) {
+    this->NonRecursiveRules += this->GetOrderOnlyDepend(output, rule);
+  }
+}
+
 void cmMakefileTargetGenerator::WriteObjectsVariable(
   std::string& variableName, std::string& variableNameExternal,
   bool useWatcomQuote)
 {
   // Write a make variable assignment that lists all objects for the
   // target.
-  variableName = this->LocalGenerator->CreateMakeVariable(
-    this->GeneratorTarget->GetName(), "_OBJECTS");
+  if (this->MakeVariablePrefix.empty()) {
+    variableName = this->LocalGenerator->CreateMakeVariable(
+      this->GeneratorTarget->GetName(), "_OBJECTS");
+  } else {
+    variableName = cmStrCat(this->MakeVariablePrefix, "OBJECTS");
+  }
   *this->BuildFileStream << "# Object files for target "
                          << this->GeneratorTarget->GetName() << "\n"
                          << variableName << " =";
@@ -1358,8 +1550,13 @@ void cmMakefileTargetGenerator::WriteObjectsVariable(
 
   // Write a make variable assignment that lists all external objects
   // for the target.
-  variableNameExternal = this->LocalGenerator->CreateMakeVariable(
-    this->GeneratorTarget->GetName(), "_EXTERNAL_OBJECTS");
+  if (this->MakeVariablePrefix.empty()) {
+    variableNameExternal = this->LocalGenerator->CreateMakeVariable(
+      this->GeneratorTarget->GetName(), "_EXTERNAL_OBJECTS");
+  } else {
+    variableNameExternal =
+      cmStrCat(this->MakeVariablePrefix, "EXTERNAL_OBJECTS");
+  }
   /* clang-format off */
   *this->BuildFileStream
     << "\n"
@@ -1496,6 +1693,9 @@ void cmMakefileTargetGenerator::WriteTargetDriverRule(
   this->LocalGenerator->WriteMakeRule(*this->BuildFileStream, comment,
                                       buildTargetRuleName, depends,
                                       no_commands, true);
+  if (!relink) {
+    this->AddOrderOnlyDepend(main_output, "order");
+  }
 }
 
 void cmMakefileTargetGenerator::AppendTargetDepends(
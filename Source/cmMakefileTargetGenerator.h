@@ -54,6 +54,17 @@ public:
     return this->NumberOfProgressActions;
   }
   std::string GetProgressFileNameFull() { return this->ProgressFileNameFull; }
+  std::string GetMakeVariablePrefix() const
+  {
+    return this->MakeVariablePrefix;
+  }
+
+  /* return the rules Makefile2 adds after including the build file in a
+     non-recursive build */
+  std::string const& GetNonRecursiveRules() const
+  {
+    return this->NonRecursiveRules;
+  }
 
   cmGeneratorTarget* GetGeneratorTarget() { return this->GeneratorTarget; }
 
@@ -101,6 +112,10 @@ protected:
   // write the rules for an object
   void WriteObjectRuleFiles(cmSourceFile const& source);
 
+  // flags that make the compiler write the dependencies of an object,
+  // or nothing if they are scanned by cmake_depends
+  std::string GetCompilerDependFlags(std::string const& lang) const;
+
   // write the depend.make file for an object
   void WriteObjectDependRules(cmSourceFile const& source,
                               std::vector<std::string>& depends);
@@ -115,6 +130,11 @@ protected:
 
   void MakeEchoProgress(cmLocalUnixMakefileGenerator3::EchoProgress&) const;
 
+  // order a rule after a rule of this target in a non-recursive build
+  std::string GetOrderOnlyDepend(std::string const& output,
+                                 const char* rule) const;
+  void AddOrderOnlyDepend(std::string const& output, const char* rule);
+
   // write out the variable that lists the objects for this target
   void WriteObjectsVariable(std::string& variableName,
                             std::string& variableNameExternal,
@@ -194,6 +214,7 @@ protected:
 
   // the full path to the progress file
   std::string ProgressFileNameFull;
+  std::string MakeVariablePrefix;
   unsigned long NumberOfProgressActions;
   bool NoRuleMessages;
 
@@ -212,6 +233,10 @@ protected:
   };
   std::map<std::string, StringList> FlagFileDepends;
 
+  // the dependencies written by the compiler
+  std::string CompilerDependFile;
+  std::vector<std::string> CompilerDependFiles;
+
   // the stream for the info file
   std::string InfoFileNameFull;
   std::unique_ptr<cmGeneratedFileStream> InfoFileStream;
@@ -229,6 +254,9 @@ protected:
   // Set of extra output files to be driven by the build.
   std::set<std::string> ExtraFiles;
 
+  // Order-only prerequisites of a non-recursive build.
+  std::string NonRecursiveRules;
+
   using MultipleOutputPairsType = std::map<std::string, std::string>;
   MultipleOutputPairsType MultipleOutputPairs;
   bool WriteMakeRule(std::ostream& os, const char* comment,
@@ -72,17 +72,66 @@ cmNinjaTargetGenerator::cmNinjaTargetGenerator(cmGeneratorTarget* target)
   }
 }
 
-cmNinjaTargetGenerator::~cmNinjaTargetGenerator() = default;
+cmNinjaTargetGenerator::~cmNinjaTargetGenerator()
+{
+  for (auto const& stream : this->TargetFileStreams) {
+    this->GetGlobalGenerator()->ClearPooledVariables(*stream.second);
+  }
+}
 
 cmGeneratedFileStream& cmNinjaTargetGenerator::GetImplFileStream(
   const std::string& config) const
 {
-  return *this->GetGlobalGenerator()->GetImplFileStream(config);
+  cmGlobalNinjaGenerator* gg = this->GetGlobalGenerator();
+  return this->GetTargetFileStream(
+    *gg->GetImplFileStream(config),
+    gg->IsMultiConfig() ? cmStrCat("impl-", config, ".ninja")
+                        : std::string("build.ninja"));
 }
 
 cmGeneratedFileStream& cmNinjaTargetGenerator::GetCommonFileStream() const
 {
-  return *this->GetGlobalGenerator()->GetCommonFileStream();
+  cmGlobalNinjaGenerator* gg = this->GetGlobalGenerator();
+  return this->GetTargetFileStream(
+    *gg->GetCommonFileStream(),
+    gg->IsMultiConfig() ? "common.ninja" : "build.ninja");
+}
+
+cmGeneratedFileStream& cmNinjaTargetGenerator::GetTargetFileStream(
+  cmGeneratedFileStream& main, std::string const& name) const
+{
+  cmGlobalNinjaGenerator* gg = this->GetGlobalGenerator();
+  if (!gg->GetPerTargetFiles()) {
+    return main;
+  }
+
+  std::unique_ptr<cmGeneratedFileStream>& stream =
+    this->TargetFileStreams[&main];
+  if (!stream) {
+    std::string const dir = cmStrCat(
+      this->LocalGenerator->GetCurrentBinaryDirectory(), '/',
+      this->LocalGenerator->GetTargetDirectory(this->GeneratorTarget));
+    cmSystemTools::MakeDirectory(dir);
+    std::string const path = cmStrCat(dir, '/', name);
+    std::string const ninjaPath = this->ConvertToNinjaPath(path);
+
+    // Leave the file untouched if the target did not change so that it is
+    // obvious which targets were affected by a regeneration.  The file is
+    // an output of the regeneration, which then needs restat, or else it
+    // must be newer than the inputs like the main build files.
+    stream = cm::make_unique<cmGeneratedFileStream>(
+      path, false, gg->GetMakefileEncoding());
+    stream->SetCopyIfDifferent(gg->SupportsManifestRestat());
+    *stream << "# Build statements for target " << this->GetTargetName()
+            << "\n\n";
+    gg->AddPerTargetFile(ninjaPath);
+
+    cmGlobalNinjaGenerator::WriteSubninja(
+      main, gg->EncodePath(ninjaPath),
+      cmStrCat("Build statements for target ", this->GetTargetName()));
+    main << "\n";
+  }
+  return *stream;
 }
 
 cmGeneratedFileStream& cmNinjaTargetGenerator::GetRulesFileStream() const
@@ -1336,6 +1385,7 @@ void cmNinjaTargetGenerator::WriteObjectBuildStatement(
 
     this->addPoolNinjaVariable("JOB_POOL_COMPILE", this->GetGeneratorTarget(),
                                ppBuild.Variables);
+    this->PoolObjectVariables(ppBuild.Variables, language, config, fileConfig);
 
     this->GetGlobalGenerator()->WriteBuild(this->GetImplFileStream(fileConfig),
                                            ppBuild, commandLineLengthLimit);
@@ -1371,6 +1421,7 @@ void cmNinjaTargetGenerator::WriteObjectBuildStatement(
   if (language == "Swift") {
     this->EmitSwiftDependencyInfo(source, config);
   } else {
+    this->PoolObjectVariables(vars, language, config, fileConfig);
     this->GetGlobalGenerator()->WriteBuild(this->GetImplFileStream(fileConfig),
                                            objBuild, commandLineLengthLimit);
   }
@@ -1392,6 +1443,42 @@ void cmNinjaTargetGenerator::WriteObjectBuildStatement(
   }
 }
 
+void cmNinjaTargetGenerator::PoolObjectVariables(cmNinjaVars& vars,
+                                                 const std::string& language,
+                                                 const std::string& config,
+                                                 const std::string& fileConfig)
+{
+  // Shorter values are cheaper to repeat than to refer to.
+  std::string::size_type const minPooledLength = 32;
+
+  std::pair<const char*, std::string> const common[] = {
+    { "FLAGS", this->GetFlags(language, config) },
+    { "DEFINES", this->GetDefines(language, config) },
+    { "INCLUDES", this->GetIncludes(language, config) },
+  };
+  for (auto const& c : common) {
+    auto it = vars.find(c.first);
+    std::string const base = cmTrimWhitespace(c.second);
+    // A trailing '$' would escape the newline ending the variable.
+    if (it == vars.end() || base.size() < minPooledLength ||
+        base.back() == '$') {
+      continue;
+    }
+    // Source-specific flags are added before or after the common part.
+    std::string const value = cmTrimWhitespace(it->second);
+    std::string::size_type const pos = value.find(base);
+    std::string::size_type const end = pos + base.size();
+    if (pos == std::string::npos || (pos > 0 && value[pos - 1] != ' ') ||
+        (end < value.size() && value[end] != ' ')) {
+      continue;
+    }
+    std::string const& name = this->GetGlobalGenerator()->PoolVariable(
+      this->GetImplFileStream(fileConfig), c.first, base);
+    it->second =
+      cmStrCat(value.substr(0, pos), '$', name, value.substr(end));
+  }
+}
+
 void cmNinjaTargetGenerator::WriteTargetDependInfo(std::string const& lang,
                                                    const std::string& config)
 {
@@ -52,6 +52,11 @@ protected:
   cmGeneratedFileStream& GetCommonFileStream() const;
   cmGeneratedFileStream& GetRulesFileStream() const;
 
+  /// Return the target's own file standing in for the @a main build file
+  /// if CMAKE_NINJA_PER_TARGET_FILES is enabled and @a main otherwise.
+  cmGeneratedFileStream& GetTargetFileStream(cmGeneratedFileStream& main,
+                                             std::string const& name) const;
+
   cmGeneratorTarget* GetGeneratorTarget() const
   {
     return this->GeneratorTarget;
@@ -103,7 +108,7 @@ protected:
                               const std::string& language,
                               const std::string& config);
 
-  std::string ConvertToNinjaPath(const std::string& path) const
+  std::string const& ConvertToNinjaPath(const std::string& path) const
   {
     return this->GetGlobalGenerator()->ConvertToNinjaPath(path);
   }
@@ -199,6 +204,12 @@ protected:
   void addPoolNinjaVariable(const std::string& pool_property,
                             cmGeneratorTarget* target, cmNinjaVars& vars);
 
+  /// Refer to the target-wide part of the FLAGS, DEFINES and INCLUDES
+  /// variables of an object build statement through file-scope variables.
+  void PoolObjectVariables(cmNinjaVars& vars, const std::string& language,
+                           const std::string& config,
+                           const std::string& fileConfig);
+
   bool ForceResponseFile();
 
 private:
@@ -218,6 +229,11 @@ private:
   };
 
   std::map<std::string, ByConfig> Configs;
+
+  /// Files of this target by the build file they are included from.
+  mutable std::map<cmGeneratedFileStream const*,
+                   std::unique_ptr<cmGeneratedFileStream>>
+    TargetFileStreams;
 };
 
 #endif // ! cmNinjaTargetGenerator_h
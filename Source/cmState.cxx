@@ -491,6 +491,11 @@ void cmState::AddScriptedCommand(std::string const& name, Command command)
   this->ScriptedCommands[sName] = std::move(command);
 }
 
+bool cmState::IsScriptedCommand(std::string const& name) const
+{
+  return this->ScriptedCommands.find(name) != this->ScriptedCommands.end();
+}
+
 cmState::Command cmState::GetCommand(std::string const& name) const
 {
   return GetCommandByExactName(cmSystemTools::LowerCase(name));
@@ -626,6 +631,11 @@ bool cmState::GetGlobalPropertyAsBool(const std::string& prop)
   return cmIsOn(this->GetGlobalProperty(prop));
 }
 
+std::vector<std::string> cmState::GetGlobalPropertyKeys() const
+{
+  return this->GlobalProperties.GetKeys();
+}
+
 void cmState::SetSourceDirectory(std::string const& sourceDirectory)
 {
   this->SourceDirectory = sourceDirectory;
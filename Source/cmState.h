@@ -160,6 +160,8 @@ public:
                             cmPolicies::PolicyID policy, const char* message);
   void AddUnexpectedCommand(std::string const& name, const char* error);
   void AddScriptedCommand(std::string const& name, Command command);
+  // Returns whether a lower-case name refers to a function() or macro()
+  bool IsScriptedCommand(std::string const& name) const;
   void RemoveBuiltinCommand(std::string const& name);
   void RemoveUserDefinedCommands();
   std::vector<std::string> GetCommandNames() const;
@@ -169,6 +171,7 @@ public:
                             bool asString = false);
   cmProp GetGlobalProperty(const std::string& prop);
   bool GetGlobalPropertyAsBool(const std::string& prop);
+  std::vector<std::string> GetGlobalPropertyKeys() const;
 
   std::string const& GetSourceDirectory() const;
   void SetSourceDirectory(std::string const& sourceDirectory);
@@ -0,0 +1,322 @@
+/* Distributed under the OSI-approved BSD 3-Clause License.  See accompanying
+   file Copyright.txt or https://cmake.org/licensing for details.  */
+#include "cmStateDump.h"
+
+#include <algorithm>
+#include <map>
+#include <memory>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "cmsys/FStream.hxx"
+
+#include "cmGlobalGenerator.h"
+#include "cmMakefile.h"
+#include "cmProperty.h"
+#include "cmPropertyMap.h"
+#include "cmState.h"
+#include "cmStateDirectory.h"
+#include "cmStateSnapshot.h"
+#include "cmStateTypes.h"
+#include "cmStringAlgorithms.h"
+#include "cmTarget.h"
+#include "cmake.h"
+
+char const cmStateDump::Magic[8] = { 'C', 'M', 'K', 'S', 'T', 'A', 'T', 'E' };
+
+namespace {
+using Definitions = std::map<std::string, std::string>;
+
+// Properties that are not stored in the generic property maps.
+char const* const DirectoryProperties[] = {
+  "COMPILE_DEFINITIONS", "COMPILE_OPTIONS",   "INCLUDE_DIRECTORIES",
+  "LINK_DIRECTORIES",    "LINK_OPTIONS",
+};
+char const* const TargetProperties[] = {
+  "COMPILE_DEFINITIONS", "COMPILE_FEATURES",  "COMPILE_OPTIONS",
+  "C_STANDARD",          "CUDA_STANDARD",     "CXX_STANDARD",
+  "INCLUDE_DIRECTORIES", "LINK_DIRECTORIES",  "LINK_LIBRARIES",
+  "LINK_OPTIONS",        "OBJCXX_STANDARD",   "OBJC_STANDARD",
+  "PRECOMPILE_HEADERS",  "SOURCES",
+};
+
+void AppendU32(std::string& out, std::uint32_t v)
+{
+  for (int i = 0; i < 4; ++i) {
+    out += static_cast<char>((v >> (8 * i)) & 0xFF);
+  }
+}
+
+void AppendU64(std::string& out, std::uint64_t v)
+{
+  for (int i = 0; i < 8; ++i) {
+    out += static_cast<char>((v >> (8 * i)) & 0xFF);
+  }
+}
+
+class Builder
+{
+public:
+  std::uint32_t Intern(std::string const& str)
+  {
+    auto it = this->StringIndex.find(str);
+    if (it != this->StringIndex.end()) {
+      return it->second;
+    }
+    auto const index = static_cast<std::uint32_t>(this->StringOffsets.size());
+    this->StringOffsets.push_back(
+      static_cast<std::uint32_t>(this->StringBlob.size()));
+    this->StringBlob += str;
+    this->StringBlob += '\0';
+    this->StringIndex.emplace(str, index);
+    return index;
+  }
+
+  // Append the given name/value pairs and write { first, count } to out.
+  void AddPairs(std::string& out,
+                std::vector<std::pair<std::string, std::string>> const& pairs)
+  {
+    AppendU32(out, this->PairCount);
+    AppendU32(out, static_cast<std::uint32_t>(pairs.size()));
+    for (auto const& p : pairs) {
+      AppendU32(this->Pairs, this->Intern(p.first));
+      AppendU32(this->Pairs, this->Intern(p.second));
+    }
+    this->PairCount += static_cast<std::uint32_t>(pairs.size());
+  }
+
+  void AddDefinitions(std::string& out, Definitions const& defs,
+                      Definitions const* parent)
+  {
+    std::uint32_t count = 0;
+    AppendU32(out, this->PairCount);
+    for (auto const& def : defs) {
+      if (parent) {
+        auto it = parent->find(def.first);
+        if (it != parent->end() && it->second == def.second) {
+          continue;
+        }
+      }
+      AppendU32(this->Pairs, this->Intern(def.first));
+      AppendU32(this->Pairs, this->Intern(def.second));
+      ++count;
+    }
+    if (parent) {
+      for (auto const& def : *parent) {
+        if (defs.find(def.first) == defs.end()) {
+          AppendU32(this->Pairs, this->Intern(def.first));
+          AppendU32(this->Pairs, cmStateDump::None);
+          ++count;
+        }
+      }
+    }
+    AppendU32(out, count);
+    this->PairCount += count;
+  }
+
+  std::string Finish()
+  {
+    std::string strings;
+    this->StringOffsets.push_back(
+      static_cast<std::uint32_t>(this->StringBlob.size()));
+    for (std::uint32_t offset : this->StringOffsets) {
+      AppendU32(strings, offset);
+    }
+    strings += this->StringBlob;
+
+    struct SectionData
+    {
+      cmStateDump::Section Kind;
+      std::uint32_t Count;
+      std::string const* Data;
+    };
+    SectionData const sections[] = {
+      { cmStateDump::Section::Strings,
+        static_cast<std::uint32_t>(this->StringOffsets.size() - 1),
+        &strings },
+      { cmStateDump::Section::Pairs, this->PairCount, &this->Pairs },
+      { cmStateDump::Section::Cache, this->CacheCount, &this->Cache },
+      { cmStateDump::Section::GlobalProperties, 1, &this->Globals },
+      { cmStateDump::Section::Directories, this->DirectoryCount,
+        &this->Directories },
+      { cmStateDump::Section::Targets, this->TargetCount, &this->Targets },
+    };
+    std::uint32_t const sectionCount =
+      static_cast<std::uint32_t>(sizeof(sections) / sizeof(sections[0]));
+
+    std::string out(cmStateDump::Magic, sizeof(cmStateDump::Magic));
+    AppendU32(out, cmStateDump::Version);
+    AppendU32(out, sectionCount);
+    std::uint64_t offset = out.size() + sectionCount * 16;
+    for (SectionData const& section : sections) {
+      offset = (offset + 7) & ~std::uint64_t(7);
+      AppendU32(out, static_cast<std::uint32_t>(section.Kind));
+      AppendU32(out, section.Count);
+      AppendU64(out, offset);
+      offset += section.Data->size();
+    }
+    for (SectionData const& section : sections) {
+      out.resize((out.size() + 7) & ~std::size_t(7), '\0');
+      out += *section.Data;
+    }
+    return out;
+  }
+
+  std::string Cache;
+  std::uint32_t CacheCount = 0;
+  std::string Globals;
+  std::string Directories;
+  std::uint32_t DirectoryCount = 0;
+  std::string Targets;
+  std::uint32_t TargetCount = 0;
+
+private:
+  std::unordered_map<std::string, std::uint32_t> StringIndex;
+  std::vector<std::uint32_t> StringOffsets;
+  std::string StringBlob;
+  std::string Pairs;
+  std::uint32_t PairCount = 0;
+};
+
+template <typename Object, std::size_t N>
+std::vector<std::pair<std::string, std::string>> CollectProperties(
+  Object const& object, std::vector<std::string> keys,
+  char const* const (&special)[N])
+{
+  keys.insert(keys.end(), std::begin(special), std::end(special));
+  std::sort(keys.begin(), keys.end());
+  keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+
+  std::vector<std::pair<std::string, std::string>> props;
+  props.reserve(keys.size());
+  for (std::string const& key : keys) {
+    if (cmProp value = object.GetProperty(key)) {
+      props.emplace_back(key, *value);
+    }
+  }
+  return props;
+}
+
+void AddTarget(Builder& builder, cmTarget const& target)
+{
+  AppendU32(builder.Targets, builder.Intern(target.GetName()));
+  AppendU32(builder.Targets,
+            builder.Intern(cmState::GetTargetTypeName(target.GetType())));
+  builder.AddPairs(builder.Targets,
+                   CollectProperties(target, target.GetProperties().GetKeys(),
+                                     TargetProperties));
+  ++builder.TargetCount;
+}
+}
+
+bool cmStateDump::Write(cmake& cm, std::string const& path,
+                        std::string& error)
+{
+  cmGlobalGenerator* gg = cm.GetGlobalGenerator();
+  if (!gg) {
+    error = "the project has not been configured";
+    return false;
+  }
+  cmState* state = cm.GetState();
+  Builder builder;
+
+  for (std::string const& key : state->GetCacheEntryKeys()) {
+    cmProp value = state->GetCacheEntryValue(key);
+    std::vector<std::pair<std::string, std::string>> props;
+    for (std::string const& prop : state->GetCacheEntryPropertyList(key)) {
+      if (cmProp propValue = state->GetCacheEntryProperty(key, prop)) {
+        props.emplace_back(prop, *propValue);
+      }
+    }
+    AppendU32(builder.Cache, builder.Intern(key));
+    AppendU32(builder.Cache,
+              builder.Intern(cmState::CacheEntryTypeToString(
+                state->GetCacheEntryType(key))));
+    AppendU32(builder.Cache, builder.Intern(value ? *value : std::string()));
+    builder.AddPairs(builder.Cache, props);
+    ++builder.CacheCount;
+  }
+
+  std::vector<std::pair<std::string, std::string>> globals;
+  for (std::string const& key : state->GetGlobalPropertyKeys()) {
+    if (cmProp value = state->GetGlobalProperty(key)) {
+      globals.emplace_back(key, *value);
+    }
+  }
+  builder.AddPairs(builder.Globals, globals);
+
+  // Makefiles are created top-down, so a parent is always seen before its
+  // children and its definitions are available for computing the delta.
+  std::unordered_map<std::string, std::uint32_t> directoryIndex;
+  std::vector<Definitions> directoryDefinitions;
+  for (auto const& mf : gg->GetMakefiles()) {
+    cmStateSnapshot snapshot = mf->GetStateSnapshot();
+    cmStateDirectory directory = snapshot.GetDirectory();
+
+    std::uint32_t parent = cmStateDump::None;
+    cmStateSnapshot parentSnapshot = snapshot.GetBuildsystemDirectoryParent();
+    if (parentSnapshot.IsValid()) {
+      auto it = directoryIndex.find(
+        parentSnapshot.GetDirectory().GetCurrentBinary());
+      if (it != directoryIndex.end()) {
+        parent = it->second;
+      }
+    }
+
+    Definitions defs;
+    for (std::string const& key : snapshot.ClosureKeys()) {
+      if (std::string const* value = snapshot.GetDefinition(key)) {
+        defs.emplace(key, *value);
+      }
+    }
+
+    std::string& out = builder.Directories;
+    AppendU32(out, builder.Intern(directory.GetCurrentSource()));
+    AppendU32(out, builder.Intern(directory.GetCurrentBinary()));
+    AppendU32(out, parent);
+    builder.AddDefinitions(out, defs,
+                           parent == cmStateDump::None
+                             ? nullptr
+                             : &directoryDefinitions[parent]);
+    builder.AddPairs(out,
+                     CollectProperties(directory, directory.GetPropertyKeys(),
+                                       DirectoryProperties));
+
+    std::vector<cmTarget const*> targets;
+    for (auto const& t : mf->GetTargets()) {
+      targets.push_back(&t.second);
+    }
+    for (auto const& t : mf->GetOwnedImportedTargets()) {
+      targets.push_back(t.get());
+    }
+    std::sort(targets.begin(), targets.end(),
+              [](cmTarget const* l, cmTarget const* r) {
+                return l->GetName() < r->GetName();
+              });
+    AppendU32(out, builder.TargetCount);
+    AppendU32(out, static_cast<std::uint32_t>(targets.size()));
+    for (cmTarget const* target : targets) {
+      AddTarget(builder, *target);
+    }
+
+    directoryIndex.emplace(directory.GetCurrentBinary(),
+                           builder.DirectoryCount++);
+    directoryDefinitions.push_back(std::move(defs));
+  }
+
+  std::string const data = builder.Finish();
+  cmsys::ofstream fout(path.c_str(),
+                       std::ios::out | std::ios::binary | std::ios::trunc);
+  if (!fout) {
+    error = cmStrCat("Unable to open: ", path);
+    return false;
+  }
+  fout.write(data.data(), static_cast<std::streamsize>(data.size()));
+  fout.close();
+  if (!fout) {
+    error = cmStrCat("Unable to write: ", path);
+    return false;
+  }
+  return true;
+}
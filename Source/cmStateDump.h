@@ -0,0 +1,65 @@
+/* Distributed under the OSI-approved BSD 3-Clause License.  See accompanying
+   file Copyright.txt or https://cmake.org/licensing for details.  */
+#ifndef cmStateDump_h
+#define cmStateDump_h
+
+#include "cmConfigure.h" // IWYU pragma: keep
+
+#include <cstdint>
+#include <string>
+
+class cmake;
+
+/** \class cmStateDump
+ * \brief Write a binary snapshot of the configured state.
+ *
+ * The snapshot holds the cache, the global properties and, for every
+ * directory, its variable definitions, its properties and its targets.
+ * All strings are stored once in a string table and referenced by index,
+ * and the variables of a directory are stored as a delta to its parent.
+ *
+ * File layout (all integers little-endian, sections 8-byte aligned):
+ *
+ *   header:   "CMKSTATE", u32 version, u32 section count
+ *   sections: section count * { u32 kind, u32 count, u64 offset }
+ *
+ * followed by the section data described by cmStateDump::Section.  Since
+ * everything is addressed by offset the file can be memory-mapped and
+ * queried in place, see cmStateDumpReader.
+ */
+class cmStateDump
+{
+public:
+  static char const Magic[8];
+  static std::uint32_t const Version = 1;
+  // Index used for "no string" (removed definition) and "no parent".
+  static std::uint32_t const None = 0xFFFFFFFF;
+
+  enum class Section : std::uint32_t
+  {
+    // u32 offsets[count + 1] into a blob of NUL-terminated strings
+    // that immediately follows the offsets.
+    Strings = 1,
+    // { u32 name, u32 value } records referenced by the other sections.
+    Pairs = 2,
+    // { u32 key, u32 type, u32 value, u32 firstPair, u32 pairCount }
+    Cache = 3,
+    // A single { u32 firstPair, u32 pairCount } record.
+    GlobalProperties = 4,
+    // { u32 sourceDir, u32 binaryDir, u32 parent,
+    //   u32 firstDefinition, u32 definitionCount,
+    //   u32 firstProperty, u32 propertyCount,
+    //   u32 firstTarget, u32 targetCount }
+    // Definitions are the pairs that differ from the parent directory, a
+    // value of None marks a variable that is not defined in the directory.
+    Directories = 5,
+    // { u32 name, u32 type, u32 firstPair, u32 pairCount }
+    Targets = 6,
+  };
+
+  /** Write the state of the given cmake instance, which must have been
+      configured.  Returns false and sets the error on failure.  */
+  static bool Write(cmake& cm, std::string const& path, std::string& error);
+};
+
+#endif
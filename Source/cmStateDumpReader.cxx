@@ -0,0 +1,318 @@
+/* Distributed under the OSI-approved BSD 3-Clause License.  See accompanying
+   file Copyright.txt or https://cmake.org/licensing for details.  */
+#include "cmStateDumpReader.h"
+
+#include <cstring>
+#include <iterator>
+
+#include "cmsys/FStream.hxx"
+
+#include "cmStateDump.h"
+#include "cmStringAlgorithms.h"
+
+namespace {
+// Record sizes in bytes.
+std::size_t const SectionEntrySize = 16;
+std::size_t const PairSize = 8;
+std::size_t const CacheSize = 20;
+std::size_t const GlobalsSize = 8;
+std::size_t const DirectorySize = 36;
+std::size_t const TargetSize = 16;
+
+std::size_t const HeaderSize = sizeof(cmStateDump::Magic) + 8;
+}
+
+std::uint32_t cmStateDumpReader::ReadU32(std::size_t offset) const
+{
+  auto const* p = reinterpret_cast<unsigned char const*>(&this->Data[offset]);
+  return static_cast<std::uint32_t>(p[0]) |
+    (static_cast<std::uint32_t>(p[1]) << 8) |
+    (static_cast<std::uint32_t>(p[2]) << 16) |
+    (static_cast<std::uint32_t>(p[3]) << 24);
+}
+
+cm::string_view cmStateDumpReader::GetString(std::uint32_t index) const
+{
+  std::size_t const offsets = this->StringsOffset;
+  std::size_t const blob = offsets + (this->StringCount + 1) * 4;
+  std::uint32_t const begin = this->ReadU32(offsets + index * 4);
+  std::uint32_t const end = this->ReadU32(offsets + (index + 1) * 4);
+  // Drop the NUL terminator.
+  return cm::string_view(&this->Data[blob + begin], end - begin - 1);
+}
+
+std::vector<cmStateDumpReader::Pair> cmStateDumpReader::GetPairs(
+  std::size_t recordOffset) const
+{
+  std::uint32_t const first = this->ReadU32(recordOffset);
+  std::uint32_t const count = this->ReadU32(recordOffset + 4);
+  std::vector<Pair> pairs;
+  pairs.reserve(count);
+  for (std::uint32_t i = 0; i < count; ++i) {
+    std::size_t const offset = this->PairsOffset + (first + i) * PairSize;
+    Pair pair;
+    pair.Name = this->GetString(this->ReadU32(offset));
+    std::uint32_t const value = this->ReadU32(offset + 4);
+    if (value != cmStateDump::None) {
+      pair.Value = this->GetString(value);
+    }
+    pairs.push_back(pair);
+  }
+  return pairs;
+}
+
+bool cmStateDumpReader::Load(std::string const& path, std::string& error)
+{
+  cmsys::ifstream fin(path.c_str(), std::ios::in | std::ios::binary);
+  if (!fin) {
+    error = cmStrCat("Unable to open: ", path);
+    return false;
+  }
+  this->Data.assign(std::istreambuf_iterator<char>(fin),
+                    std::istreambuf_iterator<char>());
+  if (fin.bad()) {
+    error = cmStrCat("Unable to read: ", path);
+    return false;
+  }
+  if (!this->Validate(error)) {
+    error = cmStrCat(path, ": ", error);
+    return false;
+  }
+  return true;
+}
+
+bool cmStateDumpReader::Validate(std::string& error)
+{
+  std::size_t const size = this->Data.size();
+  if (size < HeaderSize ||
+      std::memcmp(this->Data.data(), cmStateDump::Magic,
+                  sizeof(cmStateDump::Magic)) != 0) {
+    error = "not a CMake state snapshot";
+    return false;
+  }
+  std::uint32_t const version = this->ReadU32(sizeof(cmStateDump::Magic));
+  if (version != cmStateDump::Version) {
+    error = cmStrCat("unsupported snapshot version ", version);
+    return false;
+  }
+  std::uint32_t const sectionCount =
+    this->ReadU32(sizeof(cmStateDump::Magic) + 4);
+  if (sectionCount > (size - HeaderSize) / SectionEntrySize) {
+    error = "truncated section table";
+    return false;
+  }
+
+  // Locate the sections and check that their records fit into the file.
+  std::size_t globalsCount = 0;
+  bool haveStrings = false;
+  for (std::uint32_t i = 0; i < sectionCount; ++i) {
+    std::size_t const entry = HeaderSize + i * SectionEntrySize;
+    std::uint32_t const kind = this->ReadU32(entry);
+    std::size_t const count = this->ReadU32(entry + 4);
+    std::uint64_t const offset = this->ReadU32(entry + 8) |
+      (static_cast<std::uint64_t>(this->ReadU32(entry + 12)) << 32);
+    if (offset > size) {
+      error = "section offset out of range";
+      return false;
+    }
+    std::size_t const available = size - static_cast<std::size_t>(offset);
+    std::size_t recordSize = 0;
+    switch (static_cast<cmStateDump::Section>(kind)) {
+      case cmStateDump::Section::Strings:
+        this->StringsOffset = static_cast<std::size_t>(offset);
+        this->StringCount = count;
+        haveStrings = true;
+        recordSize = 4;
+        break;
+      case cmStateDump::Section::Pairs:
+        this->PairsOffset = static_cast<std::size_t>(offset);
+        this->PairCount = count;
+        recordSize = PairSize;
+        break;
+      case cmStateDump::Section::Cache:
+        this->CacheOffset = static_cast<std::size_t>(offset);
+        this->CacheCount = count;
+        recordSize = CacheSize;
+        break;
+      case cmStateDump::Section::GlobalProperties:
+        this->GlobalsOffset = static_cast<std::size_t>(offset);
+        globalsCount = count;
+        recordSize = GlobalsSize;
+        break;
+      case cmStateDump::Section::Directories:
+        this->DirectoriesOffset = static_cast<std::size_t>(offset);
+        this->DirectoryCount = count;
+        recordSize = DirectorySize;
+        break;
+      case cmStateDump::Section::Targets:
+        this->TargetsOffset = static_cast<std::size_t>(offset);
+        this->TargetCount = count;
+        recordSize = TargetSize;
+        break;
+      default:
+        // Unknown sections are skipped for forward compatibility.
+        continue;
+    }
+    // The string table has one more offset than strings.
+    std::size_t const records =
+      kind == static_cast<std::uint32_t>(cmStateDump::Section::Strings)
+      ? count + 1
+      : count;
+    if (records > available / recordSize) {
+      error = "section exceeds file size";
+      return false;
+    }
+  }
+  if (!haveStrings || globalsCount > 1) {
+    error = "malformed section table";
+    return false;
+  }
+
+  // Check the string table.
+  std::size_t const blob = this->StringsOffset + (this->StringCount + 1) * 4;
+  std::uint32_t previous = 0;
+  for (std::size_t i = 0; i <= this->StringCount; ++i) {
+    std::uint32_t const offset = this->ReadU32(this->StringsOffset + i * 4);
+    if ((i == 0 && offset != 0) || (i > 0 && offset <= previous) ||
+        offset > size - blob || (i > 0 && this->Data[blob + offset - 1])) {
+      error = "malformed string table";
+      return false;
+    }
+    previous = offset;
+  }
+
+  auto validString = [this](std::uint32_t index) {
+    return index < this->StringCount;
+  };
+  auto validRange = [](std::uint32_t first, std::uint32_t count,
+                       std::size_t total) {
+    return first <= total && count <= total - first;
+  };
+
+  for (std::size_t i = 0; i < this->PairCount; ++i) {
+    std::size_t const offset = this->PairsOffset + i * PairSize;
+    std::uint32_t const value = this->ReadU32(offset + 4);
+    if (!validString(this->ReadU32(offset)) ||
+        (value != cmStateDump::None && !validString(value))) {
+      error = "malformed property table";
+      return false;
+    }
+  }
+  for (std::size_t i = 0; i < this->CacheCount; ++i) {
+    std::size_t const offset = this->CacheOffset + i * CacheSize;
+    if (!validString(this->ReadU32(offset)) ||
+        !validString(this->ReadU32(offset + 4)) ||
+        !validString(this->ReadU32(offset + 8)) ||
+        !validRange(this->ReadU32(offset + 12), this->ReadU32(offset + 16),
+                    this->PairCount)) {
+      error = "malformed cache entry";
+      return false;
+    }
+  }
+  if (globalsCount == 1 &&
+      !validRange(this->ReadU32(this->GlobalsOffset),
+                  this->ReadU32(this->GlobalsOffset + 4), this->PairCount)) {
+    error = "malformed global properties";
+    return false;
+  }
+  if (globalsCount == 0) {
+    this->GlobalsOffset = 0;
+  }
+  for (std::size_t i = 0; i < this->DirectoryCount; ++i) {
+    std::size_t const offset = this->DirectoriesOffset + i * DirectorySize;
+    std::uint32_t const parent = this->ReadU32(offset + 8);
+    if (!validString(this->ReadU32(offset)) ||
+        !validString(this->ReadU32(offset + 4)) ||
+        (parent != cmStateDump::None && parent >= i) ||
+        !validRange(this->ReadU32(offset + 12), this->ReadU32(offset + 16),
+                    this->PairCount) ||
+        !validRange(this->ReadU32(offset + 20), this->ReadU32(offset + 24),
+                    this->PairCount) ||
+        !validRange(this->ReadU32(offset + 28), this->ReadU32(offset + 32),
+                    this->TargetCount)) {
+      error = "malformed directory";
+      return false;
+    }
+  }
+  for (std::size_t i = 0; i < this->TargetCount; ++i) {
+    std::size_t const offset = this->TargetsOffset + i * TargetSize;
+    if (!validString(this->ReadU32(offset)) ||
+        !validString(this->ReadU32(offset + 4)) ||
+        !validRange(this->ReadU32(offset + 8), this->ReadU32(offset + 12),
+                    this->PairCount)) {
+      error = "malformed target";
+      return false;
+    }
+  }
+  return true;
+}
+
+cmStateDumpReader::CacheEntry cmStateDumpReader::GetCacheEntry(
+  std::size_t index) const
+{
+  std::size_t const offset = this->CacheOffset + index * CacheSize;
+  CacheEntry entry;
+  entry.Key = this->GetString(this->ReadU32(offset));
+  entry.Type = this->GetString(this->ReadU32(offset + 4));
+  entry.Value = this->GetString(this->ReadU32(offset + 8));
+  entry.Properties = this->GetPairs(offset + 12);
+  return entry;
+}
+
+std::vector<cmStateDumpReader::Pair> cmStateDumpReader::GetGlobalProperties()
+  const
+{
+  if (this->GlobalsOffset == 0) {
+    return std::vector<Pair>();
+  }
+  return this->GetPairs(this->GlobalsOffset);
+}
+
+cmStateDumpReader::Directory cmStateDumpReader::GetDirectory(
+  std::size_t index) const
+{
+  std::size_t const offset = this->DirectoriesOffset + index * DirectorySize;
+  Directory dir;
+  dir.SourceDirectory = this->GetString(this->ReadU32(offset));
+  dir.BinaryDirectory = this->GetString(this->ReadU32(offset + 4));
+  std::uint32_t const parent = this->ReadU32(offset + 8);
+  dir.Parent = parent == cmStateDump::None ? npos : parent;
+  dir.DefinitionChanges = this->GetPairs(offset + 12);
+  dir.Properties = this->GetPairs(offset + 20);
+  dir.FirstTarget = this->ReadU32(offset + 28);
+  dir.TargetCount = this->ReadU32(offset + 32);
+  return dir;
+}
+
+std::map<cm::string_view, cm::string_view> cmStateDumpReader::GetDefinitions(
+  std::size_t directory) const
+{
+  // Apply the changes from the top-level directory downwards.
+  std::vector<std::size_t> chain;
+  std::uint32_t index = static_cast<std::uint32_t>(directory);
+  while (index != cmStateDump::None) {
+    chain.push_back(index);
+    index = this->ReadU32(this->DirectoriesOffset + index * DirectorySize + 8);
+  }
+  std::map<cm::string_view, cm::string_view> defs;
+  for (auto it = chain.rbegin(); it != chain.rend(); ++it) {
+    for (Pair const& p : this->GetDirectory(*it).DefinitionChanges) {
+      if (p.Value) {
+        defs[p.Name] = *p.Value;
+      } else {
+        defs.erase(p.Name);
+      }
+    }
+  }
+  return defs;
+}
+
+cmStateDumpReader::Target cmStateDumpReader::GetTarget(std::size_t index) const
+{
+  std::size_t const offset = this->TargetsOffset + index * TargetSize;
+  Target target;
+  target.Name = this->GetString(this->ReadU32(offset));
+  target.Type = this->GetString(this->ReadU32(offset + 4));
+  target.Properties = this->GetPairs(offset + 8);
+  return target;
+}
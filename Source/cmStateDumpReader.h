@@ -0,0 +1,104 @@
+/* Distributed under the OSI-approved BSD 3-Clause License.  See accompanying
+   file Copyright.txt or https://cmake.org/licensing for details.  */
+#ifndef cmStateDumpReader_h
+#define cmStateDumpReader_h
+
+#include "cmConfigure.h" // IWYU pragma: keep
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <cm/optional>
+#include <cm/string_view>
+
+/** \class cmStateDumpReader
+ * \brief Query a state snapshot written by cmStateDump.
+ *
+ * The file is read into memory once and validated.  All accessors decode
+ * records in place and return views into that buffer, so they stay valid
+ * as long as the reader is alive.
+ */
+class cmStateDumpReader
+{
+public:
+  struct Pair
+  {
+    cm::string_view Name;
+    // Not set for a variable that is not defined in a directory.
+    cm::optional<cm::string_view> Value;
+  };
+
+  struct CacheEntry
+  {
+    cm::string_view Key;
+    cm::string_view Type;
+    cm::string_view Value;
+    std::vector<Pair> Properties;
+  };
+
+  struct Target
+  {
+    cm::string_view Name;
+    cm::string_view Type;
+    std::vector<Pair> Properties;
+  };
+
+  struct Directory
+  {
+    cm::string_view SourceDirectory;
+    cm::string_view BinaryDirectory;
+    // Index of the parent directory, or npos for the top-level directory.
+    std::size_t Parent;
+    // Definitions differing from the parent directory.
+    std::vector<Pair> DefinitionChanges;
+    std::vector<Pair> Properties;
+    std::size_t FirstTarget;
+    std::size_t TargetCount;
+  };
+
+  static std::size_t const npos = static_cast<std::size_t>(-1);
+
+  /** Load and validate a file.  Returns false and sets the error if the
+      file cannot be read or is not a valid state snapshot.  */
+  bool Load(std::string const& path, std::string& error);
+
+  std::size_t GetCacheEntryCount() const { return this->CacheCount; }
+  CacheEntry GetCacheEntry(std::size_t index) const;
+
+  std::vector<Pair> GetGlobalProperties() const;
+
+  std::size_t GetDirectoryCount() const { return this->DirectoryCount; }
+  Directory GetDirectory(std::size_t index) const;
+
+  /** All variables visible at the end of a directory, resolved through
+      its parents.  */
+  std::map<cm::string_view, cm::string_view> GetDefinitions(
+    std::size_t directory) const;
+
+  std::size_t GetTargetCount() const { return this->TargetCount; }
+  Target GetTarget(std::size_t index) const;
+
+private:
+  std::uint32_t ReadU32(std::size_t offset) const;
+  cm::string_view GetString(std::uint32_t index) const;
+  std::vector<Pair> GetPairs(std::size_t recordOffset) const;
+  bool Validate(std::string& error);
+
+  std::string Data;
+  std::size_t StringsOffset = 0;
+  std::size_t StringCount = 0;
+  std::size_t PairsOffset = 0;
+  std::size_t PairCount = 0;
+  std::size_t CacheOffset = 0;
+  std::size_t CacheCount = 0;
+  std::size_t GlobalsOffset = 0;
+  std::size_t DirectoriesOffset = 0;
+  std::size_t DirectoryCount = 0;
+  std::size_t TargetsOffset = 0;
+  std::size_t TargetCount = 0;
+};
+
+#endif
@@ -0,0 +1,187 @@
+/* Distributed under the OSI-approved BSD 3-Clause License.  See accompanying
+   file Copyright.txt or https://cmake.org/licensing for details.  */
+#include "cmTraceWriter.h"
+
+#include <ostream>
+#include <sstream>
+#include <utility>
+
+#if !defined(CMAKE_BOOTSTRAP)
+#  include <chrono>
+#  include <memory>
+
+#  include <cm3p/json/value.h>
+#  include <cm3p/json/writer.h>
+#else
+namespace Json {
+class StreamWriter;
+}
+#endif
+
+namespace {
+#if !defined(CMAKE_BOOTSTRAP)
+// Number of pending records that wakes up the writer thread.
+std::size_t const BatchSize = 1024;
+// Number of pending records at which the configure thread waits for the
+// writer thread.
+std::size_t const MaxPending = 64 * BatchSize;
+// Size at which formatted output is handed to the stream.
+std::size_t const BufferSize = 1 << 20;
+#endif
+
+void AppendRecord(std::string& out, cmTraceWriter::Record const& record,
+                  cmake::TraceFormat format, Json::StreamWriter* jsonWriter)
+{
+  if (!record.Literal.empty()) {
+    out += record.Literal;
+    return;
+  }
+
+  switch (format) {
+    case cmake::TraceFormat::TRACE_JSON_V1: {
+#if !defined(CMAKE_BOOTSTRAP)
+      Json::Value val;
+      val["file"] = record.File;
+      val["line"] = static_cast<Json::Value::Int64>(record.Line);
+      val["cmd"] = record.Command;
+      val["args"] = Json::Value(Json::arrayValue);
+      for (std::string const& arg : record.Args) {
+        val["args"].append(arg);
+      }
+      val["time"] = record.Time;
+      val["frame"] = static_cast<Json::Value::UInt64>(record.Frame);
+      std::ostringstream os;
+      jsonWriter->write(val, &os);
+      out += os.str();
+#else
+      static_cast<void>(jsonWriter);
+#endif
+      break;
+    }
+    case cmake::TraceFormat::TRACE_HUMAN:
+      out += record.File;
+      out += '(';
+      out += std::to_string(record.Line);
+      out += "):  ";
+      out += record.Command;
+      out += '(';
+      for (std::string const& arg : record.Args) {
+        out += arg;
+        out += ' ';
+      }
+      out += ')';
+      break;
+    case cmake::TraceFormat::TRACE_UNDEFINED:
+      out += "INTERNAL ERROR: Trace format is TRACE_UNDEFINED";
+      break;
+  }
+}
+
+#if !defined(CMAKE_BOOTSTRAP)
+std::unique_ptr<Json::StreamWriter> CreateJsonWriter()
+{
+  Json::StreamWriterBuilder builder;
+  builder["indentation"] = "";
+  return std::unique_ptr<Json::StreamWriter>(builder.newStreamWriter());
+}
+#endif
+}
+
+cmTraceWriter::cmTraceWriter(std::ostream& os, cmake::TraceFormat format)
+  : Stream(os)
+  , TraceFormat(format)
+{
+#if !defined(CMAKE_BOOTSTRAP)
+  this->Thread = std::thread(&cmTraceWriter::Run, this);
+#endif
+}
+
+cmTraceWriter::~cmTraceWriter()
+{
+#if !defined(CMAKE_BOOTSTRAP)
+  {
+    std::lock_guard<std::mutex> lock(this->Mutex);
+    this->Stop = true;
+  }
+  this->Wakeup.notify_one();
+  this->Thread.join();
+#endif
+  this->Stream.flush();
+}
+
+void cmTraceWriter::Write(Record record)
+{
+#if !defined(CMAKE_BOOTSTRAP)
+  bool wakeup;
+  {
+    std::unique_lock<std::mutex> lock(this->Mutex);
+    this->Drained.wait(
+      lock, [this] { return this->Pending.size() < MaxPending; });
+    this->Pending.push_back(std::move(record));
+    wakeup = this->Pending.size() == BatchSize;
+  }
+  if (wakeup) {
+    this->Wakeup.notify_one();
+  }
+#else
+  std::string out;
+  AppendRecord(out, record, this->TraceFormat, nullptr);
+  this->Stream << out << '\n';
+#endif
+}
+
+std::string cmTraceWriter::Format(Record const& record,
+                                  cmake::TraceFormat format)
+{
+  std::string out;
+#if !defined(CMAKE_BOOTSTRAP)
+  auto jsonWriter = CreateJsonWriter();
+  AppendRecord(out, record, format, jsonWriter.get());
+#else
+  AppendRecord(out, record, format, nullptr);
+#endif
+  return out;
+}
+
+#if !defined(CMAKE_BOOTSTRAP)
+void cmTraceWriter::Run()
+{
+  auto jsonWriter = CreateJsonWriter();
+  std::vector<Record> batch;
+  std::string buffer;
+  buffer.reserve(BufferSize);
+
+  std::unique_lock<std::mutex> lock(this->Mutex);
+  for (;;) {
+    // Also wake up periodically so that the output does not lag behind
+    // for long while the configure thread is busy, e.g. in try_compile.
+    this->Wakeup.wait_for(lock, std::chrono::milliseconds(100), [this] {
+      return this->Stop || this->Pending.size() >= BatchSize;
+    });
+    if (this->Pending.empty()) {
+      if (this->Stop) {
+        break;
+      }
+      continue;
+    }
+    batch.swap(this->Pending);
+    lock.unlock();
+    this->Drained.notify_one();
+
+    for (Record const& record : batch) {
+      AppendRecord(buffer, record, this->TraceFormat, jsonWriter.get());
+      buffer += '\n';
+      if (buffer.size() >= BufferSize) {
+        this->Stream.write(buffer.data(), buffer.size());
+        buffer.clear();
+      }
+    }
+    this->Stream.write(buffer.data(), buffer.size());
+    this->Stream.flush();
+    buffer.clear();
+    batch.clear();
+
+    lock.lock();
+  }
+}
+#endif
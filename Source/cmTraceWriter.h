@@ -0,0 +1,77 @@
+/* Distributed under the OSI-approved BSD 3-Clause License.  See accompanying
+   file Copyright.txt or https://cmake.org/licensing for details.  */
+#ifndef cmTraceWriter_h
+#define cmTraceWriter_h
+
+#include "cmConfigure.h" // IWYU pragma: keep
+
+#include <cstddef>
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+#if !defined(CMAKE_BOOTSTRAP)
+#  include <condition_variable>
+#  include <mutex>
+#  include <thread>
+#endif
+
+#include "cmake.h"
+
+/** \class cmTraceWriter
+ * \brief Serialize --trace output to a file off the configure thread.
+ *
+ * The configure thread only captures the data of each traced command and
+ * appends it to a pending batch.  A background thread takes whole batches,
+ * formats them in the requested trace format and writes them to the
+ * stream with large buffered writes.  If the writer falls behind, e.g. on
+ * a slow disk, the configure thread waits for it once a bounded number of
+ * records is pending.  Without threading support (i.e.
+ * during bootstrap) records are formatted and written synchronously.
+ */
+class cmTraceWriter
+{
+public:
+  struct Record
+  {
+    // If set, the line is written as-is and the other members are ignored.
+    std::string Literal;
+
+    std::string File;
+    long Line = 0;
+    std::string Command;
+    std::vector<std::string> Args;
+    double Time = 0;
+    std::size_t Frame = 0;
+  };
+
+  cmTraceWriter(std::ostream& os, cmake::TraceFormat format);
+  ~cmTraceWriter();
+
+  cmTraceWriter(cmTraceWriter const&) = delete;
+  cmTraceWriter& operator=(cmTraceWriter const&) = delete;
+
+  /** Queue a record to be written.  Blocks while too many records are
+      pending.  */
+  void Write(Record record);
+
+  /** Format a single record, without trailing newline.  */
+  static std::string Format(Record const& record, cmake::TraceFormat format);
+
+private:
+  std::ostream& Stream;
+  cmake::TraceFormat TraceFormat;
+
+#if !defined(CMAKE_BOOTSTRAP)
+  void Run();
+
+  std::mutex Mutex;
+  std::condition_variable Wakeup;
+  std::condition_variable Drained;
+  std::vector<Record> Pending;
+  bool Stop = false;
+  std::thread Thread;
+#endif
+};
+
+#endif
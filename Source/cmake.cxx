@@ -50,6 +50,7 @@
 #include "cmSystemTools.h"
 #include "cmTarget.h"
 #include "cmTargetLinkLibraryType.h"
+#include "cmTraceWriter.h"
 #include "cmUtils.hxx"
 #include "cmVersionConfig.h"
 #include "cmWorkingDirectory.h"
@@ -61,6 +62,7 @@
 
 #  include "cmFileAPI.h"
 #  include "cmGraphVizWriter.h"
+#  include "cmStateDump.h"
 #  include "cmVariableWatch.h"
 #endif
 
@@ -709,6 +711,15 @@ void cmake::SetArgs(const std::vector<std::string>& args)
         cmSystemTools::Error("No file specified for --graphviz");
         return;
       }
+    } else if (cmHasLiteralPrefix(arg, "--dump-state=")) {
+#if !defined(CMAKE_BOOTSTRAP)
+      std::string path = arg.substr(strlen("--dump-state="));
+      if (path.empty()) {
+        cmSystemTools::Error("No file specified for --dump-state");
+        return;
+      }
+      this->StateDumpFile = cmSystemTools::CollapseFullPath(path);
+#endif
     } else if (cmHasLiteralPrefix(arg, "--debug-trycompile")) {
       std::cout << "debug trycompile on\n";
       this->DebugTryCompileOn();
@@ -876,19 +887,22 @@ void cmake::SetArgs(const std::vector<std::string>& args)
         "--profiling-format specified but no --profiling-output!");
       return;
     }
+    cmMakefileProfilingData::Format format;
     if (profilingFormat == "google-trace"_s) {
-      try {
-        this->ProfilingOutput =
-          cm::make_unique<cmMakefileProfilingData>(profilingOutput);
-      } catch (std::runtime_error& e) {
-        cmSystemTools::Error(
-          cmStrCat("Could not start profiling: ", e.what()));
-        return;
-      }
+      format = cmMakefileProfilingData::Format::GoogleTrace;
+    } else if (profilingFormat == "summary"_s) {
+      format = cmMakefileProfilingData::Format::Summary;
     } else {
       cmSystemTools::Error("Invalid format specified for --profiling-format");
       return;
     }
+    try {
+      this->ProfilingOutput = cm::make_unique<cmMakefileProfilingData>(
+        profilingOutput, format, this->State.get());
+    } catch (std::runtime_error& e) {
+      cmSystemTools::Error(cmStrCat("Could not start profiling: ", e.what()));
+      return;
+    }
   }
 #endif
 
@@ -948,8 +962,18 @@ cmake::TraceFormat cmake::StringToTraceFormat(const std::string& traceStr)
   return (it != levels.cend()) ? it->second : TraceFormat::TRACE_UNDEFINED;
 }
 
+cmTraceWriter* cmake::GetTraceWriter()
+{
+  if (!this->TraceWriter && this->TraceFile) {
+    this->TraceWriter = cm::make_unique<cmTraceWriter>(this->TraceFile,
+                                                       this->GetTraceFormat());
+  }
+  return this->TraceWriter.get();
+}
+
 void cmake::SetTraceFile(const std::string& file)
 {
+  this->TraceWriter.reset();
   this->TraceFile.close();
   this->TraceFile.open(file.c_str());
   if (!this->TraceFile) {
@@ -996,9 +1020,10 @@ void cmake::PrintTraceFormatVersion()
     return;
   }
 
-  auto& f = this->GetTraceFile();
-  if (f) {
-    f << msg << '\n';
+  if (cmTraceWriter* writer = this->GetTraceWriter()) {
+    cmTraceWriter::Record record;
+    record.Literal = std::move(msg);
+    writer->Write(std::move(record));
   } else {
     cmSystemTools::Message(msg);
   }
@@ -1892,14 +1917,32 @@ int cmake::Generate()
   if (!this->GlobalGenerator) {
     return -1;
   }
-  if (!this->GlobalGenerator->Compute()) {
-    return -1;
+  {
+#if !defined(CMAKE_BOOTSTRAP)
+    auto profilingEntry = this->CreateProfilingEntry("generate", "Compute");
+#endif
+    if (!this->GlobalGenerator->Compute()) {
+      return -1;
+    }
+  }
+  {
+#if !defined(CMAKE_BOOTSTRAP)
+    auto profilingEntry = this->CreateProfilingEntry("generate", "Generate");
+#endif
+    this->GlobalGenerator->Generate();
   }
-  this->GlobalGenerator->Generate();
   if (!this->GraphVizFile.empty()) {
     std::cout << "Generate graphviz: " << this->GraphVizFile << std::endl;
     this->GenerateGraphViz(this->GraphVizFile);
   }
+#if !defined(CMAKE_BOOTSTRAP)
+  if (!this->StateDumpFile.empty()) {
+    std::string error;
+    if (!cmStateDump::Write(*this, this->StateDumpFile, error)) {
+      cmSystemTools::Error(cmStrCat("Could not dump state: ", error));
+    }
+  }
+#endif
   if (this->WarnUnusedCli) {
     this->RunCheckForUnusedVariables();
   }
@@ -3002,4 +3045,15 @@ bool cmake::IsProfilingEnabled() const
 {
   return static_cast<bool>(this->ProfilingOutput);
 }
+
+cm::optional<cmMakefileProfilingData::RAII> cmake::CreateProfilingEntry(
+  const std::string& category, const std::string& name,
+  cm::optional<Json::Value> args)
+{
+  if (this->ProfilingOutput) {
+    return cm::make_optional<cmMakefileProfilingData::RAII>(
+      *this->ProfilingOutput, category, name, std::move(args));
+  }
+  return cm::nullopt;
+}
 #endif
@@ -16,6 +16,7 @@
 #include <utility>
 #include <vector>
 
+#include <cm/optional>
 #include <cm/string_view>
 
 #include "cmGeneratedFileStream.h"
@@ -29,6 +30,8 @@
 
 #if !defined(CMAKE_BOOTSTRAP)
 #  include <cm3p/json/value.h>
+
+#  include "cmMakefileProfilingData.h"
 #endif
 
 class cmExternalMakefileProjectGeneratorFactory;
@@ -37,10 +40,8 @@ class cmFileTimeCache;
 class cmGlobalGenerator;
 class cmGlobalGeneratorFactory;
 class cmMakefile;
-#if !defined(CMAKE_BOOTSTRAP)
-class cmMakefileProfilingData;
-#endif
 class cmMessenger;
+class cmTraceWriter;
 class cmVariableWatch;
 struct cmDocumentationEntry;
 
@@ -444,7 +445,8 @@ public:
   {
     return this->TraceOnlyThisSources;
   }
-  cmGeneratedFileStream& GetTraceFile() { return this->TraceFile; }
+  //! Writer for the trace file, or nullptr if tracing to the console.
+  cmTraceWriter* GetTraceWriter();
   void SetTraceFile(std::string const& file);
   void PrintTraceFormatVersion();
 
@@ -545,6 +547,12 @@ public:
 #if !defined(CMAKE_BOOTSTRAP)
   cmMakefileProfilingData& GetProfilingOutput();
   bool IsProfilingEnabled() const;
+
+  /** Start a profiling entry that is stopped when the returned object goes
+      out of scope.  Does nothing if profiling is not enabled.  */
+  cm::optional<cmMakefileProfilingData::RAII> CreateProfilingEntry(
+    const std::string& category, const std::string& name,
+    cm::optional<Json::Value> args = cm::nullopt);
 #endif
 
 protected:
@@ -602,6 +610,7 @@ private:
   bool TraceExpand = false;
   TraceFormat TraceFormatVar = TRACE_HUMAN;
   cmGeneratedFileStream TraceFile;
+  std::unique_ptr<cmTraceWriter> TraceWriter;
   bool WarnUninitialized = false;
   bool WarnUnusedCli = true;
   bool CheckSystemVars = false;
@@ -623,6 +632,9 @@ private:
   bool RegenerateDuringBuild = false;
   std::unique_ptr<cmFileTimeCache> FileTimeCache;
   std::string GraphVizFile;
+#if !defined(CMAKE_BOOTSTRAP)
+  std::string StateDumpFile;
+#endif
   InstalledFilesMap InstalledFiles;
 
 #if !defined(CMAKE_BOOTSTRAP)
@@ -76,6 +76,10 @@ const char* cmDocumentationOptions[][2] = {
     "Generate graphviz of dependencies, see "
     "CMakeGraphVizOptions.cmake for more." },
   { "--system-information [file]", "Dump information about this system." },
+#  if !defined(CMAKE_BOOTSTRAP)
+  { "--dump-state=<file>",
+    "Write a binary snapshot of the configured state to a file." },
+#  endif
   { "--log-level=<ERROR|WARNING|NOTICE|STATUS|VERBOSE|DEBUG|TRACE>",
     "Set the verbosity of messages from CMake files. "
     "--loglevel is also accepted for backward compatibility reasons." },
@@ -100,7 +104,7 @@ const char* cmDocumentationOptions[][2] = {
 #  if !defined(CMAKE_BOOTSTRAP)
   { "--profiling-format=<fmt>",
     "Output data for profiling CMake scripts. Supported formats: "
-    "google-trace" },
+    "google-trace, summary" },
   { "--profiling-output=<file>",
     "Select an output path for the profiling data enabled through "
     "--profiling-format." },
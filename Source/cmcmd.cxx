@@ -29,6 +29,7 @@
 #  include "cmFileTime.h"
 #  include "cmServer.h"
 #  include "cmServerConnection.h"
+#  include "cmStateDumpReader.h"
 
 #  include "bindexplib.h"
 #endif
@@ -47,6 +48,7 @@
 #include <cstring>
 #include <ctime>
 #include <iostream>
+#include <map>
 #include <memory>
 #include <sstream>
 #include <utility>
@@ -92,6 +94,11 @@ void CMakeCommandUsage(const char* program)
     << "  chdir dir cmd [args...]   - run command in a given directory\n"
     << "  compare_files [--ignore-eol] file1 file2\n"
     << "                              - check if file1 is same as file2\n"
+#ifndef CMAKE_BOOTSTRAP
+    << "  compare_state_dumps file1 file2\n"
+    << "                              - report differences between two "
+       "--dump-state files\n"
+#endif
     << "  copy <file>... destination  - copy files to destination "
        "(either file or directory)\n"
     << "  copy_directory <dir>... destination   - copy content of <dir>... "
@@ -187,6 +194,174 @@ static void cmCatFile(const std::string& fileToAppend)
   std::cout << source.rdbuf();
 }
 
+#if !defined(CMAKE_BOOTSTRAP)
+namespace {
+using StateDumpMap = std::map<cm::string_view, cm::string_view>;
+
+StateDumpMap StateDumpPairs(std::vector<cmStateDumpReader::Pair> const& pairs)
+{
+  StateDumpMap result;
+  for (cmStateDumpReader::Pair const& p : pairs) {
+    if (p.Value) {
+      result.emplace(p.Name, *p.Value);
+    }
+  }
+  return result;
+}
+
+// Print the differences between two maps, return true if there are any.
+bool CompareStateDumpMaps(std::string const& what, StateDumpMap const& a,
+                          StateDumpMap const& b)
+{
+  bool differ = false;
+  auto ai = a.begin();
+  auto bi = b.begin();
+  while (ai != a.end() || bi != b.end()) {
+    if (bi == b.end() || (ai != a.end() && ai->first < bi->first)) {
+      std::cout << what << ' ' << ai->first << ": only in first\n";
+      differ = true;
+      ++ai;
+    } else if (ai == a.end() || bi->first < ai->first) {
+      std::cout << what << ' ' << bi->first << ": only in second\n";
+      differ = true;
+      ++bi;
+    } else {
+      if (ai->second != bi->second) {
+        std::cout << what << ' ' << ai->first << ": \"" << ai->second
+                  << "\" != \"" << bi->second << "\"\n";
+        differ = true;
+      }
+      ++ai;
+      ++bi;
+    }
+  }
+  return differ;
+}
+
+int CompareStateDumps(std::string const& fileA, std::string const& fileB)
+{
+  cmStateDumpReader a;
+  cmStateDumpReader b;
+  std::string error;
+  if (!a.Load(fileA, error) || !b.Load(fileB, error)) {
+    std::cerr << error << "\n";
+    return 2;
+  }
+
+  bool differ = false;
+
+  auto cacheEntries = [](cmStateDumpReader const& reader) {
+    std::map<cm::string_view, cmStateDumpReader::CacheEntry> entries;
+    for (std::size_t i = 0; i < reader.GetCacheEntryCount(); ++i) {
+      cmStateDumpReader::CacheEntry entry = reader.GetCacheEntry(i);
+      cm::string_view const key = entry.Key;
+      entries.emplace(key, std::move(entry));
+    }
+    return entries;
+  };
+  auto const cacheA = cacheEntries(a);
+  auto const cacheB = cacheEntries(b);
+  StateDumpMap valuesA;
+  StateDumpMap valuesB;
+  for (auto const& e : cacheA) {
+    valuesA.emplace(e.first, e.second.Value);
+  }
+  for (auto const& e : cacheB) {
+    valuesB.emplace(e.first, e.second.Value);
+  }
+  differ |= CompareStateDumpMaps("cache", valuesA, valuesB);
+  for (auto const& e : cacheA) {
+    auto it = cacheB.find(e.first);
+    if (it == cacheB.end()) {
+      continue;
+    }
+    std::string const what = cmStrCat("cache ", e.first);
+    if (e.second.Type != it->second.Type) {
+      std::cout << what << ": type " << e.second.Type
+                << " != " << it->second.Type << "\n";
+      differ = true;
+    }
+    differ |= CompareStateDumpMaps(cmStrCat(what, " property"),
+                                   StateDumpPairs(e.second.Properties),
+                                   StateDumpPairs(it->second.Properties));
+  }
+
+  differ |= CompareStateDumpMaps("global property",
+                                 StateDumpPairs(a.GetGlobalProperties()),
+                                 StateDumpPairs(b.GetGlobalProperties()));
+
+  auto directories = [](cmStateDumpReader const& reader) {
+    std::map<cm::string_view, std::size_t> dirs;
+    for (std::size_t i = 0; i < reader.GetDirectoryCount(); ++i) {
+      dirs.emplace(reader.GetDirectory(i).BinaryDirectory, i);
+    }
+    return dirs;
+  };
+  auto const dirsA = directories(a);
+  auto const dirsB = directories(b);
+  StateDumpMap dirNamesA;
+  StateDumpMap dirNamesB;
+  for (auto const& d : dirsA) {
+    dirNamesA.emplace(d.first, cm::string_view());
+  }
+  for (auto const& d : dirsB) {
+    dirNamesB.emplace(d.first, cm::string_view());
+  }
+  differ |= CompareStateDumpMaps("directory", dirNamesA, dirNamesB);
+
+  auto targets = [](cmStateDumpReader const& reader,
+                    cmStateDumpReader::Directory const& dir) {
+    std::map<cm::string_view, cmStateDumpReader::Target> result;
+    for (std::size_t i = 0; i < dir.TargetCount; ++i) {
+      cmStateDumpReader::Target target =
+        reader.GetTarget(dir.FirstTarget + i);
+      cm::string_view const name = target.Name;
+      result.emplace(name, std::move(target));
+    }
+    return result;
+  };
+  for (auto const& d : dirsA) {
+    auto it = dirsB.find(d.first);
+    if (it == dirsB.end()) {
+      continue;
+    }
+    cmStateDumpReader::Directory const dirA = a.GetDirectory(d.second);
+    cmStateDumpReader::Directory const dirB = b.GetDirectory(it->second);
+    std::string const what = cmStrCat("directory ", d.first);
+    differ |= CompareStateDumpMaps(cmStrCat(what, " variable"),
+                                   a.GetDefinitions(d.second),
+                                   b.GetDefinitions(it->second));
+    differ |= CompareStateDumpMaps(cmStrCat(what, " property"),
+                                   StateDumpPairs(dirA.Properties),
+                                   StateDumpPairs(dirB.Properties));
+
+    auto const targetsA = targets(a, dirA);
+    auto const targetsB = targets(b, dirB);
+    StateDumpMap typesA;
+    StateDumpMap typesB;
+    for (auto const& t : targetsA) {
+      typesA.emplace(t.first, t.second.Type);
+    }
+    for (auto const& t : targetsB) {
+      typesB.emplace(t.first, t.second.Type);
+    }
+    differ |= CompareStateDumpMaps(cmStrCat(what, " target"), typesA, typesB);
+    for (auto const& t : targetsA) {
+      auto ti = targetsB.find(t.first);
+      if (ti != targetsB.end()) {
+        differ |= CompareStateDumpMaps(
+          cmStrCat("target ", t.first, " property"),
+          StateDumpPairs(t.second.Properties),
+          StateDumpPairs(ti->second.Properties));
+      }
+    }
+  }
+
+  return differ ? 1 : 0;
+}
+}
+#endif
+
 static bool cmRemoveDirectory(const std::string& dir, bool recursive = true)
 {
   if (cmSystemTools::FileIsSymlink(dir)) {
@@ -593,6 +768,10 @@ int cmcmd::ExecuteCMakeCommand(std::vector<std::string> const& args)
     }
 
 #if !defined(CMAKE_BOOTSTRAP)
+    if (args[1] == "compare_state_dumps" && args.size() == 4) {
+      return CompareStateDumps(args[2], args[3]);
+    }
+
     if (args[1] == "__create_def") {
       if (args.size() < 4) {
         std::cerr << "__create_def Usage: -E __create_def outfile.def "
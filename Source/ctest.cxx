@@ -105,6 +105,8 @@ static const char* cmDocumentationOptions[][2] = {
     "Allow each test to run up to <n> times in order to pass" },
   { "--repeat after-timeout:<n>",
     "Allow each test to run up to <n> times if it times out" },
+  { "--shard <i>/<n>",
+    "Run only the i-th of n shards of the tests, balanced by cost" },
   { "--max-width <width>", "Set the max width for a test name to output" },
   { "--interactive-debug-mode [0|1]", "Set the interactive mode to 0 or 1." },
   { "--resource-spec-file <file>", "Set the resource spec file to use." },
@@ -131,12 +133,19 @@ static const char* cmDocumentationOptions[][2] = {
   { "--test-command", "The test to run with the --build-and-test option." },
   { "--test-timeout", "The time limit in seconds, internal use only." },
   { "--test-load", "CPU load threshold for starting new parallel tests." },
+  { "--test-pressure",
+    "CPU and memory pressure threshold for running parallel tests." },
   { "--tomorrow-tag", "Nightly or experimental starts with next day tag." },
   { "--overwrite", "Overwrite CTest configuration option." },
   { "--extra-submit <file>[;<file>]", "Submit extra files to the dashboard." },
   { "--force-new-ctest-process",
     "Run child CTest instances as new processes" },
   { "--schedule-random", "Use a random order for scheduling tests" },
+  { "--schedule-report",
+    "Report the critical path and the predicted and actual time of "
+    "the test run" },
+  { "--cache-results",
+    "Skip tests that passed before and whose inputs are unchanged" },
   { "--submit-index",
     "Submit individual dashboard tests with specific index" },
   { "--timeout <seconds>", "Set the default test timeout." },
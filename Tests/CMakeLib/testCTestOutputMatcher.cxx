@@ -0,0 +1,110 @@
+#include <algorithm>
+#include <cstddef>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <cm/string_view>
+
+#include "cmsys/RegularExpression.hxx"
+
+#include "cmCTestOutputMatcher.h"
+
+struct ExpectedMatch
+{
+  std::string Regex;
+  std::string Output;
+  bool Found;
+};
+
+static const std::vector<ExpectedMatch> expectedMatches = {
+  { "Passed", "Test Passed\n", true },
+  { "Passed", "Test Failed\n", false },
+  { "^Test", "Test Passed\n", true },
+  { "^Passed", "Test\nPassed\n", false },
+  { "Passed$", "Test Passed", true },
+  { "Passed$", "Test Passed\n", false },
+  { "Passed\n$", "Test Passed\n", true },
+  { "^$", "", true },
+  { "^$", "\n", false },
+  { "a.c", "a\nc", true },
+  { "[0-9]+ tests", "found 12 tests\n", true },
+  { "[^0-9 ]+ tests", "found 12 tests\n", false },
+  { "[]x]", "]", true },
+  { "[-x]", "-", true },
+  { "[a-]", "-", true },
+  { "(ab|cd)+e", "xcdabe", true },
+  { "(ab|cd)+e", "xcdae", false },
+  { "colou?r", "color", true },
+  { "a\\.b", "a.b", true },
+  { "a\\.b", "axb", false },
+  { "x*y", "y", true },
+  { "(a|)b", "b", true },
+  { "error: .*not found", "error: file\nfoo not found\n", true },
+  { "abc*", "ab", true },
+  { "abc+", "ab", false },
+  // Invalid regular expressions are never found.
+  { "a**", "a", false },
+  { "(a", "a", false },
+  { "a)", "a", false },
+  { "[a", "a", false },
+  { "*a", "a", false },
+  { "a\\", "a", false },
+  { "^*", "", false },
+  { "()*", "", false },
+  { "((((((((((a))))))))))", "a", false },
+  { "(((((((((a)))))))))", "a", true },
+  { "[z-a]", "a", false },
+};
+
+static bool testMatch(ExpectedMatch const& expected)
+{
+  bool result = true;
+  cmsys::RegularExpression regex(expected.Regex);
+  bool const found = regex.is_valid() && regex.find(expected.Output);
+  if (found != expected.Found) {
+    std::cout << "cmsys::RegularExpression(\"" << expected.Regex
+              << "\") does not give the expected result" << std::endl;
+    result = false;
+  }
+
+  // Feed the output in all pieces of up to three characters and check the
+  // result after every piece.
+  for (std::size_t size = 1; size <= 3; ++size) {
+    cmCTestOutputMatcher matcher;
+    std::size_t const index = matcher.Add("never");
+    std::size_t const tested = matcher.Add(expected.Regex);
+    for (std::size_t pos = 0;; pos += size) {
+      cm::string_view const output(expected.Output.data(),
+                                   std::min(pos, expected.Output.size()));
+      bool const expectedSoFar =
+        regex.is_valid() && regex.find(std::string(output));
+      if (matcher.IsFound(tested) != expectedSoFar ||
+          matcher.IsFound(index)) {
+        std::cout << "cmCTestOutputMatcher(\"" << expected.Regex
+                  << "\") after " << output.size() << " characters of \""
+                  << expected.Output << "\" fed in pieces of " << size
+                  << " does not give the expected result" << std::endl;
+        result = false;
+        break;
+      }
+      if (pos >= expected.Output.size()) {
+        break;
+      }
+      matcher.Feed(cm::string_view(expected.Output).substr(pos, size));
+    }
+  }
+
+  return result;
+}
+
+int testCTestOutputMatcher(int /*unused*/, char* /*unused*/[])
+{
+  int retval = 0;
+  for (auto const& expected : expectedMatches) {
+    if (!testMatch(expected)) {
+      retval = -1;
+    }
+  }
+  return retval;
+}
@@ -0,0 +1,6 @@
+#include "MakeDependsUseCompiler.h"
+
+int main(void)
+{
+  return MakeDependsUseCompiler();
+}
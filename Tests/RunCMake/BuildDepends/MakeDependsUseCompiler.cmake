@@ -0,0 +1,10 @@
+enable_language(C)
+set(CMAKE_DEPENDS_USE_COMPILER 1)
+include_directories(${CMAKE_CURRENT_BINARY_DIR})
+add_executable(MakeDependsUseCompiler MakeDependsUseCompiler.c)
+
+file(GENERATE OUTPUT ${CMAKE_CURRENT_BINARY_DIR}/check-$<LOWER_CASE:$<CONFIG>>.cmake CONTENT "
+set(check_exes
+  \"$<TARGET_FILE:MakeDependsUseCompiler>\"
+  )
+")
@@ -0,0 +1,3 @@
+file(WRITE "${RunCMake_TEST_BINARY_DIR}/MakeDependsUseCompiler.h" [[
+static int MakeDependsUseCompiler(void) { return 1; }
+]])
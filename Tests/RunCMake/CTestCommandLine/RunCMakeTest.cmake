@@ -224,6 +224,90 @@ run_TestLoad(test-load-pass 10)
 
 unset(ENV{__CTEST_FAKE_LOAD_AVERAGE_FOR_TESTING})
 
+function(run_MemoryRequired)
+  set(RunCMake_TEST_BINARY_DIR ${RunCMake_BINARY_DIR}/MemoryRequired)
+  set(RunCMake_TEST_NO_CLEAN 1)
+  file(REMOVE_RECURSE "${RunCMake_TEST_BINARY_DIR}")
+  file(MAKE_DIRECTORY "${RunCMake_TEST_BINARY_DIR}")
+  file(WRITE "${RunCMake_TEST_BINARY_DIR}/CTestTestfile.cmake" "
+  add_test(MemoryRequired1 \"${CMAKE_COMMAND}\" -E echo MemoryRequired1)
+  add_test(MemoryRequired2 \"${CMAKE_COMMAND}\" -E echo MemoryRequired2)
+  add_test(MemoryRequired3 \"${CMAKE_COMMAND}\" -E echo MemoryRequired3)
+  set_tests_properties(MemoryRequired2 MemoryRequired3 PROPERTIES
+    MEMORY_REQUIRED 600)
+  set_tests_properties(MemoryRequired2 PROPERTIES COST 2)
+")
+  # Spoof the available memory so that the tests needing memory must
+  # run one at a time.  The third test starts only after the second one
+  # completed.
+  set(ENV{__CTEST_FAKE_AVAILABLE_MEMORY_FOR_TESTING} 1000)
+  run_cmake_command(memory-required ${CMAKE_CTEST_COMMAND} -j3)
+  unset(ENV{__CTEST_FAKE_AVAILABLE_MEMORY_FOR_TESTING})
+endfunction()
+run_MemoryRequired()
+
+function(run_TestPressure)
+  set(RunCMake_TEST_BINARY_DIR ${RunCMake_BINARY_DIR}/TestPressure)
+  set(RunCMake_TEST_NO_CLEAN 1)
+  file(REMOVE_RECURSE "${RunCMake_TEST_BINARY_DIR}")
+  file(MAKE_DIRECTORY "${RunCMake_TEST_BINARY_DIR}")
+  file(WRITE "${RunCMake_TEST_BINARY_DIR}/CTestTestfile.cmake" "
+  add_test(Pressure1 \"${CMAKE_COMMAND}\" -E sleep 1.5)
+  add_test(Pressure2 \"${CMAKE_COMMAND}\" -E sleep 1.5)
+  add_test(Pressure3 \"${CMAKE_COMMAND}\" -E sleep 0.5)
+  add_test(Pressure4 \"${CMAKE_COMMAND}\" -E sleep 0.5)
+  set_tests_properties(Pressure1 Pressure2 PROPERTIES COST 2)
+  set_tests_properties(Pressure3 PROPERTIES COST 1)
+")
+  # Spoof a pressure above the threshold, so that after the first check
+  # the tests run one at a time.
+  set(ENV{__CTEST_FAKE_PRESSURE_FOR_TESTING} 100)
+  run_cmake_command(test-pressure ${CMAKE_CTEST_COMMAND} -j2 --test-pressure 50)
+  unset(ENV{__CTEST_FAKE_PRESSURE_FOR_TESTING})
+  run_cmake_command(test-pressure-invalid ${CMAKE_CTEST_COMMAND} -R Pressure3 --test-pressure 101)
+endfunction()
+run_TestPressure()
+
+function(run_ScheduleReport)
+  set(RunCMake_TEST_BINARY_DIR ${RunCMake_BINARY_DIR}/ScheduleReport)
+  set(RunCMake_TEST_NO_CLEAN 1)
+  file(REMOVE_RECURSE "${RunCMake_TEST_BINARY_DIR}")
+  file(MAKE_DIRECTORY "${RunCMake_TEST_BINARY_DIR}")
+  # Each test takes both slots, so the tests run one at a time in the
+  # order of their critical paths.
+  file(WRITE "${RunCMake_TEST_BINARY_DIR}/CTestTestfile.cmake" "
+  add_test(X1 \"${CMAKE_COMMAND}\" -E echo X1)
+  add_test(X2 \"${CMAKE_COMMAND}\" -E echo X2)
+  add_test(Y1 \"${CMAKE_COMMAND}\" -E echo Y1)
+  add_test(Y2 \"${CMAKE_COMMAND}\" -E echo Y2)
+  add_test(Y3 \"${CMAKE_COMMAND}\" -E echo Y3)
+  set_tests_properties(X1 X2 Y1 Y2 Y3 PROPERTIES PROCESSORS 2 COST 1)
+  set_tests_properties(X2 PROPERTIES DEPENDS X1 COST 100)
+  set_tests_properties(Y2 PROPERTIES DEPENDS Y1)
+  set_tests_properties(Y3 PROPERTIES DEPENDS Y2)
+")
+  run_cmake_command(schedule-report ${CMAKE_CTEST_COMMAND} -j2 --schedule-report)
+endfunction()
+run_ScheduleReport()
+
+function(run_CostData)
+  set(RunCMake_TEST_BINARY_DIR ${RunCMake_BINARY_DIR}/CostData)
+  set(RunCMake_TEST_NO_CLEAN 1)
+  file(REMOVE_RECURSE "${RunCMake_TEST_BINARY_DIR}")
+  file(MAKE_DIRECTORY "${RunCMake_TEST_BINARY_DIR}")
+  file(WRITE "${RunCMake_TEST_BINARY_DIR}/CTestTestfile.cmake" "
+  add_test(Passing \"${CMAKE_COMMAND}\" -E echo Passing)
+  add_test(Failing \"${CMAKE_COMMAND}\" -E no_such_command)
+")
+  # Start from the format of older versions.  Durations that are not
+  # finite are dropped.
+  file(WRITE "${RunCMake_TEST_BINARY_DIR}/Testing/Temporary/CTestCostData.txt"
+    "Passing 4 1.5\nRemoved 2 3\nNotFinite 1 nan\nInfinite 1 inf\n---\nPassing\n")
+  run_cmake_command(cost-data-1 ${CMAKE_CTEST_COMMAND} -j2 -C Debug)
+  run_cmake_command(cost-data-2 ${CMAKE_CTEST_COMMAND} -j2 -C Debug)
+endfunction()
+run_CostData()
+
 function(run_TestOutputSize)
   set(RunCMake_TEST_BINARY_DIR ${RunCMake_BINARY_DIR}/TestOutputSize)
   set(RunCMake_TEST_NO_CLEAN 1)
@@ -242,6 +326,107 @@ function(run_TestOutputSize)
 endfunction()
 run_TestOutputSize()
 
+function(run_TestOutputSpill)
+  set(RunCMake_TEST_BINARY_DIR ${RunCMake_BINARY_DIR}/TestOutputSpill)
+  set(RunCMake_TEST_NO_CLEAN 1)
+  file(REMOVE_RECURSE "${RunCMake_TEST_BINARY_DIR}")
+  file(MAKE_DIRECTORY "${RunCMake_TEST_BINARY_DIR}")
+  # Print more output than is kept in memory, so that it is spilled to a
+  # file before the lines the regular expressions match.  These still
+  # match the whole output, with "^" and "$" at its start and end only.
+  file(WRITE "${RunCMake_TEST_BINARY_DIR}/spill.cmake" [[
+string(REPEAT "x" 1000 line)
+foreach(i RANGE 1200)
+  message("${line}")
+endforeach()
+message("${MARK}")
+]])
+  file(WRITE "${RunCMake_TEST_BINARY_DIR}/CTestTestfile.cmake" "
+  add_test(SpillPass \"${CMAKE_COMMAND}\" -DMARK=SpillPassMark -P spill.cmake)
+  add_test(SpillFail \"${CMAKE_COMMAND}\" -DMARK=SpillFailMark -P spill.cmake)
+  add_test(SpillEnd \"${CMAKE_COMMAND}\" -DMARK=SpillEndMark -P spill.cmake)
+  set_tests_properties(SpillPass PROPERTIES PASS_REGULAR_EXPRESSION SpillPassMark
+    FAIL_REGULAR_EXPRESSION \"x[^x]$\")
+  set_tests_properties(SpillFail PROPERTIES FAIL_REGULAR_EXPRESSION \"^x.*SpillFailMark\")
+  set_tests_properties(SpillEnd PROPERTIES PASS_REGULAR_EXPRESSION \"x[^x]SpillEndMark[^x]$\")
+")
+  run_cmake_command(TestOutputSpill ${CMAKE_CTEST_COMMAND} --output-on-failure)
+endfunction()
+run_TestOutputSpill()
+
+function(run_TestUsage)
+  set(RunCMake_TEST_BINARY_DIR ${RunCMake_BINARY_DIR}/TestUsage)
+  set(RunCMake_TEST_NO_CLEAN 1)
+  file(REMOVE_RECURSE "${RunCMake_TEST_BINARY_DIR}")
+  file(MAKE_DIRECTORY "${RunCMake_TEST_BINARY_DIR}")
+  file(WRITE "${RunCMake_TEST_BINARY_DIR}/CTestTestfile.cmake" "
+  add_test(Sleep \"${CMAKE_COMMAND}\" -E sleep 0.5)
+")
+  run_cmake_command(TestUsage ${CMAKE_CTEST_COMMAND} -M Experimental -T Test)
+endfunction()
+if(EXISTS /proc/self/status)
+  run_TestUsage()
+endif()
+
+function(run_Shard)
+  set(RunCMake_TEST_BINARY_DIR ${RunCMake_BINARY_DIR}/Shard)
+  set(RunCMake_TEST_NO_CLEAN 1)
+  file(REMOVE_RECURSE "${RunCMake_TEST_BINARY_DIR}")
+  file(MAKE_DIRECTORY "${RunCMake_TEST_BINARY_DIR}")
+  # Tests depending on each other stay together, and the fixture tests
+  # run in every shard with a test requiring the fixture.
+  file(WRITE "${RunCMake_TEST_BINARY_DIR}/CTestTestfile.cmake" "
+  add_test(Long \"${CMAKE_COMMAND}\" -E echo Long)
+  add_test(Setup \"${CMAKE_COMMAND}\" -E echo Setup)
+  add_test(Short1 \"${CMAKE_COMMAND}\" -E echo Short1)
+  add_test(Fixture \"${CMAKE_COMMAND}\" -E echo Fixture)
+  add_test(Short2 \"${CMAKE_COMMAND}\" -E echo Short2)
+  add_test(Depends \"${CMAKE_COMMAND}\" -E echo Depends)
+  add_test(Cleanup \"${CMAKE_COMMAND}\" -E echo Cleanup)
+  set_tests_properties(Long PROPERTIES COST 3)
+  set_tests_properties(Setup PROPERTIES FIXTURES_SETUP Fix)
+  set_tests_properties(Cleanup PROPERTIES FIXTURES_CLEANUP Fix)
+  set_tests_properties(Fixture Short2 PROPERTIES FIXTURES_REQUIRED Fix)
+  set_tests_properties(Depends PROPERTIES DEPENDS Short1)
+  set_tests_properties(Setup Fixture Short1 Short2 Depends Cleanup
+    PROPERTIES COST 1)
+")
+  run_cmake_command(shard-1 ${CMAKE_CTEST_COMMAND} -N --shard 1/2)
+  run_cmake_command(shard-2 ${CMAKE_CTEST_COMMAND} -N --shard 2/2)
+  run_cmake_command(shard-bad ${CMAKE_CTEST_COMMAND} --shard 3/2)
+endfunction()
+run_Shard()
+
+function(run_CacheResults)
+  set(RunCMake_TEST_BINARY_DIR ${RunCMake_BINARY_DIR}/CacheResults)
+  set(RunCMake_TEST_NO_CLEAN 1)
+  file(REMOVE_RECURSE "${RunCMake_TEST_BINARY_DIR}")
+  file(MAKE_DIRECTORY "${RunCMake_TEST_BINARY_DIR}")
+  file(WRITE "${RunCMake_TEST_BINARY_DIR}/input.txt" "1")
+  file(WRITE "${RunCMake_TEST_BINARY_DIR}/CTestTestfile.cmake" "
+  add_test(Passing \"${CMAKE_COMMAND}\" -E echo Passing)
+  add_test(Input \"${CMAKE_COMMAND}\" -E echo Input)
+  add_test(Failing \"${CMAKE_COMMAND}\" -E false)
+  set_tests_properties(Input PROPERTIES INPUT_FILES input.txt)
+")
+  run_cmake_command(cache-results-1 ${CMAKE_CTEST_COMMAND} --cache-results)
+  run_cmake_command(cache-results-2 ${CMAKE_CTEST_COMMAND} --cache-results)
+  file(WRITE "${RunCMake_TEST_BINARY_DIR}/input.txt" "2")
+  run_cmake_command(cache-results-3 ${CMAKE_CTEST_COMMAND} --cache-results)
+
+  # Results saved by another ctest while this one runs are kept, except
+  # for tests that do not exist.
+  file(WRITE "${RunCMake_TEST_BINARY_DIR}/other.cmake" [[
+file(APPEND Testing/Temporary/CTestResultCache.txt "1234 Other\n5678 Gone\n")
+]])
+  file(WRITE "${RunCMake_TEST_BINARY_DIR}/CTestTestfile.cmake" "
+  add_test(Writer \"${CMAKE_COMMAND}\" -P other.cmake)
+  add_test(Other \"${CMAKE_COMMAND}\" -E echo Other)
+")
+  run_cmake_command(cache-results-merge ${CMAKE_CTEST_COMMAND} --cache-results -R Writer)
+endfunction()
+run_CacheResults()
+
 # Test --stop-on-failure
 function(run_stop_on_failure)
   set(RunCMake_TEST_BINARY_DIR ${RunCMake_BINARY_DIR}/stop-on-failure)
@@ -288,6 +473,26 @@ function(run_TestStdin)
 endfunction()
 run_TestStdin()
 
+function(run_TestScript)
+  set(RunCMake_TEST_BINARY_DIR ${RunCMake_BINARY_DIR}/TestScript)
+  set(RunCMake_TEST_NO_CLEAN 1)
+  file(REMOVE_RECURSE "${RunCMake_TEST_BINARY_DIR}")
+  file(MAKE_DIRECTORY "${RunCMake_TEST_BINARY_DIR}")
+  # A script without an interpreter line is run with the shell.
+  file(WRITE "${RunCMake_TEST_BINARY_DIR}/script/script.sh" "echo TestScriptRan\n")
+  file(COPY "${RunCMake_TEST_BINARY_DIR}/script/script.sh"
+    DESTINATION "${RunCMake_TEST_BINARY_DIR}"
+    FILE_PERMISSIONS OWNER_READ OWNER_WRITE OWNER_EXECUTE)
+  file(WRITE "${RunCMake_TEST_BINARY_DIR}/CTestTestfile.cmake" "
+  add_test(TestScript \"${RunCMake_TEST_BINARY_DIR}/script.sh\")
+  set_tests_properties(TestScript PROPERTIES PASS_REGULAR_EXPRESSION TestScriptRan)
+  ")
+  run_cmake_command(TestScript ${CMAKE_CTEST_COMMAND})
+endfunction()
+if(UNIX)
+  run_TestScript()
+endif()
+
 function(show_only_json_check_python v)
   if(RunCMake_TEST_FAILED OR NOT PYTHON_EXECUTABLE)
     return()
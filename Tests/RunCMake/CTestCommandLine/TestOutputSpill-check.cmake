@@ -0,0 +1,12 @@
+file(GLOB spill_files "${RunCMake_TEST_BINARY_DIR}/Testing/Temporary/TestOutput-*")
+set(log_file "${RunCMake_TEST_BINARY_DIR}/Testing/Temporary/LastTest.log")
+if(spill_files)
+  set(RunCMake_TEST_FAILED "Spill files not removed:\n ${spill_files}")
+elseif(NOT EXISTS "${log_file}")
+  set(RunCMake_TEST_FAILED "LastTest.log not found")
+else()
+  file(STRINGS "${log_file}" marks REGEX "^Spill(Pass|Fail|End)Mark$")
+  if(NOT marks STREQUAL "SpillPassMark;SpillFailMark;SpillEndMark")
+    set(RunCMake_TEST_FAILED "LastTest.log does not contain all output:\n ${marks}")
+  endif()
+endif()
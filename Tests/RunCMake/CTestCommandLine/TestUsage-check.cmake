@@ -0,0 +1,12 @@
+file(GLOB test_xml_file "${RunCMake_TEST_BINARY_DIR}/Testing/*/Test.xml")
+if(test_xml_file)
+  file(READ "${test_xml_file}" test_xml)
+  foreach(name IN ITEMS "Peak Memory" "CPU Time" "Read Bytes" "Write Bytes")
+    if(NOT test_xml MATCHES "<NamedMeasurement type=\"numeric/double\" name=\"${name}\">")
+      set(RunCMake_TEST_FAILED "Test.xml does not contain the ${name} of the test:\n ${test_xml}")
+      break()
+    endif()
+  endforeach()
+else()
+  set(RunCMake_TEST_FAILED "Test.xml not found")
+endif()
@@ -0,0 +1,5 @@
+file(STRINGS "${RunCMake_TEST_BINARY_DIR}/Testing/Temporary/CTestResultCache.txt" lines)
+list(TRANSFORM lines REPLACE "^[^ ]+ " "")
+if(NOT lines STREQUAL "Other;Writer")
+  set(RunCMake_TEST_FAILED "Unexpected tests in the result cache:\n ${lines}")
+endif()
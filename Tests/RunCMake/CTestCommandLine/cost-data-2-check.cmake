@@ -0,0 +1,9 @@
+file(READ "${RunCMake_TEST_BINARY_DIR}/Testing/Temporary/CTestCostData.txt" cost_data)
+set(expect "^Passing 6 [0-9.e-]+ [0-9.e-]+ Debug 2 [0-9]+
+Removed 2 3 0 - 0 0
+---
+Failing
+$")
+if(NOT cost_data MATCHES "${expect}")
+  set(RunCMake_TEST_FAILED "CTestCostData.txt does not match\n ${expect}\nActual content:\n ${cost_data}")
+endif()
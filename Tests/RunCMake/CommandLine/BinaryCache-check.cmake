@@ -0,0 +1,3 @@
+if(NOT EXISTS ${RunCMake_TEST_BINARY_DIR}/CMakeFiles/CMakeCache.bin)
+  set(RunCMake_TEST_FAILED "Binary cache sidecar not written")
+endif()
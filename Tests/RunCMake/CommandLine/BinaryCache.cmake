@@ -0,0 +1,2 @@
+set(BINARY_CACHE_VALUE "initial" CACHE STRING "")
+message(STATUS "BINARY_CACHE_VALUE='${BINARY_CACHE_VALUE}'")
@@ -0,0 +1,4 @@
+set(DUMP_STATE_VALUE "initial" CACHE STRING "")
+set(dump_state_var "${DUMP_STATE_VALUE}")
+add_custom_target(DumpStateTarget)
+set_property(TARGET DumpStateTarget PROPERTY DUMP_STATE_PROP "${DUMP_STATE_VALUE}")
@@ -0,0 +1,30 @@
+if (NOT EXISTS ${ProfilingTestOutput})
+  set(RunCMake_TEST_FAILED "Expected ${ProfilingTestOutput} to exists")
+  return()
+endif()
+if (NOT EXISTS ${ProfilingTestOutput}.folded)
+  set(RunCMake_TEST_FAILED "Expected ${ProfilingTestOutput}.folded to exists")
+  return()
+endif()
+
+file(READ "${ProfilingTestOutput}" summary)
+foreach(category IN ITEMS listfile function/macro command find_package)
+  if (NOT summary MATCHES "\n${category}\n")
+    set(RunCMake_TEST_FAILED "Missing category '${category}' in summary")
+    return()
+  endif()
+endforeach()
+if (NOT summary MATCHES "\n +2 +[0-9.]+ +[0-9.]+  __testing_summary_function\n")
+  set(RunCMake_TEST_FAILED "Function not aggregated:\n${summary}")
+  return()
+endif()
+if (NOT summary MATCHES "  NoSuchPackageForProfiling\n")
+  set(RunCMake_TEST_FAILED "find_package not aggregated:\n${summary}")
+  return()
+endif()
+
+file(STRINGS ${ProfilingTestOutput}.folded stacks
+  REGEX "ProfilingSummaryTest.cmake;__testing_summary_function;string [0-9]+$")
+if (NOT stacks)
+  set(RunCMake_TEST_FAILED "Expected folded stack for function body")
+endif()
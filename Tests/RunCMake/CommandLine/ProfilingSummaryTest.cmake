@@ -0,0 +1,7 @@
+function(__testing_summary_function)
+  string(TOUPPER "abc" out)
+endfunction()
+
+__testing_summary_function()
+__testing_summary_function()
+find_package(NoSuchPackageForProfiling QUIET)
@@ -29,3 +29,11 @@ if (NOT numInvocations EQUAL 1)
   set(RunCMake_TEST_FAILED
       "Unexpected number of lowercase command names: ${numInvocations}")
 endif()
+
+foreach(step IN ITEMS Compute ComputeTargetDepends Generate)
+  file(STRINGS ${ProfilingTestOutput} generateStep
+    REGEX "\"name\"[ ]*:[ ]*\"${step}\"")
+  if ("${generateStep}" STREQUAL "")
+    set(RunCMake_TEST_FAILED "Generate step '${step}' not profiled")
+  endif()
+endforeach()
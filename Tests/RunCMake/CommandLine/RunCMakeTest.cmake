@@ -822,3 +822,63 @@ set(ProfilingTestOutput ${RunCMake_TEST_BINARY_DIR}/output.json)
 set(RunCMake_TEST_OPTIONS --profiling-format=google-trace --profiling-output=${ProfilingTestOutput})
 run_cmake(ProfilingTest)
 unset(RunCMake_TEST_OPTIONS)
+
+set(RunCMake_TEST_BINARY_DIR "${RunCMake_BINARY_DIR}/profiling-summary-test")
+set(ProfilingTestOutput ${RunCMake_TEST_BINARY_DIR}/summary.txt)
+set(RunCMake_TEST_OPTIONS --profiling-format=summary --profiling-output=${ProfilingTestOutput})
+run_cmake(ProfilingSummaryTest)
+unset(RunCMake_TEST_OPTIONS)
+
+function(run_DumpState)
+  set(RunCMake_TEST_BINARY_DIR ${RunCMake_BINARY_DIR}/DumpState-build)
+  set(RunCMake_TEST_NO_CLEAN 1)
+  file(REMOVE_RECURSE "${RunCMake_TEST_BINARY_DIR}")
+  file(MAKE_DIRECTORY "${RunCMake_TEST_BINARY_DIR}")
+
+  # Compare two re-runs so that only the changed value differs.
+  run_cmake(DumpState)
+  set(RunCMake_TEST_OPTIONS --dump-state=${RunCMake_TEST_BINARY_DIR}/first.state)
+  run_cmake(DumpState)
+  set(RunCMake_TEST_OPTIONS -DDUMP_STATE_VALUE=changed
+    --dump-state=${RunCMake_TEST_BINARY_DIR}/second.state)
+  run_cmake(DumpState)
+  run_cmake_command(DumpState-same ${CMAKE_COMMAND} -E compare_state_dumps
+    ${RunCMake_TEST_BINARY_DIR}/first.state
+    ${RunCMake_TEST_BINARY_DIR}/first.state)
+  run_cmake_command(DumpState-differ ${CMAKE_COMMAND} -E compare_state_dumps
+    ${RunCMake_TEST_BINARY_DIR}/first.state
+    ${RunCMake_TEST_BINARY_DIR}/second.state)
+  run_cmake_command(DumpState-invalid ${CMAKE_COMMAND} -E compare_state_dumps
+    ${RunCMake_SOURCE_DIR}/DumpState.cmake
+    ${RunCMake_TEST_BINARY_DIR}/first.state)
+endfunction()
+run_DumpState()
+
+function(run_BinaryCache)
+  set(RunCMake_TEST_BINARY_DIR ${RunCMake_BINARY_DIR}/BinaryCache-build)
+  set(RunCMake_TEST_NO_CLEAN 1)
+  file(REMOVE_RECURSE "${RunCMake_TEST_BINARY_DIR}")
+  file(MAKE_DIRECTORY "${RunCMake_TEST_BINARY_DIR}")
+
+  run_cmake(BinaryCache)
+  # Hand edits of CMakeCache.txt take precedence over the binary sidecar.
+  file(READ ${RunCMake_TEST_BINARY_DIR}/CMakeCache.txt cache)
+  string(REPLACE "BINARY_CACHE_VALUE:STRING=initial"
+    "BINARY_CACHE_VALUE:STRING=edited" cache "${cache}")
+  file(WRITE ${RunCMake_TEST_BINARY_DIR}/CMakeCache.txt "${cache}")
+  run_cmake(BinaryCache-edited)
+  # Edits are noticed even if they keep the size and modification time.
+  if(UNIX)
+    file(COPY ${RunCMake_TEST_BINARY_DIR}/CMakeCache.txt
+      DESTINATION ${RunCMake_TEST_BINARY_DIR}/stamp)
+    file(READ ${RunCMake_TEST_BINARY_DIR}/CMakeCache.txt cache)
+    string(REPLACE "BINARY_CACHE_VALUE:STRING=edited"
+      "BINARY_CACHE_VALUE:STRING=stamp0" cache "${cache}")
+    file(WRITE ${RunCMake_TEST_BINARY_DIR}/CMakeCache.txt "${cache}")
+    execute_process(COMMAND touch
+      -r ${RunCMake_TEST_BINARY_DIR}/stamp/CMakeCache.txt
+      ${RunCMake_TEST_BINARY_DIR}/CMakeCache.txt)
+    run_cmake(BinaryCache-same-stamp)
+  endif()
+endfunction()
+run_BinaryCache()
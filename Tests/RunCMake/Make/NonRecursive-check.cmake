@@ -0,0 +1,40 @@
+file(READ "${RunCMake_TEST_BINARY_DIR}/CMakeFiles/Makefile2" makefile2)
+foreach(exe IN ITEMS exe1 exe2)
+  if(NOT makefile2 MATCHES "\ninclude CMakeFiles/${exe}\\.dir/build\\.make\n")
+    string(APPEND RunCMake_TEST_FAILED
+      "Makefile2 does not include the rules of ${exe}.\n")
+  endif()
+endforeach()
+if(makefile2 MATCHES "build\\.make CMakeFiles/")
+  string(APPEND RunCMake_TEST_FAILED "Makefile2 runs make for a target.\n")
+endif()
+if(NOT makefile2 MATCHES "\nCMakeFiles/exe2\\.dir/order: CMakeFiles/exe1\\.dir/all\n")
+  string(APPEND RunCMake_TEST_FAILED "exe2 is not ordered after exe1.\n")
+endif()
+
+file(READ "${RunCMake_TEST_BINARY_DIR}/CMakeFiles/exe2.dir/flags.make" flags)
+if(NOT flags MATCHES "\nCMakeFiles/exe2\\.dir/%: C_DEFINES = -DEXE2\n")
+  string(APPEND RunCMake_TEST_FAILED
+    "The flags of exe2 are not specific to its objects.\n")
+endif()
+
+foreach(lib IN ITEMS a.b a_b)
+  string(REPLACE "." "\\." lib_re "${lib}")
+  file(READ "${RunCMake_TEST_BINARY_DIR}/CMakeFiles/${lib}.dir/build.make" build)
+  if(NOT build MATCHES "\nCMakeFiles/${lib_re}\\.dir/OBJECTS =")
+    string(APPEND RunCMake_TEST_FAILED
+      "The objects variable of ${lib} is not specific to it.\n")
+  endif()
+endforeach()
+
+set(copies 0)
+foreach(exe IN ITEMS exe1 exe2)
+  file(READ "${RunCMake_TEST_BINARY_DIR}/CMakeFiles/${exe}.dir/build.make" build)
+  if(build MATCHES "\nifndef CMAKE_MAKEFILE_NON_RECURSIVE\ngen\\.c:")
+    math(EXPR copies "${copies} + 1")
+  endif()
+endforeach()
+if(NOT copies EQUAL 1)
+  string(APPEND RunCMake_TEST_FAILED
+    "Not exactly one target has a copy of the rule for gen.c.\n")
+endif()
@@ -0,0 +1,23 @@
+enable_language(C)
+set(CMAKE_MAKEFILE_NON_RECURSIVE 1)
+
+add_custom_command(OUTPUT gen.c
+  COMMAND ${CMAKE_COMMAND} -E copy ${CMAKE_CURRENT_SOURCE_DIR}/hello.c gen.c)
+add_executable(exe1 ${CMAKE_CURRENT_BINARY_DIR}/gen.c)
+add_executable(exe2 ${CMAKE_CURRENT_BINARY_DIR}/gen.c)
+target_compile_definitions(exe2 PRIVATE EXE2)
+add_dependencies(exe2 exe1)
+
+# The names of the object variables of these targets must not clash.
+file(WRITE "${CMAKE_CURRENT_BINARY_DIR}/dot.c" "int dot(void) { return 1; }\n")
+file(WRITE "${CMAKE_CURRENT_BINARY_DIR}/underscore.c"
+  "int underscore(void) { return 2; }\n")
+file(WRITE "${CMAKE_CURRENT_BINARY_DIR}/both.c" "
+int dot(void);
+int underscore(void);
+int main(void) { return dot() + underscore() == 3 ? 0 : 1; }
+")
+add_library(a.b STATIC ${CMAKE_CURRENT_BINARY_DIR}/dot.c)
+add_library(a_b STATIC ${CMAKE_CURRENT_BINARY_DIR}/underscore.c)
+add_executable(both ${CMAKE_CURRENT_BINARY_DIR}/both.c)
+target_link_libraries(both a.b a_b)
@@ -0,0 +1,5 @@
+file(READ "${RunCMake_TEST_BINARY_DIR}/CMakeFiles/Makefile2" makefile2)
+if(makefile2 MATCHES "\ninclude CMakeFiles/custom\\.dir/build\\.make\n")
+  string(APPEND RunCMake_TEST_FAILED
+    "Makefile2 includes the rules of custom for a non-GNU make.\n")
+endif()
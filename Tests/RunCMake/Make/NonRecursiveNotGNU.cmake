@@ -0,0 +1,2 @@
+set(CMAKE_MAKEFILE_NON_RECURSIVE 1)
+add_custom_target(custom ALL COMMAND ${CMAKE_COMMAND} -E echo custom)
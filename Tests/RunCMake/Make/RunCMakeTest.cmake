@@ -38,3 +38,26 @@ run_VerboseBuild()
 
 run_cmake(CustomCommandDepfile-ERROR)
 run_cmake(IncludeRegexSubdir)
+
+function(run_NonRecursive)
+  run_cmake(NonRecursive)
+  set(RunCMake_TEST_NO_CLEAN 1)
+  set(RunCMake_TEST_BINARY_DIR ${RunCMake_BINARY_DIR}/NonRecursive-build)
+  # Each of the targets sharing gen.c can generate it alone.
+  foreach(exe IN ITEMS exe1 exe2)
+    file(REMOVE "${RunCMake_TEST_BINARY_DIR}/gen.c")
+    run_cmake_command(NonRecursive-fast-${exe} ${CMAKE_COMMAND} --build . --target ${exe}/fast)
+  endforeach()
+  run_cmake_command(NonRecursive-build ${CMAKE_COMMAND} --build .)
+  run_cmake_command(NonRecursive-run ${RunCMake_TEST_BINARY_DIR}/both)
+endfunction()
+if(MAKE_IS_GNU)
+  run_NonRecursive()
+endif()
+
+function(run_NonRecursiveNotGNU)
+  # The output of 'cmake --version' does not name GNU make.
+  set(RunCMake_MAKE_PROGRAM "${CMAKE_COMMAND}")
+  run_cmake(NonRecursiveNotGNU)
+endfunction()
+run_NonRecursiveNotGNU()
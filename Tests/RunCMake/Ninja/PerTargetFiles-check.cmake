@@ -0,0 +1,12 @@
+set(build_dir "${RunCMake_TEST_BINARY_DIR}")
+file(READ "${build_dir}/build.ninja" build_file)
+foreach(target IN ITEMS lib exe custom)
+  set(target_file "CMakeFiles/${target}.dir/build.ninja")
+  if(NOT EXISTS "${build_dir}/${target_file}")
+    string(APPEND RunCMake_TEST_FAILED "Target file not generated:\n  ${target_file}\n")
+  elseif(NOT build_file MATCHES "subninja ${target_file}")
+    string(APPEND RunCMake_TEST_FAILED "build.ninja does not include:\n  ${target_file}\n")
+  elseif(NOT build_file MATCHES "\nbuild build\\.ninja [^\n:]*${target_file}[^\n]*: RERUN_CMAKE")
+    string(APPEND RunCMake_TEST_FAILED "build.ninja does not regenerate:\n  ${target_file}\n")
+  endif()
+endforeach()
@@ -0,0 +1,5 @@
+enable_language(C)
+set(CMAKE_NINJA_PER_TARGET_FILES ON)
+add_library(lib STATIC hello.c)
+add_executable(exe hello.c)
+add_custom_target(custom ALL COMMAND ${CMAKE_COMMAND} -E echo custom)
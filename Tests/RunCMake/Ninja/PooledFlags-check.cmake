@@ -0,0 +1,14 @@
+set(build_file "${RunCMake_TEST_BINARY_DIR}/build.ninja")
+file(READ "${build_file}" build)
+if(NOT build MATCHES "\n(FLAGS_[0-9]+) = [^\n]*-DPOOLED_COMMON_FLAG_ONE=1 -DPOOLED_COMMON_FLAG_TWO=2\n")
+  string(APPEND RunCMake_TEST_FAILED
+    "No pooled variable with the common flags in\n  ${build_file}\n")
+  return()
+endif()
+set(pooled "${CMAKE_MATCH_1}")
+foreach(n 1 2)
+  if(NOT build MATCHES "\nbuild [^\n]*pooled${n}\\.c\\.o: [^\n]*\n([ ]+[^\n]*\n)*  FLAGS = \\$${pooled} -DPOOLED_SOURCE_FLAG=${n}\n")
+    string(APPEND RunCMake_TEST_FAILED
+      "pooled${n}.c.o does not use \$${pooled} with its own flags in\n  ${build_file}\n")
+  endif()
+endforeach()
@@ -0,0 +1,18 @@
+enable_language(C)
+add_compile_options(-DPOOLED_COMMON_FLAG_ONE=1 -DPOOLED_COMMON_FLAG_TWO=2)
+foreach(n 1 2)
+  file(WRITE "${CMAKE_CURRENT_BINARY_DIR}/pooled${n}.c" "
+#if !defined(POOLED_COMMON_FLAG_ONE) || !defined(POOLED_COMMON_FLAG_TWO)
+#  error \"Common flags missing\"
+#endif
+#if POOLED_SOURCE_FLAG != ${n}
+#  error \"Source flag not ${n}\"
+#endif
+int pooled${n}(void) { return ${n}; }
+")
+  set_property(SOURCE "${CMAKE_CURRENT_BINARY_DIR}/pooled${n}.c"
+    PROPERTY COMPILE_OPTIONS -DPOOLED_SOURCE_FLAG=${n})
+endforeach()
+add_library(pooled STATIC
+  "${CMAKE_CURRENT_BINARY_DIR}/pooled1.c"
+  "${CMAKE_CURRENT_BINARY_DIR}/pooled2.c")
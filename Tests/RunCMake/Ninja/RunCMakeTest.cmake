@@ -324,6 +324,36 @@ function (run_ChangeBuildType)
 endfunction()
 run_ChangeBuildType()
 
+function(run_PerTargetFiles)
+  set(RunCMake_TEST_BINARY_DIR ${RunCMake_BINARY_DIR}/PerTargetFiles-build)
+  run_cmake(PerTargetFiles)
+  run_ninja("${RunCMake_TEST_BINARY_DIR}" -w dupbuild=err)
+  if(NOT ninja_version VERSION_LESS 1.8)
+    set(target_file "${RunCMake_TEST_BINARY_DIR}/CMakeFiles/lib.dir/build.ninja")
+    file(TIMESTAMP "${target_file}" before "%s")
+    execute_process(COMMAND ${CMAKE_COMMAND} -E sleep 1)
+    touch("${RunCMake_TEST_BINARY_DIR}/CMakeCache.txt")
+    run_ninja("${RunCMake_TEST_BINARY_DIR}" -w dupbuild=err)
+    file(TIMESTAMP "${target_file}" after "%s")
+    if(NOT after STREQUAL before)
+      message(FATAL_ERROR "Unchanged target file was rewritten:\n"
+        "  ${target_file}")
+    endif()
+    run_ninja("${RunCMake_TEST_BINARY_DIR}" -d explain)
+    if(NOT ninja_stdout MATCHES "no work to do")
+      message(FATAL_ERROR "Regeneration left work to do:\n${ninja_stdout}")
+    endif()
+  endif()
+endfunction()
+run_PerTargetFiles()
+
+function(run_PooledFlags)
+  set(RunCMake_TEST_BINARY_DIR ${RunCMake_BINARY_DIR}/PooledFlags-build)
+  run_cmake(PooledFlags)
+  run_ninja("${RunCMake_TEST_BINARY_DIR}")
+endfunction()
+run_PooledFlags()
+
 function(run_Qt5AutoMocDeps)
   if(CMake_TEST_Qt5 AND CMAKE_TEST_Qt5Core_Version VERSION_GREATER_EQUAL 5.15.0)
     set(RunCMake_TEST_BINARY_DIR ${RunCMake_BINARY_DIR}/Qt5AutoMocDeps-build)